@@ -0,0 +1,102 @@
+/**
+ *
+ * @file bench_engine.c
+ * Benchmark of a whole simulation at saturation.
+ *
+ * This file runs the cars from their arrival to their passage through
+ * the discrete-event engine (@see engine.h), the new cars arriving far
+ * faster than the junction lets them pass, so the queues keep growing:
+ * 		- free: each green light releases its whole queue at once
+ * 		- saturation: a green lane lets SATURATION_FLOW cars pass per hour
+ * The virtual clock does not sleep: the number of cars per second of
+ * the wall clock is the cost of the simulation itself. In real time, the
+ * cars are bounded by the demand, the pool (@see bench_pool.c) being the
+ * limit at saturation.
+ *
+ * Each line of the output gives: controller,pattern,cars,ns_per_car,cars_per_s
+ *
+ * @version 1.0
+ *
+ * ********************************************************* */
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include "../inc/engine.h"
+
+/**
+ * Number of cars of a simulation.
+ */
+#define NB_CARS 100000
+
+/**
+ * Maximum time between two arrivals in microseconds.
+ */
+#define TIMELAPSE 1000
+
+/**
+ * Flow of a green lane in the saturation pattern, in cars per hour.
+ */
+#define SATURATION_FLOW 1800
+
+/**
+ * Read the monotonic clock in nanoseconds.
+ */
+static long bench_now () {
+	struct timespec now;
+	clock_gettime (CLOCK_MONOTONIC, &now);
+	return now.tv_sec*1000000000L + now.tv_nsec;
+}
+
+/**
+ * Run a simulation and print its result line.
+ */
+static void bench_run (FILE * results, char * pattern, int saturationFlow) {
+	Network network;
+	EngineResult result;
+	long start, elapsed;
+
+	if (network_single (&network, DEFAULT_WAITING_TIME) == -1) {
+		perror ("Error creating network");
+		return;
+	}
+	start = bench_now ();
+	if (run_engine (&network, NB_CARS, TIMELAPSE, saturationFlow, 0, 1, &result) != 0) {
+		network_free (&network);
+		return;
+	}
+	elapsed = bench_now () - start;
+	network_free (&network);
+	fprintf (results, "%s,%s,%ld,%.1f,%.0f\n", controller_name (controllerPolicy), pattern,
+		result.nbCars, (double) elapsed / result.nbCars, result.nbCars * 1e9 / elapsed);
+	fflush (results);
+}
+
+/**
+ * Run the simulation with and without saturation flow. The engine prints
+ * as a simulation does: its output is dropped.
+ */
+int main () {
+	FILE * results;
+	int nullOutput;
+
+	if (!(results = fdopen (dup (STDOUT_FILENO), "w"))) {
+		perror ("Error opening output");
+		return 1;
+	}
+	if ((nullOutput = open ("/dev/null", O_WRONLY)) != -1) {
+		dup2 (nullOutput, STDOUT_FILENO);
+		close (nullOutput);
+	}
+
+	simuAutoMode = 1;
+	controllerPolicy = CTRL_FIXED;
+	demand_default (&simuDemand);
+
+	fputs ("controller,pattern,cars,ns_per_car,cars_per_s\n", results);
+	bench_run (results, "free", 0);
+	bench_run (results, "saturation", SATURATION_FLOW);
+	fclose (results);
+	return 0;
+}
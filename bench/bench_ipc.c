@@ -0,0 +1,150 @@
+/**
+ *
+ * @file bench_ipc.c
+ * Microbenchmark of the shared memory and of the notice channel.
+ *
+ * This file measures the other primitives of the roles (@see ipcTools.h,
+ * channel.h), with the roles run as processes on the System V backend
+ * and as threads on the private one:
+ * 		- shm_attach: create, attach, touch and release a private area the
+ * 		  size of a page, as done for the shared variables of a simulation
+ * 		- notice: a role sending notices as fast as the channel takes
+ * 		  them, read in batches by another one, as the dispatcher of the
+ * 		  cars does
+ *
+ * Each line of the output gives: roles,backend,pattern,iterations,ns_per_op
+ *
+ * @version 1.0
+ *
+ * ********************************************************* */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "../inc/ipcTools.h"
+#include "../inc/channel.h"
+#include "../inc/roles.h"
+
+/**
+ * Number of areas created.
+ */
+#define NB_AREAS 10000
+
+/**
+ * Size of an area in bytes.
+ */
+#define AREA_SIZE 4096
+
+/**
+ * Number of notices sent.
+ */
+#define NB_NOTICES 1000000
+
+/**
+ * The channel of the notices.
+ */
+static Channel channel;
+
+/**
+ * Read the monotonic clock in nanoseconds.
+ */
+static long bench_now () {
+	struct timespec now;
+	clock_gettime (CLOCK_MONOTONIC, &now);
+	return now.tv_sec*1000000000L + now.tv_nsec;
+}
+
+/**
+ * Print a result line.
+ */
+static void bench_report (char * roles, char * backend, char * pattern, long iterations,
+		long elapsed) {
+	printf ("%s,%s,%s,%ld,%.1f\n", roles, backend, pattern, iterations,
+		(double) elapsed / iterations);
+	fflush (stdout);
+}
+
+/**
+ * Create, attach, touch and release private areas.
+ */
+static void bench_attach (int mode, char * backend) {
+	char * area;
+	long i, start;
+
+	start = bench_now ();
+	for (i = 0; i < NB_AREAS; i++) {
+		if (!(area = shmalloc (IPC_PRIVATE, AREA_SIZE))) {
+			perror ("Error creating shared memory");
+			return;
+		}
+		area[0] = 1;
+		if (mode == ROLES_PROCESS)
+			shmdt (area);
+		else
+			munmap (area, AREA_SIZE);
+	}
+	bench_report (roles_name (mode), backend, "shm_attach", NB_AREAS, bench_now () - start);
+}
+
+/**
+ * A role sending the notices.
+ */
+static int bench_send (void * arg) {
+	long i;
+
+	for (i = 0; i < NB_NOTICES; i++)
+		channel_send (&channel, NOTICE_RELEASE, i & 1);
+	return 0;
+}
+
+/**
+ * Notices sent by a role, read in batches by the calling one.
+ */
+static void bench_notice (int mode, char * backend) {
+	Notice * received[CHANNEL_BATCH];
+	Role role;
+	long count = 0, start;
+	int n;
+
+	if (channel_open (&channel) == -1) {
+		perror ("Error creating notice channel");
+		return;
+	}
+	start = bench_now ();
+	if (role_start (&role, mode, bench_send, 0) == -1) {
+		perror ("Error starting role");
+		channel_close (&channel);
+		return;
+	}
+	while (count < NB_NOTICES) {
+		n = channel_receive (&channel, received, CHANNEL_BATCH);
+		count += n;
+		channel_release (&channel, n);
+	}
+	role_wait (&role);
+	bench_report (roles_name (mode), backend, "notice", NB_NOTICES, bench_now () - start);
+	channel_close (&channel);
+}
+
+/**
+ * Run every pattern on each way of running the roles.
+ */
+int main () {
+	char * names[] = {"sysv", "private"};
+	int backends[] = {IPC_BACKEND_SYSV, IPC_BACKEND_PRIVATE};
+	int modes[] = {ROLES_PROCESS, ROLES_THREAD};
+	int i;
+
+	puts ("roles,backend,pattern,iterations,ns_per_op");
+	fflush (stdout);	/* Else each role process would print it again. */
+	for (i = 0; i < 2; i++) {
+		if (ipcbackend (backends[i]) == -1) {
+			perror ("Error selecting semaphore backend");
+			return 1;
+		}
+		bench_attach (modes[i], names[i]);
+		bench_notice (modes[i], names[i]);
+	}
+	return 0;
+}
@@ -0,0 +1,115 @@
+/**
+ *
+ * @file bench_pool.c
+ * Microbenchmark of the pool running the tasks of the cars.
+ *
+ * This file measures the cost of a car for the pool of workers
+ * (@see pool.h), one worker per online core as in a simulation:
+ * 		- dispatch: submit a due task and wait for a worker to run it, as
+ * 		  a car arriving on a green light
+ * 		- release: submit a batch of due tasks at once and wait for the
+ * 		  last one, as a lane going green releases its waiting cars: the
+ * 		  batch wakes up the sleeping workers
+ * 		- saturation: submit all the tasks then wait for them, the pool
+ * 		  running as many cars per second as it can
+ *
+ * Each line of the output gives: workers,pattern,batch,tasks,ns_per_task
+ *
+ * @version 1.0
+ *
+ * ********************************************************* */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <semaphore.h>
+#include <time.h>
+#include "../inc/pool.h"
+
+/**
+ * Number of tasks of each pattern (a multiple of the batches).
+ */
+#define NB_TASKS 102400
+
+/**
+ * The pool of workers.
+ */
+static Pool pool;
+
+/**
+ * Number of tasks run in the current batch.
+ */
+static atomic_long done;
+
+/**
+ * Number of tasks of the current batch.
+ */
+static long batchSize;
+
+/**
+ * Posted when the last task of the batch has run.
+ */
+static sem_t batchDone;
+
+/**
+ * Read the monotonic clock in nanoseconds.
+ */
+static long bench_now () {
+	struct timespec now;
+	clock_gettime (CLOCK_MONOTONIC, &now);
+	return now.tv_sec*1000000000L + now.tv_nsec;
+}
+
+/**
+ * Print a result line.
+ */
+static void bench_report (char * pattern, long batch, long elapsed) {
+	printf ("%d,%s,%ld,%d,%.1f\n", pool.nbWorkers, pattern, batch, NB_TASKS,
+		(double) elapsed / NB_TASKS);
+	fflush (stdout);
+}
+
+/**
+ * Count a task, posting the end of its batch.
+ */
+static void bench_task (Event * task) {
+	if (atomic_fetch_add (&done, 1) + 1 == batchSize)
+		sem_post (&batchDone);
+}
+
+/**
+ * Run the tasks by batches of the given size.
+ */
+static void bench_batches (char * pattern, long batch) {
+	long i, j, start;
+	Car car;
+
+	batchSize = batch;
+	start = bench_now ();
+	for (i = 0; i < NB_TASKS; i += batch) {
+		atomic_store (&done, 0);
+		for (j = 0; j < batch; j++) {
+			car.id = i + j;
+			pool_submit (&pool, pool_now (), EV_CAR_PASSED, &car, 0);
+		}
+		while (sem_wait (&batchDone) == -1);
+	}
+	bench_report (pattern, batch, bench_now () - start);
+}
+
+/**
+ * Run each pattern on a pool of one worker per core.
+ */
+int main () {
+	if (sem_init (&batchDone, 0, 0) == -1 || pool_init (&pool, 0, bench_task) == -1) {
+		perror ("Error creating pool");
+		return 1;
+	}
+	puts ("workers,pattern,batch,tasks,ns_per_task");
+	bench_batches ("dispatch", 1);
+	bench_batches ("release", 16);
+	bench_batches ("release", 256);
+	bench_batches ("saturation", NB_TASKS);
+	pool_destroy (&pool);
+	sem_destroy (&batchDone);
+	return 0;
+}
@@ -0,0 +1,229 @@
+/**
+ *
+ * @file bench_roles.c
+ * Microbenchmark of the ways of running the roles.
+ *
+ * This file compares the roles of a real time simulation run as forked
+ * processes, with the System V or the futex semaphores, and as threads of
+ * a single process with the private semaphores (@see roles.h):
+ * 		- startup: start the four roles of an interactive simulation and
+ * 		  wait for their end
+ * 		- handoff: two roles waking each other, as the junction's manager
+ * 		  and the lane roles do with "lane" and "canAccess"
+ * 		- memory: the proportional set size of the program with its four
+ * 		  roles started, the pages shared by processes being divided
+ * 		  between them
+ *
+ * Each line of the output gives: roles,backend,pattern,iterations,value
+ * where the value is in nanoseconds per operation, or in kilobytes for
+ * the memory.
+ *
+ * @version 1.0
+ *
+ * ********************************************************* */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "../inc/ipcTools.h"
+#include "../inc/roles.h"
+
+/**
+ * Number of roles of an interactive simulation.
+ */
+#define NB_ROLES 4
+
+/**
+ * Number of starts of the roles.
+ */
+#define NB_STARTS 200
+
+/**
+ * Number of round trips between two roles.
+ */
+#define NB_SHARED 100000
+
+/**
+ * The semaphores of the handoff.
+ */
+static int go, back;
+
+/**
+ * The semaphores holding the roles whose memory is measured.
+ */
+static int ready, hold;
+
+/**
+ * The memory of each role started as a process, in kilobytes.
+ */
+static long * memories;
+
+/**
+ * Read the monotonic clock in nanoseconds.
+ */
+static long bench_now () {
+	struct timespec now;
+	clock_gettime (CLOCK_MONOTONIC, &now);
+	return now.tv_sec*1000000000L + now.tv_nsec;
+}
+
+/**
+ * Read the proportional set size of the calling process in kilobytes.
+ */
+static long bench_pss () {
+	char line[128];
+	FILE * file;
+	long pss = -1;
+
+	if (!(file = fopen ("/proc/self/smaps_rollup", "r")))
+		return -1;
+	while (pss == -1 && fgets (line, sizeof (line), file))
+		sscanf (line, "Pss: %ld", &pss);
+	fclose (file);
+	return pss;
+}
+
+/**
+ * Print a result line.
+ */
+static void bench_report (char * roles, char * backend, char * pattern, long iterations,
+		double value) {
+	printf ("%s,%s,%s,%ld,%.1f\n", roles, backend, pattern, iterations, value);
+	fflush (stdout);
+}
+
+/**
+ * A role doing nothing.
+ */
+static int bench_idle (void * arg) {
+	return 0;
+}
+
+/**
+ * A role answering each wake up.
+ */
+static int bench_answer (void * arg) {
+	long i;
+
+	for (i = 0; i < NB_SHARED; i++) {
+		P (go);
+		V (back);
+	}
+	return 0;
+}
+
+/**
+ * A role measuring its memory, if it is a process, then waiting.
+ */
+static int bench_hold (void * arg) {
+	if (memories)
+		memories[(long) arg] = bench_pss ();
+	V (ready);
+	P (hold);
+	return 0;
+}
+
+/**
+ * Start and wait for the roles.
+ */
+static void bench_startup (int mode, char * backend) {
+	Role roles[NB_ROLES];
+	long n, start;
+	int i;
+
+	start = bench_now ();
+	for (n = 0; n < NB_STARTS; n++) {
+		for (i = 0; i < NB_ROLES; i++)
+			if (role_start (&roles[i], mode, bench_idle, 0) == -1)
+				perror ("Error starting role");
+		for (i = 0; i < NB_ROLES; i++)
+			role_wait (&roles[i]);
+	}
+	bench_report (roles_name (mode), backend, "startup", NB_STARTS,
+		(double) (bench_now () - start) / NB_STARTS);
+}
+
+/**
+ * Two roles waking each other (one round trip per iteration).
+ */
+static void bench_handoff (int mode, char * backend) {
+	Role role;
+	long i, start;
+
+	go = semalloc (IPC_PRIVATE, 0);
+	back = semalloc (IPC_PRIVATE, 0);
+	start = bench_now ();
+	if (role_start (&role, mode, bench_answer, 0) == -1) {
+		perror ("Error starting role");
+		return;
+	}
+	for (i = 0; i < NB_SHARED; i++) {
+		V (go);
+		P (back);
+	}
+	role_wait (&role);
+	bench_report (roles_name (mode), backend, "handoff", NB_SHARED,
+		(double) (bench_now () - start) / NB_SHARED);
+	semfree (go);
+	semfree (back);
+}
+
+/**
+ * The memory of the program once its roles are started.
+ */
+static void bench_memory (int mode, char * backend) {
+	Role roles[NB_ROLES];
+	long total;
+	int i;
+
+	ready = semalloc (IPC_PRIVATE, 0);
+	hold = semalloc (IPC_PRIVATE, 0);
+	memories = 0;
+	if (mode == ROLES_PROCESS && !(memories = shmalloc (IPC_PRIVATE, NB_ROLES * sizeof (long)))) {
+		perror ("Error creating shared memory");
+		return;
+	}
+	for (i = 0; i < NB_ROLES; i++)
+		if (role_start (&roles[i], mode, bench_hold, (void *) (long) i) == -1)
+			perror ("Error starting role");
+	for (i = 0; i < NB_ROLES; i++)
+		P (ready);
+
+	total = bench_pss ();
+	for (i = 0; memories && i < NB_ROLES; i++)
+		total += memories[i];
+	for (i = 0; i < NB_ROLES; i++)
+		V (hold);
+	for (i = 0; i < NB_ROLES; i++)
+		role_wait (&roles[i]);
+	bench_report (roles_name (mode), backend, "memory_kb", NB_ROLES, total);
+
+	if (memories)
+		shmdt (memories);
+	memories = 0;
+	semfree (ready);
+	semfree (hold);
+}
+
+/**
+ * Run every pattern on each way of running the roles.
+ */
+int main () {
+	char * names[] = {"sysv", "futex", "private"};
+	int backends[] = {IPC_BACKEND_SYSV, IPC_BACKEND_FUTEX, IPC_BACKEND_PRIVATE};
+	int modes[] = {ROLES_PROCESS, ROLES_PROCESS, ROLES_THREAD};
+	int i;
+
+	puts ("roles,backend,pattern,iterations,value");
+	fflush (stdout);	/* Else each role process would print it again. */
+	for (i = 0; i < 3; i++) {
+		if (ipcbackend (backends[i]) == -1) {
+			perror ("Error selecting semaphore backend");
+			return 1;
+		}
+		bench_startup (modes[i], names[i]);
+		bench_handoff (modes[i], names[i]);
+		bench_memory (modes[i], names[i]);
+	}
+	return 0;
+}
@@ -0,0 +1,230 @@
+/**
+ *
+ * @file bench_sem.c
+ * Microbenchmark of the semaphores backends.
+ *
+ * This file compares the System V and the futex backends of the P/V
+ * operations (@see ipcTools.h) under the access patterns of the simulation:
+ * 		- mutex: P then V on a free semaphore, as done once or twice per car
+ * 		  on the "mutex" table
+ * 		- contended: two processes taking turns on the same mutex
+ * 		- handoff: two processes waking each other, as the junction's manager
+ * 		  and the lane processes do with "lane" and "canAccess"
+ * 		- alloc / alloc_set: allocate and destroy the six semaphores of a
+ * 		  simulation one by one, or as a single set
+ * 		- pair / pair_set: take then give back two free mutexes, one at a
+ * 		  time or both at once, as the end flag is raised
+ *
+ * Each line of the output gives: backend,pattern,iterations,ns_per_op
+ *
+ * @version 1.0
+ *
+ * ********************************************************* */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "../inc/ipcTools.h"
+
+/**
+ * Number of iterations of the uncontended pattern.
+ */
+#define NB_UNCONTENDED 1000000
+
+/**
+ * Number of iterations of the patterns involving two processes.
+ */
+#define NB_SHARED 100000
+
+/**
+ * Number of allocations of the semaphores of a simulation.
+ */
+#define NB_ALLOCS 10000
+
+/**
+ * Number of semaphores of a simulation.
+ */
+#define NB_SIMU_SEMS 6
+
+/**
+ * Read the monotonic clock in nanoseconds.
+ */
+static long bench_now () {
+	struct timespec now;
+	clock_gettime (CLOCK_MONOTONIC, &now);
+	return now.tv_sec*1000000000L + now.tv_nsec;
+}
+
+/**
+ * Print a result line.
+ */
+static void bench_report (char * backend, char * pattern, long iterations, long elapsed) {
+	printf ("%s,%s,%ld,%.1f\n", backend, pattern, iterations, (double) elapsed / iterations);
+	fflush (stdout);
+}
+
+/**
+ * P then V on a free semaphore.
+ */
+static void bench_mutex (char * backend) {
+	int mutex = semalloc (IPC_PRIVATE, 1);
+	long i, start;
+
+	start = bench_now ();
+	for (i = 0; i < NB_UNCONTENDED; i++) {
+		P (mutex);
+		V (mutex);
+	}
+	bench_report (backend, "mutex", NB_UNCONTENDED, bench_now () - start);
+	semfree (mutex);
+}
+
+/**
+ * Two processes taking turns on the same mutex.
+ */
+static void bench_contended (char * backend) {
+	int mutex = semalloc (IPC_PRIVATE, 1);
+	long i, start;
+	pid_t child;
+
+	start = bench_now ();
+	if ((child = fork ()) == 0) {
+		for (i = 0; i < NB_SHARED; i++) {
+			P (mutex);
+			V (mutex);
+		}
+		exit (0);
+	}
+	for (i = 0; i < NB_SHARED; i++) {
+		P (mutex);
+		V (mutex);
+	}
+	waitpid (child, 0, 0);
+	bench_report (backend, "contended", 2 * NB_SHARED, bench_now () - start);
+	semfree (mutex);
+}
+
+/**
+ * Two processes waking each other (one round trip per iteration).
+ */
+static void bench_handoff (char * backend) {
+	int go = semalloc (IPC_PRIVATE, 0), back = semalloc (IPC_PRIVATE, 0);
+	long i, start;
+	pid_t child;
+
+	start = bench_now ();
+	if ((child = fork ()) == 0) {
+		for (i = 0; i < NB_SHARED; i++) {
+			P (go);
+			V (back);
+		}
+		exit (0);
+	}
+	for (i = 0; i < NB_SHARED; i++) {
+		V (go);
+		P (back);
+	}
+	waitpid (child, 0, 0);
+	bench_report (backend, "handoff", NB_SHARED, bench_now () - start);
+	semfree (go);
+	semfree (back);
+}
+
+/**
+ * Allocate and destroy the semaphores of a simulation, one by one.
+ */
+static void bench_alloc (char * backend) {
+	int semids[NB_SIMU_SEMS];
+	long i, start;
+	int k;
+
+	start = bench_now ();
+	for (i = 0; i < NB_ALLOCS; i++) {
+		for (k = 0; k < NB_SIMU_SEMS; k++)
+			semids[k] = semalloc (IPC_PRIVATE, 1);
+		for (k = 0; k < NB_SIMU_SEMS; k++)
+			semfree (semids[k]);
+	}
+	bench_report (backend, "alloc", NB_ALLOCS, bench_now () - start);
+}
+
+/**
+ * Allocate and destroy the semaphores of a simulation as a single set.
+ */
+static void bench_alloc_set (char * backend) {
+	unsigned short values[NB_SIMU_SEMS] = {1, 1, 1, 1, 1, 1};
+	SemSet set;
+	long i, start;
+
+	start = bench_now ();
+	for (i = 0; i < NB_ALLOCS; i++) {
+		semsetalloc (&set, IPC_PRIVATE, NB_SIMU_SEMS, values);
+		semsetfree (&set);
+	}
+	bench_report (backend, "alloc_set", NB_ALLOCS, bench_now () - start);
+}
+
+/**
+ * Take then give back two free mutexes, one at a time.
+ */
+static void bench_pair (char * backend) {
+	unsigned short values[2] = {1, 1};
+	SemSet set;
+	long i, start;
+
+	semsetalloc (&set, IPC_PRIVATE, 2, values);
+	start = bench_now ();
+	for (i = 0; i < NB_UNCONTENDED; i++) {
+		Pset (&set, 0);
+		Pset (&set, 1);
+		Vset (&set, 0);
+		Vset (&set, 1);
+	}
+	bench_report (backend, "pair", NB_UNCONTENDED, bench_now () - start);
+	semsetfree (&set);
+}
+
+/**
+ * Take then give back two free mutexes at once.
+ */
+static void bench_pair_set (char * backend) {
+	int both[2] = {0, 1};
+	unsigned short values[2] = {1, 1};
+	SemSet set;
+	long i, start;
+
+	semsetalloc (&set, IPC_PRIVATE, 2, values);
+	start = bench_now ();
+	for (i = 0; i < NB_UNCONTENDED; i++) {
+		Pmulti (&set, both, 2);
+		Vmulti (&set, both, 2);
+	}
+	bench_report (backend, "pair_set", NB_UNCONTENDED, bench_now () - start);
+	semsetfree (&set);
+}
+
+/**
+ * Run every pattern on each backend.
+ */
+int main () {
+	char * names[] = {"sysv", "futex"};
+	int backends[] = {IPC_BACKEND_SYSV, IPC_BACKEND_FUTEX};
+	int i;
+
+	puts ("backend,pattern,iterations,ns_per_op");
+	for (i = 0; i < 2; i++) {
+		if (ipcbackend (backends[i]) == -1) {
+			perror ("Error selecting semaphore backend");
+			return 1;
+		}
+		bench_mutex (names[i]);
+		bench_contended (names[i]);
+		bench_handoff (names[i]);
+		bench_alloc (names[i]);
+		bench_alloc_set (names[i]);
+		bench_pair (names[i]);
+		bench_pair_set (names[i]);
+	}
+	return 0;
+}
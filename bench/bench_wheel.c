@@ -0,0 +1,124 @@
+/**
+ *
+ * @file bench_wheel.c
+ * Microbenchmark of the structures holding the pending tasks.
+ *
+ * This file compares the binary heap of the engine (@see events.h) and
+ * the timing wheel of the pool (@see wheel.h) under the classic hold
+ * model: with a number of pending timers, take the next one and set a new
+ * one at a random delay below a second, as the passage of a car does.
+ *
+ * Each line of the output gives: structure,pattern,pending,ns_per_op
+ *
+ * @version 1.0
+ *
+ * ********************************************************* */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "../inc/events.h"
+#include "../inc/wheel.h"
+
+/**
+ * Number of hold operations.
+ */
+#define NB_HOLDS 1000000
+
+/**
+ * Maximum delay of a timer in microseconds.
+ */
+#define MAX_DELAY 1000000
+
+/**
+ * Read the monotonic clock in nanoseconds.
+ */
+static long bench_now () {
+	struct timespec now;
+	clock_gettime (CLOCK_MONOTONIC, &now);
+	return now.tv_sec*1000000000L + now.tv_nsec;
+}
+
+/**
+ * Draw a delay (xorshift, the same sequence for both structures).
+ */
+static long bench_delay (unsigned long * state) {
+	*state ^= *state << 13;
+	*state ^= *state >> 7;
+	*state ^= *state << 17;
+	return *state % MAX_DELAY;
+}
+
+/**
+ * Print a result line.
+ */
+static void bench_report (char * structure, char * pattern, long pending, long elapsed) {
+	printf ("%s,%s,%ld,%.1f\n", structure, pattern, pending, (double) elapsed / NB_HOLDS);
+	fflush (stdout);
+}
+
+/**
+ * Hold model on the heap.
+ */
+static void bench_heap (long pending) {
+	unsigned long state = 88172645463325252UL;
+	EventQueue queue;
+	Event event;
+	long i, start;
+
+	if (evq_init (&queue, pending) == -1) {
+		perror ("Error creating event queue");
+		return;
+	}
+	for (i = 0; i < pending; i++) {
+		event.car.id = i;
+		evq_push (&queue, bench_delay (&state), EV_CAR_PASSED, &event.car, 0);
+	}
+	start = bench_now ();
+	for (i = 0; i < NB_HOLDS; i++) {
+		evq_pop (&queue, &event);
+		evq_push (&queue, event.time + bench_delay (&state), EV_CAR_PASSED, &event.car, 0);
+	}
+	bench_report ("heap", "hold", pending, bench_now () - start);
+	evq_free (&queue);
+}
+
+/**
+ * Hold model on the wheel.
+ */
+static void bench_wheel (long pending) {
+	unsigned long state = 88172645463325252UL;
+	Wheel wheel;
+	Event event;
+	long i, start, date;
+
+	if (wheel_init (&wheel, 0, pending) == -1) {
+		perror ("Error creating wheel");
+		return;
+	}
+	for (i = 0; i < pending; i++) {
+		event.car.id = i;
+		wheel_insert (&wheel, bench_delay (&state), EV_CAR_PASSED, &event.car, 0);
+	}
+	start = bench_now ();
+	for (i = 0; i < NB_HOLDS; i++) {
+		while (wheel_next (&wheel, &date) && !wheel_expire (&wheel, date, &event));
+		wheel_insert (&wheel, event.time + bench_delay (&state), EV_CAR_PASSED, &event.car, 0);
+	}
+	bench_report ("wheel", "hold", pending, bench_now () - start);
+	wheel_free (&wheel);
+}
+
+/**
+ * Run the hold model on both structures, for growing numbers of timers.
+ */
+int main () {
+	long pending[] = {100, 10000, 100000};
+	int i;
+
+	puts ("structure,pattern,pending,ns_per_op");
+	for (i = 0; i < 3; i++) {
+		bench_heap (pending[i]);
+		bench_wheel (pending[i]);
+	}
+	return 0;
+}
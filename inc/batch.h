@@ -0,0 +1,108 @@
+/**
+ *
+ * @file batch.h
+ * Parameter sweep: many simulations run in parallel on the virtual clock.
+ *
+ * This file declares the batch mode. Each value of the swept parameters
+ * gives a configuration, simulated several times (the replications) by
+ * the discrete-event engine. The runs are shared out between worker
+ * processes, one per core by default, which take the next run to do from
+ * a counter in an anonymous shared mapping and write their result next to
+ * it. A run uses no System V object and no key, so the runs of a batch,
+ * or of two batches, never interfere. One summary row is printed per
+ * configuration once all the runs are done.
+ *
+ * @see engine.h
+ * @version 1.0
+ *
+ * ********************************************************* */
+#ifndef __batch_H
+	#define __batch_H
+
+	#include <stdatomic.h>
+
+	/**
+	 * Call the discrete-event engine running each simulation.
+	 */
+	#include "../inc/engine.h"
+
+	/**
+	 * Used as the default number of replications of each configuration.
+	 */
+	#define DEFAULT_BATCH_RUNS 1
+
+	/**
+	 * Values taken by a swept parameter.
+	 *
+	 * @param values the values, in the order given
+	 * @param nbValues the number of values
+	 */
+	typedef struct {
+		long * values;
+		int nbValues;
+	} BatchRange;
+
+	/**
+	 * A run of the batch, written by the worker which did it.
+	 *
+	 * @param result the summary given by the engine
+	 * @param status -1 while the run is not done, then the value returned by the engine
+	 */
+	typedef struct {
+		EngineResult result;
+		int status;
+	} BatchRun;
+
+	/**
+	 * The mapping shared by the workers of a batch.
+	 *
+	 * @param next the number of the next run to be done
+	 * @param runs the runs, replications of a configuration being contiguous
+	 */
+	typedef struct {
+		atomic_long next;
+		BatchRun runs[];
+	} BatchShared;
+
+	/**
+	 * Read the values of a swept parameter: a single number, a list
+	 * "A,B,C" or a range "START:STOP:STEP" (both ends included).
+	 *
+	 * @param range the values read, replacing the previous ones
+	 * @param spec the text to read
+	 * @param min the smallest value allowed
+	 * @param max the largest value allowed
+	 *
+	 * @return 0 if success, -1 if the text is invalid or the memory is lacking
+	 */
+	int batch_parse_range (BatchRange * range, char * spec, long min, long max);
+
+	/**
+	 * Give a swept parameter its single value if no value was read.
+	 *
+	 * @param range the swept parameter
+	 * @param value the value by default
+	 *
+	 * @return 0 if success, -1 otherwise
+	 */
+	int batch_default_range (BatchRange * range, long value);
+
+	/**
+	 * Run every configuration of the sweep and print one CSV row per
+	 * configuration on the standard output.
+	 *
+	 * @param switchTimes the values of the minimum waiting time before going to the green light
+	 * @param timelapses the values of the maximum waiting time before a new car appear
+	 * @param nbCars the values of the number of cars
+	 * @param nbRuns the number of replications of each configuration
+	 * @param nbJobs the number of worker processes (0: one per online core)
+	 * @param saturationFlow the number of cars released per hour of green light
+	 * @param networkFile the topology file of the road network (0: the single junction)
+	 * @param scenario the schedule of the arrivals (0: the arrivals are drawn)
+	 *
+	 * @return 0 if every run succeeded, a specific number otherwise
+	 */
+	int run_batch (BatchRange * switchTimes, BatchRange * timelapses, BatchRange * nbCars,
+		int nbRuns, int nbJobs, int saturationFlow, char * networkFile, Scenario * scenario);
+
+#endif
@@ -5,10 +5,16 @@
  * to traffic lights.
  * 
  * This file declares the functions used to simulate cars,
- * which are represented by threads.
+ * which are represented by tasks run by a pool of threads.
  * 
  * @see param.h
  * @see ipcTools.h
+ * @see pool.h
+ * @see lanequeue.h
+ * @see eventlog.h
+ * @see rng.h
+ * @see scenario.h
+ * @see demand.h
  * @version 9.1
  * 
  * ********************************************************* */
@@ -29,19 +35,66 @@
 	#include "../inc/ipcTools.h"
 
 	/**
-	 * Table of threads used to represent driving cars.
+	 * Call the pool of worker threads running the cars.
 	 */
-	pthread_t threads[50];	
+	#include "../inc/pool.h"
 
 	/**
-	 * Mutex which protects a critical section.
+	 * Call the asynchronous log of the events.
 	 */
-	pthread_mutex_t goMut;
+	#include "../inc/eventlog.h"
+
+	/**
+	 * Call the queues of the cars waiting on a lane.
+	 */
+	#include "../inc/lanequeue.h"
+
+	/**
+	 * Call the seeded streams of random numbers.
+	 */
+	#include "../inc/rng.h"
+
+	/**
+	 * Call the schedules of arrivals of the scenario files.
+	 */
+	#include "../inc/scenario.h"
+
+	/**
+	 * Call the models of the arrivals.
+	 */
+	#include "../inc/demand.h"
+
+	/**
+	 * Call the functions used to switch the junction.
+	 */
+	#include "../inc/crossroads.h"
+
+	/**
+	 * Call the statistics of the simulation.
+	 */
+	#include "../inc/stats.h"
+
+	/**
+	 * Time ahead of their date during which the arrivals are set as timers
+	 * of the pool, in microseconds: the generator sleeps once per half of it,
+	 * not once per car.
+	 */
+	#define CARS_LOOKAHEAD 100000
 
 	/**
-	 * Condition which test if a car can pass or not on a traffic light.
+	 * Pool of worker threads used to drive the cars.
 	 */
-	pthread_cond_t goCond;
+	Pool carPool;
+
+	/**
+	 * Table of the queues of cars waiting on each lane of the crossroad.
+	 */
+	LaneQueue waitingCars[2];
+
+	/**
+	 * Mutex which protects a critical section.
+	 */
+	pthread_mutex_t goMut;
 
 	/**
 	 * Crossroad's lane choose by the user during interactive mode.
@@ -50,42 +103,102 @@
 	int laneUserChoice;
 
 	/**
-	 * Generate the cars/threads.
+	 * Generate the cars.
 	 * 
-	 * Allow waiting cars to go when the traffic light is green. Waits for
-	 * the last one to finish before signaling the parent process.
+	 * Each car is a sequence of tasks run by a fixed pool of worker threads.
+	 * Allow waiting cars to go when the traffic light is green, as notified
+	 * through the channel. Waits for the last one to pass before raising the
+	 * end flag. The cars arrive as drawn by the demand, or as scheduled by a
+	 * scenario until its schedule ends.
 	 * 
 	 * @param nbCars the number of cars to be generated
 	 * @param timelapseNewCars the maximum waiting time before a new car appear
+	 * @param saturationFlow the number of cars released per hour of green light
+	 * @param scenario the schedule of the arrivals (0: the arrivals are drawn)
 	 * 
 	 * @return	0 if success, a specific number if an error occured
 	 */
-	int generate_cars (int nbCars, int timelapseNewCars);
+	int generate_cars (int nbCars, int timelapseNewCars, int saturationFlow, Scenario * scenario);
+
+	/**
+	 * Run a task of the pool: a step of a car, or the release of a lane.
+	 * 
+	 * @param task the task to run
+	 */
+	void cars_run_task (Event * task);
 
 	/**
-	 * Simulates the behavior of a car.
+	 * Simulates the behavior of a car, one step at a time.
 	 * 
 	 * This function checks whether or not the conditions allow to pass or not,
-	 * and acts accordingly. 
+	 * and acts accordingly: the passage is scheduled, or the car joins the
+	 * queue of its lane until the light goes green.
 	 * 
-	 * @param i The number of the car/thread
+	 * @param step the task: the car's number and the step to run
+	 */
+	void driving_car (Event * step);
+
+	/**
+	 * Release the cars waiting on a green lane, in their order of arrival,
+	 * at the saturation flow.
 	 * 
-	 * @return the id of the thread 
+	 * @param lane the lane's number
 	 */
-	void * driving_car (void * i);
+	void lane_discharge (int lane);
 
 	/**
-	 * Unlock the cars/threads waiting at a traffic light.
+	 * Choose the lane on which a new car arrives: the user's choice in
+	 * interactive mode, a random lane in automatic mode. The lane is drawn
+	 * in both modes, so that the next draws of the car do not depend on it.
 	 * 
-	 * @param sigNum the signal associated to the calling function
+	 * @param rng the stream of the car
+	 * 
+	 * @return the lane's number
 	 */
-	void cars_toggle_go (int sigNum);
+	int car_choose_lane (Rng * rng);
+
+	/**
+	 * Draw the time it takes for a car to pass the traffic light.
+	 * 
+	 * @param rng the stream of the car
+	 * 
+	 * @return the delay in microseconds
+	 */
+	long car_pass_delay (Rng * rng);
+
+	/**
+	 * Unlock the cars waiting at a traffic light.
+	 * Only the queue of the lane going green is woken up.
+	 * 
+	 * @param lane the lane going green
+	 */
+	void cars_release (int lane);
 
 	/**
 	 * Update the lane on which the new generated cars/threads must arrive.
 	 * 
-	 * @param sigNum the signal associated to the calling function
+	 * @param lane the lane chosen by the user
+	 */
+	void lane_switch (int lane);
+
+	/**
+	 * Change the rate of the arrivals of the new cars, as asked by the user.
+	 * 
+	 * @param rate the factor of the rate of the demand, in NOTICE_RATE_UNIT
+	 */
+	void cars_rate (int rate);
+
+	/**
+	 * Stop or start again the arrivals of the new cars, as asked by the user.
+	 * The cars already due within the lookahead still arrive.
+	 * 
+	 * @param pause 1 to stop the arrivals, 0 to start them again
+	 */
+	void cars_pause (int pause);
+
+	/**
+	 * Print the counters of the cars, as asked by the user.
 	 */
-	void lane_toggle_switch (int sigNum);
+	void cars_status ();
 
 #endif
\ No newline at end of file
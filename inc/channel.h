@@ -0,0 +1,159 @@
+/**
+ *
+ * @file channel.h
+ * Notices sent to the process of the cars.
+ *
+ * This file declares the channel through which the junction and the user's
+ * commands (@see command.h) notify the process of the cars. A notice is a
+ * record of fixed size, written in place in a slot of a shared ring (@see
+ * ipcTools.h): each one is delivered once and in order, however fast they
+ * come, and none is merged with another as signals would be. A full ring
+ * blocks the sender until the receiver catches up, so the backlog stays
+ * bounded.
+ *
+ * In the process of the cars, a dispatcher thread reads the notices in
+ * batches and runs their actions as any other thread: nothing runs in
+ * signal context. Each notice carries its date of sending, which gives
+ * the latency of the notification once received.
+ *
+ * @version 1.0
+ *
+ * ********************************************************* */
+#ifndef __channel_H
+	#define __channel_H
+
+	/**
+	 * Call the shared rings.
+	 */
+	#include "../inc/ipcTools.h"
+
+	/**
+	 * Number of notices a channel holds before the senders wait.
+	 */
+	#define CHANNEL_CAPACITY 1024
+
+	/**
+	 * Maximum number of notices read at once.
+	 */
+	#define CHANNEL_BATCH 64
+
+	/**
+	 * Notice: a lane goes green, its waiting cars can be released.
+	 */
+	#define NOTICE_RELEASE 0
+
+	/**
+	 * Notice: the user chose the lane of the new cars.
+	 */
+	#define NOTICE_LANE 1
+
+	/**
+	 * Notice: the receiver stops reading.
+	 */
+	#define NOTICE_STOP 2
+
+	/**
+	 * Notice: the user changed the rate of the arrivals (the value is the
+	 * factor of the rate, in NOTICE_RATE_UNIT).
+	 */
+	#define NOTICE_RATE 3
+
+	/**
+	 * Notice: the user stopped the arrivals of the new cars.
+	 */
+	#define NOTICE_PAUSE 4
+
+	/**
+	 * Notice: the user started the arrivals of the new cars again.
+	 */
+	#define NOTICE_RESUME 5
+
+	/**
+	 * Notice: the user asked for the counters of the cars.
+	 */
+	#define NOTICE_STATS 6
+
+	/**
+	 * Unit of the factor of a rate notice: a thousandth.
+	 */
+	#define NOTICE_RATE_UNIT 1000
+
+	/**
+	 * A notice.
+	 *
+	 * @param type the kind of notice (NOTICE_*)
+	 * @param lane the lane concerned, or the value of a command
+	 * @param date the monotonic date of sending in microseconds
+	 */
+	typedef struct {
+		int type;
+		int lane;
+		long date;
+	} Notice;
+
+	/**
+	 * A channel of notices, shared by the processes forked after its opening.
+	 *
+	 * @param ring the ring holding the notices
+	 */
+	typedef struct {
+		Ring * ring;
+	} Channel;
+
+	/**
+	 * Open a channel. Every process forked afterwards can send and receive.
+	 *
+	 * @param channel the channel to open
+	 *
+	 * @return 0 if success, -1 otherwise
+	 */
+	int channel_open (Channel * channel);
+
+	/**
+	 * Close a channel in the calling process.
+	 *
+	 * @param channel the channel to close
+	 */
+	void channel_close (Channel * channel);
+
+	/**
+	 * Send a notice, waiting for room if the channel is full.
+	 *
+	 * @param channel the channel
+	 * @param type the kind of notice
+	 * @param lane the lane concerned, or the value of a command
+	 *
+	 * @return 0 if success, -1 otherwise
+	 */
+	int channel_send (Channel * channel, int type, int lane);
+
+	/**
+	 * Wait for the next notices, to be read in place. Only one thread of
+	 * one process receives.
+	 *
+	 * @param channel the channel
+	 * @param notices the notices received, in their order of sending
+	 * @param max the maximum number of notices
+	 *
+	 * @return the number of notices, at least 1
+	 */
+	int channel_receive (Channel * channel, Notice ** notices, int max);
+
+	/**
+	 * Give back the room of the notices read.
+	 *
+	 * @param channel the channel
+	 * @param n the number of notices given by channel_receive
+	 */
+	void channel_release (Channel * channel, int n);
+
+	/**
+	 * Give the time a notice took to be received.
+	 *
+	 * @param notice the notice received
+	 *
+	 * @return the latency in microseconds
+	 */
+	long channel_latency (Notice * notice);
+
+#endif
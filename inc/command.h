@@ -0,0 +1,76 @@
+/**
+ *
+ * @file command.h
+ * Commands of the user, from the terminal or from a script.
+ *
+ * This file declares the role reading the commands of a real time or
+ * interactive simulation, one per line, the text following a '#' being a
+ * comment:
+ * 		- 1, 2 or lane N: the lane of the new cars (interactive mode)
+ * 		- rate F: the arrivals of the new cars at F times their rate
+ * 		- pause, resume: stop and start again the arrivals of the new cars
+ * 		- stats: print the counters of the cars
+ * The input is the terminal, a file or a FIFO, watched with poll: the role
+ * never blocks on it and sees the end of the simulation. Each command is a
+ * notice sent to the process of the cars through the channel (@see
+ * channel.h), which makes the role wait rather than drop a command when
+ * it is full: a script issues as many commands as it likes.
+ *
+ * @see channel.h
+ * @version 1.0
+ *
+ * ********************************************************* */
+#ifndef __command_H
+	#define __command_H
+
+	/**
+	 * Call the shared variables and the channel of the notices.
+	 */
+	#include "../inc/crossroads.h"
+
+	/**
+	 * Size of the buffer of the input, the longest line it holds.
+	 */
+	#define COMMAND_BUFFER_SIZE 4096
+
+	/**
+	 * Maximum time waited for the input before looking at the end flag, in
+	 * milliseconds.
+	 */
+	#define COMMAND_POLL_TIME 100
+
+	/**
+	 * Highest factor of the rate of the arrivals.
+	 */
+	#define COMMAND_MAX_RATE 1000
+
+	/**
+	 * Open the input of the commands. A FIFO is opened for writing as well:
+	 * the scripts writing into it may come and go, the input never ends.
+	 *
+	 * @param path the name of the file or of the FIFO (0: the terminal)
+	 *
+	 * @return the file descriptor, -1 if the file could not be opened
+	 */
+	int command_open (char * path);
+
+	/**
+	 * Read a command.
+	 *
+	 * @param line the line holding the command, its comment is cut off
+	 * @param type the kind of notice sent for the command
+	 * @param value the value of the notice (@see Notice)
+	 *
+	 * @return 1 if a command is read, 0 if the line is blank, -1 if invalid
+	 */
+	int command_parse (char * line, int * type, int * value);
+
+	/**
+	 * Run the commands of the input, until its end or the end of the
+	 * simulation.
+	 *
+	 * @param input the file descriptor of the input
+	 */
+	void command_loop (int input);
+
+#endif
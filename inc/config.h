@@ -15,12 +15,48 @@
 	#define __config_H
 
 	#include <string.h>
+	#include <getopt.h>
 
 	/**
 	 * Call global parameters.
 	 */
 	#include "../inc/param.h"
 
+	/**
+	 * Call the backends of the semaphores.
+	 */
+	#include "../inc/ipcTools.h"
+
+	/**
+	 * Call the parameter sweep.
+	 */
+	#include "../inc/batch.h"
+
+	/**
+	 * Call the policies of the traffic lights.
+	 */
+	#include "../inc/controller.h"
+
+	/**
+	 * Call the seed of the random streams.
+	 */
+	#include "../inc/rng.h"
+
+	/**
+	 * Call the scenario files.
+	 */
+	#include "../inc/scenario.h"
+
+	/**
+	 * Call the models of the arrivals.
+	 */
+	#include "../inc/demand.h"
+
+	/**
+	 * Call the ways of running the roles.
+	 */
+	#include "../inc/roles.h"
+
 	/**
 	 * Extern variable used to retrieve the command line arguments.
 	 */
@@ -49,6 +85,103 @@
 	 */
 	int nbMaxCars;
 
+	/**
+	 * Environment variable which specified the maximum number of cars
+	 * released per hour of green light on a lane (0: no limit).
+	 */
+	int saturationFlow;
+
+	/**
+	 * Environment variable which specified the backend of the semaphores
+	 * (@see IPC_BACKEND_SYSV).
+	 */
+	int syncBackend;
+
+	/**
+	 * Environment variable which specified the topology file of a road
+	 * network (0: the single junction).
+	 */
+	char * networkFile;
+
+	/**
+	 * Environment variable which specified the file receiving the
+	 * statistics at the end of the simulation (0: none).
+	 */
+	char * statsFile;
+
+	/**
+	 * Environment variable which specified the file receiving the trace
+	 * of the simulation (0: none).
+	 */
+	char * traceFile;
+
+	/**
+	 * Environment variable which specified the file receiving the
+	 * recording of the simulation (0: none).
+	 */
+	char * recordFile;
+
+	/**
+	 * Environment variable which specified the file or FIFO of the user's
+	 * commands (0: the terminal, in interactive mode only).
+	 */
+	char * commandFile;
+
+	/**
+	 * Environment variable which specified the scenario file replayed by
+	 * the simulation (0: the arrivals are drawn).
+	 */
+	char * scenarioFile;
+
+	/**
+	 * Environment variable holding the scenario being replayed.
+	 */
+	Scenario scenario;
+
+	/**
+	 * Environment variable set to run a parameter sweep (@see batch.h).
+	 */
+	int batchMode;
+
+	/**
+	 * Environment variables which specified the swept values of
+	 * timeSwitchWay, timelapseNewCars and nbMaxCars.
+	 */
+	BatchRange sweepSwitchTimes, sweepTimelapses, sweepNbCars;
+
+	/**
+	 * Environment variable which specified the number of replications of
+	 * each configuration of a sweep.
+	 */
+	int batchRuns;
+
+	/**
+	 * Environment variable which specified the number of worker processes
+	 * of a sweep (0: one per online core).
+	 */
+	int batchJobs;
+
+	/**
+	 * Values returned by getopt for the options which only have a long name.
+	 */
+	#define OPT_SYNC 256
+	#define OPT_SWEEP_T 257
+	#define OPT_SWEEP_A 258
+	#define OPT_SWEEP_N 259
+	#define OPT_RUNS 260
+	#define OPT_JOBS 261
+	#define OPT_REAP 262
+	#define OPT_SEED 263
+	#define OPT_DEMAND 264
+	#define OPT_RATES 265
+	#define OPT_PROFILE 266
+	#define OPT_PLATOON 267
+	#define OPT_ROLES 268
+	#define OPT_TRACE 269
+	#define OPT_RECORD 270
+	#define OPT_REPLAY 271
+	#define OPT_COMMANDS 272
+
 	/**
 	 * 
 	 * Configure the program's environment from the information provided on
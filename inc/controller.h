@@ -0,0 +1,101 @@
+/**
+ *
+ * @file controller.h
+ * Policies deciding how long a traffic light stays green.
+ *
+ * This file declares the controllers of the junction. While a lane is
+ * green, its controller is asked again and again whether to keep it green,
+ * from the live state of the junction: the time elapsed since the light
+ * went green, the number of cars waiting on each lane and the arrivals on
+ * the green lane since the previous decision. The answer is the time to
+ * wait before asking again, or 0 to give the green light to the other lane.
+ *
+ * The policies are:
+ * 		- fixed: the light switches every timeSwitchWay (the original behaviour)
+ * 		- actuated: after a minimum green, the green is extended while cars
+ * 		  keep arriving or leaving on the green lane and some cars wait on
+ * 		  the red one, up to a maximum green
+ * 		- lqf: after a minimum green, the longest queue gets the green light,
+ * 		  up to a maximum green
+ * A new policy is a decision function added to the table of controller.c.
+ *
+ * @version 1.0
+ *
+ * ********************************************************* */
+#ifndef __controller_H
+	#define __controller_H
+
+	/**
+	 * Numbers of the policies.
+	 */
+	#define CTRL_FIXED 0
+	#define CTRL_ACTUATED 1
+	#define CTRL_LQF 2
+
+	/**
+	 * The minimum green of the adaptive policies is timeSwitchWay divided by this.
+	 */
+	#define CTRL_MIN_GREEN_DIVISOR 2
+
+	/**
+	 * The maximum green of the adaptive policies is timeSwitchWay multiplied by this.
+	 */
+	#define CTRL_MAX_GREEN_FACTOR 2
+
+	/**
+	 * The adaptive policies decide again every timeSwitchWay divided by this.
+	 */
+	#define CTRL_EXTENSION_DIVISOR 10
+
+	/**
+	 * The state of a junction seen by a controller.
+	 *
+	 * @param green the lane in green light
+	 * @param elapsed the time since the light went green in microseconds
+	 * @param queues the number of cars waiting on each lane
+	 * @param newArrivals the number of cars arrived on the green lane since the previous decision
+	 * @param greenTime the nominal green time (timeSwitchWay) in microseconds
+	 */
+	typedef struct {
+		int green;
+		long elapsed;
+		long queues[2];
+		long newArrivals;
+		long greenTime;
+	} JunctionView;
+
+	/**
+	 * The policy of the junctions (@see CTRL_FIXED).
+	 */
+	int controllerPolicy;
+
+	/**
+	 * Give the number of a policy.
+	 *
+	 * @param name the name of the policy
+	 *
+	 * @return the number of the policy, -1 if unknown
+	 */
+	int controller_policy (char * name);
+
+	/**
+	 * Give the name of a policy.
+	 *
+	 * @param policy the number of the policy
+	 *
+	 * @return the name of the policy
+	 */
+	char * controller_name (int policy);
+
+	/**
+	 * Decide whether the green lane stays green.
+	 *
+	 * @param policy the number of the policy
+	 * @param view the state of the junction
+	 *
+	 * @return the time to wait before the next decision in microseconds,
+	 * 		0 to give the green light to the other lane now
+	 */
+	long controller_decide (int policy, JunctionView * view);
+
+#endif
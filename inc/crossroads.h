@@ -8,6 +8,10 @@
  * 
  * @see param.h
  * @see ipcTools.h
+ * @see eventlog.h
+ * @see controller.h
+ * @see channel.h
+ * @see metrics.h
  * @version 9.1
  * 
  * ********************************************************* */
@@ -25,29 +29,45 @@
 	#include "../inc/ipcTools.h"
 
 	/**
-	 * Table of semaphores associated to each lane of the crossroad.
+	 * Call the asynchronous log of the events.
 	 */
-	int lane[2];
+	#include "../inc/eventlog.h"
 
 	/**
-	 * Semaphore associated to the red traffic light switching.
+	 * Call the policies of the traffic lights.
 	 */
-	int canAccess;
+	#include "../inc/controller.h"
+
+	/**
+	 * Call the channel of the notices sent to the cars.
+	 */
+	#include "../inc/channel.h"
+
+	/**
+	 * Call the live metrics, and the locks counting their waits.
+	 */
+	#include "../inc/metrics.h"
+
+	/**
+	 * Channel of the notices sent to the process of the cars.
+	 */
+	Channel notices;
 
 	/**
 	 * Manages the intersection.
 	 * 
 	 * Each lane of the crossroad is a processus. There are notify when the traffic
-	 * light change to red. At the end of the circulation, an end signal is send to
-	 * these processus.
-	 * 
-	 * @param timeSwitchWay the minimum waiting time before going to the green light
+	 * light change to red. The process of the cars is notified through the channel
+	 * when a lane goes green.
 	 */
-	void manage_junction (int timeSwitchWay);
+	void manage_junction ();
 
 	/**
 	 * Allow traffic on one lane.
 	 * Each lane of the crossroad use this function to to allow the passage of vehicles.
+	 * The light stays green as long as the controller decides so, from the
+	 * cars waiting and arriving on each lane. The phases follow planned
+	 * dates of the monotonic clock, the lateness of each switch being recorded.
 	 * 
 	 * @param i the lane's number
 	 * @param timeSwitchWay the minimum waiting time before going to the green light
@@ -55,16 +75,32 @@
 	void run_circulation (int i, int timeSwitchWay);
 	
 	/**
-	 * Simply update the user's lane selection.
+	 * Give the lane which goes to green after the given one.
+	 * Ensure shifting between the two lanes.
 	 * 
-	 * The information provided on the command line is analyzed at any time.
-	 * If the key entered is valid, the choice is saved and the car generator
-	 * is warned.
+	 * @param priority the lane currently in green light
+	 * 
+	 * @return the lane's number which goes to green next
 	 */
-	void user_lane_choice ();
-	
+	int crossroads_next_lane (int priority);
+
+	/**
+	 * Give the time between the release of two cars waiting on a green lane.
+	 * 
+	 * @param saturationFlow the number of cars released per hour (0: no limit)
+	 * 
+	 * @return the headway in microseconds, 0 to release all the cars at once
+	 */
+	long crossroads_headway (int saturationFlow);
+
+	/**
+	 * Raise the program's end flag, once the last car has passed.
+	 */
+	void crossroads_stop ();
+
 	/**
-	 * Toggle the program's end flag.
+	 * Raise the program's end flag on an interruption by the user.
+	 * Only async-signal-safe calls are made.
 	 * 
 	 * @param sigNum a signal associated to the end's flag
 	 */
@@ -0,0 +1,202 @@
+/**
+ *
+ * @file demand.h
+ * Models of the arrivals of the new cars.
+ *
+ * This file declares the demand of the simulation: the process which
+ * gives the date and the lane of each new car. The models are:
+ * 		- uniform: the delay before the next car is drawn below the
+ * 		  timelapse of option -a (the original behaviour); each car then
+ * 		  chooses its lane
+ * 		- poisson: the cars arrive at a constant rate, with exponential
+ * 		  delays between them
+ * 		- piecewise: a poisson demand whose rate follows a profile of the
+ * 		  day, one factor per period, repeated
+ * 		- platoon: the cars arrive in platoons, whose leaders follow a
+ * 		  poisson demand and whose followers come a short gap after them
+ * Apart from the uniform model, each lane (or each entry of a road network)
+ * may have its own rate; the lane of each car is drawn in proportion.
+ * Without rates, the demand has the mean rate of the uniform model and
+ * the cars choose their lane.
+ *
+ * The arrivals are drawn in batches from the stream of the arrivals
+ * (@see rng.h): the transforms of a batch run in tight loops over arrays,
+ * ahead of their consumption, so the generator costs a few nanoseconds per
+ * car whatever the rate. The same seed gives the same arrivals.
+ *
+ * @version 1.0
+ *
+ * ********************************************************* */
+#ifndef __demand_H
+	#define __demand_H
+
+	/**
+	 * Call the random streams.
+	 */
+	#include "../inc/rng.h"
+
+	/**
+	 * Numbers of the models.
+	 */
+	#define DEMAND_UNIFORM 0
+	#define DEMAND_POISSON 1
+	#define DEMAND_PIECEWISE 2
+	#define DEMAND_PLATOON 3
+
+	/**
+	 * Number of arrivals drawn at once.
+	 */
+	#define DEMAND_BATCH 256
+
+	/**
+	 * Maximum number of lanes with their own rate.
+	 */
+	#define DEMAND_MAX_LANES 64
+
+	/**
+	 * Maximum number of periods of a profile.
+	 */
+	#define DEMAND_MAX_PERIODS 96
+
+	/**
+	 * Default mean size of a platoon, and gap between its cars in microseconds.
+	 */
+	#define DEMAND_PLATOON_SIZE 4
+	#define DEMAND_PLATOON_GAP 2000000
+
+	/**
+	 * The settings of the demand.
+	 *
+	 * @param model the model of the arrivals (@see DEMAND_UNIFORM)
+	 * @param nbLanes the number of lanes with their own rate (0: the cars choose their lane)
+	 * @param rates the rate of each lane in cars per hour
+	 * @param nbPeriods the number of periods of the profile
+	 * @param period the duration of a period of the profile in microseconds
+	 * @param factors the factor of the rates during each period
+	 * @param platoonSize the mean number of cars of a platoon
+	 * @param platoonGap the mean gap between the cars of a platoon in microseconds
+	 */
+	typedef struct {
+		int model;
+		int nbLanes;
+		double rates[DEMAND_MAX_LANES];
+		int nbPeriods;
+		long period;
+		double factors[DEMAND_MAX_PERIODS];
+		double platoonSize;
+		long platoonGap;
+	} DemandModel;
+
+	/**
+	 * The arrivals of a simulation, drawn ahead.
+	 *
+	 * @param model the settings of the demand
+	 * @param rng the stream of the arrivals
+	 * @param timelapse the maximum delay of the uniform model
+	 * @param mean the mean delay between two cars in microseconds
+	 * @param cumul the cumulated share of the rate of each lane
+	 * @param clock the date of the last arrival drawn
+	 * @param platoonLeft the number of followers of the current platoon still to come
+	 * @param platoonLane the lane of the current platoon
+	 * @param dates the dates of the arrivals drawn
+	 * @param lanes the lanes of the arrivals drawn (-1: chosen by the car)
+	 * @param count the number of arrivals drawn
+	 * @param next the next arrival to give
+	 */
+	typedef struct {
+		DemandModel * model;
+		Rng * rng;
+		long timelapse;
+		double mean;
+		double cumul[DEMAND_MAX_LANES];
+		double clock;
+		long platoonLeft;
+		int platoonLane;
+		long dates[DEMAND_BATCH];
+		int lanes[DEMAND_BATCH];
+		int count;
+		int next;
+	} Demand;
+
+	/**
+	 * The demand of the simulation (--demand, --rates, --profile and --platoon options).
+	 */
+	DemandModel simuDemand;
+
+	/**
+	 * Set the default demand: uniform, without rates.
+	 *
+	 * @param model the settings to reset
+	 */
+	void demand_default (DemandModel * model);
+
+	/**
+	 * Give the number of a model.
+	 *
+	 * @param name the name of the model
+	 *
+	 * @return the number of the model, -1 if unknown
+	 */
+	int demand_model (char * name);
+
+	/**
+	 * Give the name of a model.
+	 *
+	 * @param model the number of the model
+	 *
+	 * @return the name of the model
+	 */
+	char * demand_name (int model);
+
+	/**
+	 * Read the rates of the lanes, "R1,R2,..." in cars per hour.
+	 *
+	 * @param model the settings receiving the rates
+	 * @param text the list of rates
+	 *
+	 * @return 0 if success, -1 if invalid
+	 */
+	int demand_parse_rates (DemandModel * model, char * text);
+
+	/**
+	 * Read a profile, "PERIOD:F1,F2,...": the duration of a period in
+	 * microseconds, then the factor of the rates during each period.
+	 *
+	 * @param model the settings receiving the profile
+	 * @param text the profile
+	 *
+	 * @return 0 if success, -1 if invalid
+	 */
+	int demand_parse_profile (DemandModel * model, char * text);
+
+	/**
+	 * Read the platoons, "SIZE[:GAP]": the mean number of cars of a platoon
+	 * and the mean gap between them in microseconds.
+	 *
+	 * @param model the settings receiving the platoons
+	 * @param text the platoons
+	 *
+	 * @return 0 if success, -1 if invalid
+	 */
+	int demand_parse_platoon (DemandModel * model, char * text);
+
+	/**
+	 * Start the arrivals of a simulation, from the date 0.
+	 *
+	 * @param demand the arrivals to start
+	 * @param model the settings of the demand
+	 * @param rng the stream of the arrivals, already seeded
+	 * @param timelapse the maximum delay of the uniform model in microseconds
+	 */
+	void demand_init (Demand * demand, DemandModel * model, Rng * rng, long timelapse);
+
+	/**
+	 * Give the next arrival, drawing a new batch when needed.
+	 *
+	 * @param demand the arrivals
+	 * @param date the date of the arrival in microseconds
+	 * @param lane the lane of the arrival, -1 if the car chooses it
+	 */
+	void demand_next (Demand * demand, long * date, int * lane);
+
+#endif
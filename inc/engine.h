@@ -0,0 +1,120 @@
+/**
+ *
+ * @file engine.h
+ * Discrete-event simulation of the crossroad driven by a virtual clock.
+ *
+ * This file declares the engine which replays the behaviour of the cars
+ * and of the junction without any real waiting: each arrival, light
+ * switch and car passage is a timestamped event, and the virtual clock
+ * jumps from one event to the next.
+ *
+ * @see param.h
+ * @see cars.h
+ * @see crossroads.h
+ * @see events.h
+ * @see network.h
+ * @see stats.h
+ * @see controller.h
+ * @see scenario.h
+ * @version 1.0
+ *
+ * ********************************************************* */
+#ifndef __engine_H
+	#define __engine_H
+
+	/**
+	 * Call global parameters.
+	 */
+	#include "../inc/param.h"
+
+	/**
+	 * Call the functions used to draw the cars' arrivals and passages.
+	 */
+	#include "../inc/cars.h"
+
+	/**
+	 * Call the functions used to switch the junction.
+	 */
+	#include "../inc/crossroads.h"
+
+	/**
+	 * Call the timestamped events and their priority queue.
+	 */
+	#include "../inc/events.h"
+
+	/**
+	 * Call the junctions and the roads of the simulated network.
+	 */
+	#include "../inc/network.h"
+
+	/**
+	 * Call the statistics of the simulation.
+	 */
+	#include "../inc/stats.h"
+
+	/**
+	 * Call the policies of the traffic lights.
+	 */
+	#include "../inc/controller.h"
+
+	/**
+	 * Call the schedules of arrivals of the scenario files.
+	 */
+	#include "../inc/scenario.h"
+
+	/**
+	 * The virtual clock in microseconds, the date of the event being handled.
+	 */
+	long virtualClock;
+
+	/**
+	 * Shortest green phase on the virtual clock, in microseconds. Without
+	 * it, a green time of 0 would switch the lights forever at the same date.
+	 */
+	#define ENGINE_MIN_GREEN 1000
+
+	/**
+	 * Summary of a simulation run by the engine.
+	 *
+	 * @param nbCars the number of cars which left the network
+	 * @param endTime the date of the last handled event in microseconds
+	 * @param nbStops the number of times a car stopped at a junction
+	 * @param totalWait the time spent waiting by all the cars in microseconds
+	 * @param maxWait the longest wait of a car at a junction in microseconds
+	 * @param maxQueue the largest number of cars waiting on a lane
+	 */
+	typedef struct {
+		long nbCars;
+		long endTime;
+		long nbStops;
+		long totalWait;
+		long maxWait;
+		long maxQueue;
+	} EngineResult;
+
+	/**
+	 * Run the whole simulation on the virtual clock.
+	 *
+	 * The cars arrive, wait and pass exactly as with the processes and the
+	 * threads, but the delays are not slept: the engine handles the events
+	 * in chronological order until the last car has left the network. A car
+	 * passing a junction drives to the next one along the road of its lane.
+	 * The new cars arrive as drawn by the demand (@see demand.h), or as
+	 * scheduled by a scenario, until its schedule ends. The draws follow the
+	 * seed: the same seed gives the same run.
+	 *
+	 * @param network the junctions and the roads
+	 * @param nbCars the number of cars to be generated
+	 * @param timelapseNewCars the maximum waiting time before a new car appear
+	 * @param saturationFlow the number of cars released per hour of green light
+	 * @param scenario the schedule of the arrivals, read from its current
+	 * 		arrival (0: the arrivals are drawn)
+	 * @param seed the seed of the random streams
+	 * @param result the summary of the run, filled if not null
+	 *
+	 * @return 0 if success, a specific number if an error occured
+	 */
+	int run_engine (Network * network, int nbCars, int timelapseNewCars, int saturationFlow,
+		Scenario * scenario, unsigned long seed, EngineResult * result);
+
+#endif
@@ -0,0 +1,152 @@
+/**
+ *
+ * @file eventlog.h
+ * Asynchronous log of the simulation's events.
+ *
+ * This file declares the log used by the cars and the junction instead of
+ * printing directly. A log entry is a fixed-size binary record pushed in a
+ * lock-free ring buffer; a dedicated writer thread formats the records and
+ * flushes them in batches. Producers never block: when the ring is full,
+ * the record is dropped and counted. The writer also writes the trace of
+ * the simulation and its recording, if asked (@see trace.h, record.h).
+ *
+ * @version 1.0
+ *
+ * ********************************************************* */
+#ifndef __eventlog_H
+	#define __eventlog_H
+
+	#include <pthread.h>
+	#include <stdatomic.h>
+
+	/**
+	 * Number of records of the ring buffer (must be a power of two).
+	 */
+	#define LOG_RING_SIZE 65536
+
+	/**
+	 * Maximum number of records formatted and flushed at once.
+	 */
+	#define LOG_BATCH_SIZE 256
+
+	/**
+	 * Time slept by the writer thread when the ring is empty, in microseconds.
+	 */
+	#define LOG_IDLE_TIME 1000
+
+	/**
+	 * Kind of logged events:
+	 * 		0) a car arrives on a lane
+	 * 		1) a car stops at a red light
+	 * 		2) the number of cars waiting (value)
+	 * 		3) a car has passed
+	 * 		4) no more car will arrive
+	 * 		5) a traffic light goes red
+	 * 		6) a traffic light goes green
+	 * 		7) the number of cars released on a lane (value)
+	 * 		8) the user chose a lane for the new cars
+	 */
+	typedef enum {
+		LOG_CAR_ARRIVAL,
+		LOG_CAR_WAITING,
+		LOG_CARS_WAITING,
+		LOG_CAR_PASSED,
+		LOG_NO_MORE_CARS,
+		LOG_LIGHT_RED,
+		LOG_LIGHT_GREEN,
+		LOG_CARS_RELEASED,
+		LOG_LANE_COMMAND,
+		LOG_NB_TYPES
+	} LogType;
+
+	/**
+	 * A log record.
+	 *
+	 * @param time the date of the event in microseconds since the start
+	 * @param stamp the date of the event when logged, for the trace and the
+	 * 		recording (@see log_origin)
+	 * @param car the number of the car concerned by the event
+	 * @param value a number attached to the event (a count of cars)
+	 * @param lane the lane concerned by the event
+	 * @param junction the junction concerned by the event (-1: the only one)
+	 * @param type the kind of event
+	 */
+	typedef struct {
+		long time;
+		long stamp;
+		long car;
+		long value;
+		int lane;
+		int junction;
+		int type;
+	} LogRecord;
+
+	/**
+	 * A slot of the ring buffer.
+	 *
+	 * @param seq the sequence number telling whether the slot is free or filled
+	 * @param record the stored record
+	 */
+	typedef struct {
+		atomic_long seq;
+		LogRecord record;
+	} LogSlot;
+
+	/**
+	 * Stamp the records with the monotonic clock from now on: in real time,
+	 * each role dates its events from its own start, the stamps share this
+	 * origin. Called before the roles start; otherwise, the stamp of a
+	 * record is its date (virtual clock).
+	 */
+	void log_origin ();
+
+	/**
+	 * Start the log of the calling process, and its writer thread.
+	 * Must be called again in a forked process, and after the trace and the
+	 * recording are open. The entries of the recording dropped with their
+	 * records are counted in it when the log is closed.
+	 *
+	 * @param quiet if set, the records are only counted, never printed
+	 * @param lossless if set, a producer finding the ring full yields until the
+	 * 		writer frees a slot (for the virtual clock, where nothing is late)
+	 *
+	 * @return 0 if success, -1 otherwise
+	 */
+	int log_init (int quiet, int lossless);
+
+	/**
+	 * Log an event (lock-free, never blocks).
+	 *
+	 * @param type the kind of event
+	 * @param time the date of the event in microseconds since the start
+	 * @param car the number of the car concerned by the event
+	 * @param lane the lane concerned by the event
+	 * @param value a number attached to the event
+	 */
+	void log_event (LogType type, long time, long car, int lane, long value);
+
+	/**
+	 * Log an event of a junction of a road network (lock-free, never blocks).
+	 *
+	 * @param type the kind of event
+	 * @param time the date of the event in microseconds since the start
+	 * @param junction the junction concerned by the event (-1: the only one)
+	 * @param car the number of the car concerned by the event
+	 * @param lane the lane concerned by the event
+	 * @param value a number attached to the event
+	 */
+	void log_junction_event (LogType type, long time, int junction, long car, int lane, long value);
+
+	/**
+	 * Wait until the writer has printed all the records logged so far.
+	 * Used before printing directly on the standard output.
+	 */
+	void log_flush ();
+
+	/**
+	 * Flush the pending records, stop the writer thread, close the trace and
+	 * the recording and, in quiet mode, print the number of events of each kind.
+	 */
+	void log_close ();
+
+#endif
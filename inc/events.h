@@ -0,0 +1,138 @@
+/**
+ *
+ * @file events.h
+ * Timestamped events and the priority queue ordering them.
+ *
+ * This file declares the events exchanged by the simulation (arrivals,
+ * passages, light switches) and a binary min-heap handling them in
+ * chronological order. Events with the same date keep their insertion order.
+ *
+ * @version 1.0
+ *
+ * ********************************************************* */
+#ifndef __events_H
+	#define __events_H
+
+	/**
+	 * Call the random streams of the cars.
+	 */
+	#include "../inc/rng.h"
+
+	/**
+	 * Used as the default capacity of the event queue (grows on demand).
+	 */
+	#define DEFAULT_EVENT_CAPACITY 64
+
+	/**
+	 * Kind of events handled by the engine:
+	 * 		0) a car arrives at a junction
+	 * 		1) a car has passed the traffic light
+	 * 		2) the traffic lights switch
+	 * 		3) the next car waiting on a green lane is released
+	 * 		4) the controller decides whether the green lane stays green
+	 */
+	typedef enum {
+		EV_CAR_ARRIVAL,
+		EV_CAR_PASSED,
+		EV_LIGHT_SWITCH,
+		EV_LANE_DISCHARGE,
+		EV_LIGHT_CHECK
+	} EventType;
+
+	/**
+	 * A car, carried by its events and by its lane queue from one step to
+	 * the next: nothing is kept per car beyond the cars in flight.
+	 *
+	 * @param id the number of the car
+	 * @param arrival the date of its arrival at the traffic light it waits for
+	 * @param rng the stream of the draws of the car, seeded on its arrival
+	 */
+	typedef struct {
+		long id;
+		long arrival;
+		Rng rng;
+	} Car;
+
+	/**
+	 * A timestamped event.
+	 *
+	 * @param time the date of the event in microseconds (virtual or monotonic clock)
+	 * @param seq the insertion order, used to keep simultaneous events in FIFO order
+	 * @param type the kind of event
+	 * @param car the car concerned by the event
+	 * @param lane the lane concerned by the event (for the engine, an approach
+	 * 		of the network, @see network.h)
+	 */
+	typedef struct {
+		long time;
+		long seq;
+		EventType type;
+		Car car;
+		int lane;
+	} Event;
+
+	/**
+	 * Priority queue of events (binary min-heap ordered by date).
+	 *
+	 * @param events the heap's storage
+	 * @param size the number of pending events
+	 * @param capacity the number of allocated events
+	 * @param seq the next insertion number
+	 */
+	typedef struct {
+		Event * events;
+		long size;
+		long capacity;
+		long seq;
+	} EventQueue;
+
+	/**
+	 * Allocate an empty event queue.
+	 *
+	 * @param queue the queue to initialize
+	 * @param capacity the initial number of events which can be stored
+	 *
+	 * @return 0 if success, -1 otherwise
+	 */
+	int evq_init (EventQueue * queue, long capacity);
+
+	/**
+	 * Release the storage of an event queue.
+	 *
+	 * @param queue the queue to destroy
+	 */
+	void evq_free (EventQueue * queue);
+
+	/**
+	 * Insert an event in the queue.
+	 *
+	 * @param queue the event queue
+	 * @param time the date of the event
+	 * @param type the kind of event
+	 * @param car the car concerned by the event (0: none)
+	 * @param lane the lane concerned by the event
+	 *
+	 * @return 0 if success, -1 otherwise
+	 */
+	int evq_push (EventQueue * queue, long time, EventType type, Car * car, int lane);
+
+	/**
+	 * Remove the earliest event from the queue.
+	 *
+	 * @param queue the event queue
+	 * @param event the removed event
+	 *
+	 * @return 1 if an event is returned, 0 if the queue is empty
+	 */
+	int evq_pop (EventQueue * queue, Event * event);
+
+	/**
+	 * Give the earliest event of the queue without removing it.
+	 *
+	 * @param queue the event queue
+	 *
+	 * @return the earliest event, 0 if the queue is empty
+	 */
+	Event * evq_peek (EventQueue * queue);
+
+#endif
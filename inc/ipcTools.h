@@ -1,11 +1,11 @@
 /**
  * 
  * @file ipcTools.h
- * Shared memory segments, semaphores and message queues
+ * Shared memory segments, semaphores and message rings
  * for collaborative processes synchronization.
  * 
  * This file declares high level functions to allocate and
- * de-allocate shared memory, semaphores and message queues.
+ * de-allocate shared memory, semaphores and message rings.
  * 
  * ********************************************************* */
 #ifndef __ipcTools_H
@@ -15,13 +15,23 @@
 	#include <sys/ipc.h>
 	#include <sys/sem.h>
 	#include <sys/shm.h>
-	#include <sys/msg.h>
 
 	/**
 	 * Used as the default pathname to generate a System V IPC key.
 	 */
 	#define DEFAULT_PRJT_PATH "./etc/password/"
 
+	/**
+	 * Used as the directory of the files of the program.
+	 */
+	#define DEFAULT_ETC_PATH "./etc/"
+
+	/**
+	 * Used as the directory recording the semaphores of the running
+	 * instances, one file per instance named after its process id.
+	 */
+	#define DEFAULT_INSTANCES_PATH "./etc/instances/"
+
 	/**
 	 * Used as the default project id to generate a System V IPC key.
 	 */
@@ -33,9 +43,23 @@
 	#define DEFAULT_SEM_VAL_INIT 0
 
 	/**
-	 * The maximum size of a message (buffer statically allocated).
+	 * Semaphores backends:
+	 * 		0) System V semaphores, one semop system call per operation
+	 * 		1) futex words in a shared anonymous mapping, the uncontended
+	 * 		   operations never enter the kernel
+	 * 		2) futex words in the memory of the process, for roles run as
+	 * 		   threads of a single process: the shared memory areas and the
+	 * 		   rings are private as well, and the kernel skips the lookup of
+	 * 		   the shared futexes
 	 */
-	#define MAX_MSG_SIZE 1024
+	#define IPC_BACKEND_SYSV 0
+	#define IPC_BACKEND_FUTEX 1
+	#define IPC_BACKEND_PRIVATE 2
+
+	/**
+	 * The maximum number of semaphores allocated with the futex backend.
+	 */
+	#define MAX_FUTEX_SEM 64
 
 	/**
 	 * Generate a System V IPC key from a file specified by a file path
@@ -50,9 +74,108 @@
 	key_t convertkey (char * path, int prjt_id);
 
 	/**
-	 * Allocate a semaphore.
+	 * Select the backend of the semaphores (@see IPC_BACKEND_SYSV).
+	 * Must be called before allocating any semaphore, shared memory area or
+	 * ring; the futex backend must be selected before forking the processes
+	 * sharing the semaphores, and the private one shares nothing with them.
+	 * 
+	 * @param backend the backend's number
+	 * 
+	 * @return 0 if success, -1 otherwise
+	 */
+	int ipcbackend (int backend);
+
+	/**
+	 * A set of semaphores allocated at once: a single System V set, or
+	 * consecutive slots of the table of the futex backend. A semaphore of
+	 * the set is given by its number in the set.
+	 * 
+	 * @param id the System V id of the set, or its first slot
+	 * @param nbSems the number of semaphores
+	 */
+	typedef struct {
+		int id;
+		int nbSems;
+	} SemSet;
+
+	/**
+	 * Allocate a set of semaphores at once.
+	 * If a set is already associated with the given key, it is simply
+	 * returned (not reallocated). With the System V backend, the set is a
+	 * single semget, all the values being set by a single semctl.
+	 * 
+	 * @param set the set to initialize
+	 * @param key the key associated with the set
+	 * @param nbSems the number of semaphores of the set
+	 * @param values the initial value of each semaphore (0: DEFAULT_SEM_VAL_INIT)
+	 * 
+	 * @return 0 if success, -1 otherwise
+	 */
+	int semsetalloc (SemSet * set, key_t key, int nbSems, unsigned short * values);
+
+	/**
+	 * Destroy a set of semaphores, all its semaphores at once.
+	 * 
+	 * @param set the set
+	 * 
+	 * @return 0 if success, -1 otherwise
+	 */
+	int semsetfree (SemSet * set);
+
+	/**
+	 * Block on a semaphore of a set.
+	 * 
+	 * @param set the set
+	 * @param sem the number of the semaphore in the set
+	 */
+	void Pset (SemSet * set, int sem);
+
+	/**
+	 * Take a semaphore of a set if it is free, without blocking.
+	 * 
+	 * @param set the set
+	 * @param sem the number of the semaphore in the set
+	 * 
+	 * @return 0 if taken, -1 if it would block
+	 */
+	int Ptryset (SemSet * set, int sem);
+
+	/**
+	 * Unlock a semaphore of a set.
+	 * 
+	 * @param set the set
+	 * @param sem the number of the semaphore in the set
+	 */
+	void Vset (SemSet * set, int sem);
+
+	/**
+	 * Block on several semaphores of a set.
+	 * With the System V backend, they are all taken at once by a single
+	 * semop, or none while one of them is zero. With the futex backends, they
+	 * are taken one after the other, in the given order: all the callers must
+	 * give them in the same order (the increasing one).
+	 * 
+	 * @param set the set
+	 * @param sems the numbers of the semaphores in the set
+	 * @param n the number of semaphores
+	 */
+	void Pmulti (SemSet * set, int * sems, int n);
+
+	/**
+	 * Unlock several semaphores of a set, with a single semop on the System V
+	 * backend.
+	 * 
+	 * @param set the set
+	 * @param sems the numbers of the semaphores in the set
+	 * @param n the number of semaphores
+	 */
+	void Vmulti (SemSet * set, int * sems, int n);
+
+	/**
+	 * Allocate a semaphore: a set of one semaphore, whose id is the one of the set.
 	 * If a semaphore is already associated with the given key, it is
-	 * simply returned (not reallocated).
+	 * simply returned (not reallocated). With the futex backend, the id is
+	 * a slot of the shared table of semaphores.
 	 * 
 	 * @param key the key associated with the semaphore
 	 * @param valInit the initial value of the semaphore
@@ -77,6 +200,15 @@
 	 */
 	void P (int semid);
 
+	/**
+	 * Take a semaphore if it is free, without blocking.
+	 * 
+	 * @param semid the semaphore's id
+	 * 
+	 * @return 0 if taken, -1 if it would block
+	 */
+	int Ptry (int semid);
+
 	/**
 	 * Unlock a semaphore.
 	 * 
@@ -88,6 +220,9 @@
 	 * Allocate a shared memory area.
 	 * If a shared memory is already allocated with the specified key,
 	 * its address will be returned and not reallocated.
+	 * A private area is destroyed by the system as soon as the last process
+	 * attached to it (the caller and its forked children) detaches or ends;
+	 * with the private backend, it is only mapped in the calling process.
 	 * 
 	 * @param key the key associated with the shared memory
 	 * @param size the size of the memory segment
@@ -108,46 +243,136 @@
 	int shmfree (key_t key);
 
 	/**
-	 * Allocate a message queue.
-	 * If a message queue is already associated with the given key,
-	 * the existing id is returned (not reallocated).
+	 * Record the running instance and its System V semaphores, so that they
+	 * can be destroyed by ipcreap if the instance is killed.
+	 * The futex semaphores live in an anonymous mapping: they are not recorded.
 	 * 
-	 * @param key the key associated with the message queue
+	 * @param semids the ids of the semaphores
+	 * @param nbSems the number of semaphores
 	 * 
-	 * @return the associated id of the message queue, -1 otherwise
+	 * @return 0 if success, -1 otherwise
 	 */
-	int msgalloc (key_t key);
+	int ipcregister (int * semids, int nbSems);
 
 	/**
-	 * Destroy the message queue associated with the given id.
+	 * Record another object of the running instance, for the tools which
+	 * look at it (@see ipclookup). The reaper leaves these objects alone.
 	 * 
-	 * @param msgqid the id associated with the message queue.
+	 * @param kind the kind of the object, a single word
+	 * @param id the id of the object
 	 * 
 	 * @return 0 if success, -1 otherwise
 	 */
-	int msgfree (int msgqid);
+	int ipcpublish (char * kind, int id);
 
 	/**
-	 * Send a message in a message queue with the specified id in input.
+	 * Give the running instances recorded in the registry.
+	 * 
+	 * @param pids the process ids of the instances
+	 * @param max the maximum number of instances
 	 * 
-	 * @param msgqid the id associated with the message queue.
-	 * @param msg the sended message in the message queue
-	 * @param size the size of the message
+	 * @return the number of instances, -1 if the registry can not be read
+	 */
+	int ipcinstances (int * pids, int max);
+
+	/**
+	 * Give the id of an object recorded by an instance.
+	 * 
+	 * @param pid the process id of the instance
+	 * @param kind the kind of the object
+	 * 
+	 * @return the id of the object, -1 if it is not recorded
+	 */
+	int ipclookup (int pid, char * kind);
+
+	/**
+	 * Forget the semaphores recorded by ipcregister. Must be called before
+	 * destroying them: once destroyed, their ids may be given to another
+	 * instance, which ipcreap must never touch.
 	 * 
 	 * @return 0 if success, -1 otherwise
 	 */
-	int msgsend (int msgqid, char * msg, int size);
+	int ipcunregister ();
+
+	/**
+	 * Destroy the semaphores left by the instances which ended without
+	 * cleaning up (killed or crashed), then forget these instances.
+	 * The running instances are left untouched.
+	 * 
+	 * @return the number of reaped instances, -1 if the registry can not be read
+	 */
+	int ipcreap ();
+
+	/**
+	 * A ring of fixed-size slots in a shared anonymous mapping, through
+	 * which the forked processes pass records without any copy nor system
+	 * call while it is neither empty nor full: the producers write in the
+	 * slots they reserved, the single consumer reads in the slots before
+	 * releasing them. Several producers may reserve at once (MPSC).
+	 * The layout is private to ipcTools.c.
+	 */
+	typedef struct Ring Ring;
 
 	/**
-	 * Receive a message from a message queue with the corresponding id
-	 * specified as input.
+	 * Allocate a ring, shared with the processes forked afterwards (only
+	 * with the threads of the process with the private backend).
 	 * 
-	 * @param msgqid the id associated with the message queue.
-	 * @param msg the received message from the message queue
-	 * @param size the size of the message
+	 * @param slotSize the size of a record
+	 * @param nbSlots the number of slots, rounded up to a power of two
+	 * 
+	 * @return the ring if success, 0 otherwise
+	 */
+	Ring * ringalloc (int slotSize, int nbSlots);
+
+	/**
+	 * Unmap a ring in the calling process.
+	 * 
+	 * @param ring the ring
+	 * 
+	 * @return 0 if success, -1 otherwise
+	 */
+	int ringfree (Ring * ring);
+
+	/**
+	 * Reserve consecutive slots to write records in place, waiting for
+	 * the consumer to free them if the ring is full.
+	 * 
+	 * @param ring the ring
+	 * @param slots the addresses of the reserved slots
+	 * @param n the number of slots, at most the size of the ring
+	 * 
+	 * @return n if success, -1 otherwise
+	 */
+	int ringreserve (Ring * ring, void ** slots, int n);
+
+	/**
+	 * Publish the records written in reserved slots, waking the consumer
+	 * only if it sleeps.
+	 * 
+	 * @param ring the ring
+	 * @param slots the addresses given by ringreserve
+	 * @param n the number of slots
+	 */
+	void ringcommit (Ring * ring, void ** slots, int n);
+
+	/**
+	 * Wait for published records and give the slots holding them, in order,
+	 * to be read in place. Only the consumer calls it.
+	 * 
+	 * @param ring the ring
+	 * @param slots the addresses of the slots ready to be read
+	 * @param max the maximum number of slots
+	 * 
+	 * @return the number of slots, at least 1
+	 */
+	int ringpeek (Ring * ring, void ** slots, int max);
+
+	/**
+	 * Give back to the producers the first slots given by ringpeek.
 	 * 
-	 * @return the number of byte read if success, -1 otherwise
+	 * @param ring the ring
+	 * @param n the number of slots read
 	 */
-	int msgrecv (int msgqid, char * msg, int size);
+	void ringrelease (Ring * ring, int n);
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,84 @@
+/**
+ *
+ * @file lanequeue.h
+ * First-in first-out queue of the cars stopped on one lane.
+ *
+ * This file declares the queue in which the cars wait for the green light.
+ * Each lane owns its queue and its lock, so releasing one lane never
+ * wakes or blocks the cars of the other one, and the cars leave in their
+ * order of arrival.
+ *
+ * @version 1.0
+ *
+ * ********************************************************* */
+#ifndef __lanequeue_H
+	#define __lanequeue_H
+
+	#include <pthread.h>
+
+	/**
+	 * Call the cars carried by the queue.
+	 */
+	#include "../inc/events.h"
+
+	/**
+	 * Used as the initial capacity of a lane queue (grows on demand).
+	 */
+	#define DEFAULT_LANE_CAPACITY 64
+
+	/**
+	 * Queue of the cars waiting on a lane (growable ring buffer).
+	 *
+	 * @param cars the waiting cars
+	 * @param head the index of the first car in the ring
+	 * @param size the number of waiting cars
+	 * @param capacity the number of allocated slots
+	 * @param discharging set while the cars of the lane are being released
+	 * @param mut the mutex protecting the queue
+	 */
+	typedef struct {
+		Car * cars;
+		long head;
+		long size;
+		long capacity;
+		int discharging;
+		pthread_mutex_t mut;
+	} LaneQueue;
+
+	/**
+	 * Allocate an empty lane queue.
+	 *
+	 * @param queue the queue to initialize
+	 *
+	 * @return 0 if success, -1 otherwise
+	 */
+	int lq_init (LaneQueue * queue);
+
+	/**
+	 * Release the storage of a lane queue.
+	 *
+	 * @param queue the queue to destroy
+	 */
+	void lq_free (LaneQueue * queue);
+
+	/**
+	 * Add a car at the end of the queue.
+	 *
+	 * @param queue the lane queue
+	 * @param car the car
+	 *
+	 * @return 0 if success, -1 otherwise
+	 */
+	int lq_push (LaneQueue * queue, Car * car);
+
+	/**
+	 * Remove the first car of the queue.
+	 *
+	 * @param queue the lane queue
+	 * @param car the removed car
+	 *
+	 * @return 1 if a car is returned, 0 if the queue is empty
+	 */
+	int lq_pop (LaneQueue * queue, Car * car);
+
+#endif
@@ -6,6 +6,9 @@
  * @see config.h
  * @see crossroads.h
  * @see cars.h
+ * @see engine.h
+ * @see trace.h
+ * @see record.h
  * @version 9.4
  * 
  * ********************************************************* */
@@ -28,16 +31,50 @@
 	 */
 	#include "../inc/cars.h"
 
+	/**
+	 * Call the discrete-event engine used for automatic simulations.
+	 */
+	#include "../inc/engine.h"
+
+	/**
+	 * Call the trace of the simulation.
+	 */
+	#include "../inc/trace.h"
+
+	/**
+	 * Call the recording of the simulation.
+	 */
+	#include "../inc/record.h"
+
+	/**
+	 * Call the commands of the user.
+	 */
+	#include "../inc/command.h"
+
+	/**
+	 * Table of the roles of the simulation:
+	 * 		0)	Crossroad way one
+	 * 		1)	Crossroad way two
+	 * 		2)	Cars's manager
+	 * 		3)	User's command manager (interactive mode or script)
+	 */
+	Role roles[4];
+
+	/**
+	 * Print the statistics of the simulation and, if asked, export them.
+	 */
+	void main_report ();
+
 	/**
 	 * Destroy all semaphores, mutex or shared variables created
 	 * during program's execution.
 	 * Cleanup... because we don't want to catch the virus  !
+	 * The shared memory is private: the system destroys it with the last
+	 * process of the instance.
 	 *  
 	 * @param returnFalg the return value to end the program
-	 * @param nbDel the number of variable to be destroy
-	 * @param keyDel the key which refer to the last variable created with success
-	 * 				 (especially used to destroy shared memory)
+	 * @param nbDel 0 if the semaphores are not allocated yet, else they are destroyed
 	 */
-	void massive_cleanup (int returnFlag, int nbDel, key_t keyDel);
+	void massive_cleanup (int returnFlag, int nbDel);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,138 @@
+/**
+ *
+ * @file metrics.h
+ * Live metrics of a running simulation.
+ *
+ * This file declares the block of counters a real time simulation keeps
+ * up to date in shared memory, next to the shared variables: the lights
+ * (green lane, number of switches), each lane (waiting cars, arrivals,
+ * stops, passages) and the cars generated. Each counter is an atomic
+ * updated without lock, the counters written by different processes or
+ * threads lying on separate cache lines.
+ *
+ * The block is a System V segment of its own, recorded in the registry of
+ * the instance (@see ipcregister) so that the cts-top monitor can attach
+ * it read-only while the simulation runs. Its header gives a magic number,
+ * a version and its size: a reader checks them before reading anything.
+ *
+ * @version 1.0
+ *
+ * ********************************************************* */
+#ifndef __metrics_H
+	#define __metrics_H
+
+	#include <stdatomic.h>
+
+	/**
+	 * Call the registry of the instances.
+	 */
+	#include "../inc/ipcTools.h"
+
+	/**
+	 * Magic number of the block ("CTSM").
+	 */
+	#define METRICS_MAGIC 0x4d535443
+
+	/**
+	 * Version of the layout of the block, increased on any change.
+	 */
+	#define METRICS_VERSION 2
+
+	/**
+	 * Size of a cache line.
+	 */
+	#define METRICS_LINE 64
+
+	/**
+	 * Kind of the segment in the registry of the instance.
+	 */
+	#define METRICS_REGISTRY_KIND "metrics"
+
+	/**
+	 * The counters of a lane.
+	 *
+	 * @param queue the number of cars waiting
+	 * @param arrivals the number of cars arrived
+	 * @param stops the number of cars which had to wait
+	 * @param passed the number of cars passed
+	 */
+	typedef struct {
+		atomic_long queue;
+		atomic_long arrivals;
+		atomic_long stops;
+		atomic_long passed;
+	} __attribute__ ((aligned (METRICS_LINE))) MetricsLane;
+
+	/**
+	 * The block of live metrics.
+	 *
+	 * @param magic METRICS_MAGIC
+	 * @param version METRICS_VERSION
+	 * @param size the size of the block
+	 * @param pid the process id of the instance
+	 * @param start the monotonic date of the start in microseconds
+	 * @param nbCars the number of cars to be generated
+	 * @param running set while the simulation runs
+	 * @param green the lane in green light
+	 * @param switches the number of switches of the lights
+	 * @param greenStart the monotonic date of the last switch in microseconds
+	 * @param lanes the counters of each lane
+	 * @param generated the number of cars generated
+	 */
+	typedef struct {
+		unsigned int magic;
+		unsigned int version;
+		unsigned int size;
+		int pid;
+		long start;
+		long nbCars;
+		atomic_int running;
+		atomic_int green __attribute__ ((aligned (METRICS_LINE)));
+		atomic_long switches;
+		atomic_long greenStart;
+		MetricsLane lanes[2];
+		atomic_long generated __attribute__ ((aligned (METRICS_LINE)));
+	} Metrics;
+
+	/**
+	 * The metrics of the running simulation, inherited by the forked processes.
+	 */
+	Metrics * metrics;
+
+	/**
+	 * Give the monotonic date in microseconds, the same in every process.
+	 *
+	 * @return the date
+	 */
+	long metrics_now ();
+
+	/**
+	 * Create the block of the simulation and record it in the registry of
+	 * the instance, which must already exist.
+	 *
+	 * @param nbCars the number of cars to be generated
+	 *
+	 * @return 0 if success, -1 otherwise
+	 */
+	int metrics_open (long nbCars);
+
+	/**
+	 * Attach read-only the block of a running instance.
+	 *
+	 * @param pid the process id of the instance
+	 *
+	 * @return the block, 0 if the instance has none or it is not readable
+	 */
+	Metrics * metrics_attach (int pid);
+
+	/**
+	 * Add to a counter, without ordering: the readers only need its value.
+	 *
+	 * @param counter the counter
+	 * @param n the amount
+	 */
+	static inline void metrics_add (atomic_long * counter, long n) {
+		atomic_fetch_add_explicit (counter, n, memory_order_relaxed);
+	}
+
+#endif
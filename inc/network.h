@@ -0,0 +1,128 @@
+/**
+ *
+ * @file network.h
+ * Road network made of several junctions linked by road segments.
+ *
+ * This file declares the topology simulated by the engine. Each junction
+ * has two lanes controlled by its own traffic lights. A road segment leads
+ * the cars leaving a lane to a lane of another junction after a travel
+ * time; a lane without any road leads out of the network.
+ *
+ * A lane of the network (an "approach") is numbered 2*junction + lane, so
+ * a single integer identifies it in the events of the engine.
+ *
+ * The topology file is a text file, one declaration per line, the lanes
+ * being numbered 1 and 2 as in the simulation's log:
+ * 		junction ID [GREEN [OFFSET]]	(durations in microseconds)
+ * 		road FROM LANE TO LANE TRAVEL
+ * 		entry JUNCTION LANE
+ * The junctions are numbered from 0 without any gap. Without any entry,
+ * the cars enter on every lane which is not reached by a road. The text
+ * following a '#' is a comment.
+ *
+ * @version 1.0
+ *
+ * ********************************************************* */
+#ifndef __network_H
+	#define __network_H
+
+	/**
+	 * Call the queues of the cars waiting on a lane.
+	 */
+	#include "../inc/lanequeue.h"
+
+	/**
+	 * Maximum length of a line of the topology file.
+	 */
+	#define NETWORK_LINE_SIZE 256
+
+	/**
+	 * Give the approach of the given lane of a junction.
+	 */
+	#define NETWORK_APPROACH(junction, lane) (2*(junction) + (lane))
+
+	/**
+	 * Give the junction of an approach.
+	 */
+	#define NETWORK_JUNCTION(approach) ((approach) / 2)
+
+	/**
+	 * Give the lane of an approach in its junction.
+	 */
+	#define NETWORK_LANE(approach) ((approach) % 2)
+
+	/**
+	 * A junction of the network.
+	 *
+	 * @param greenTime the duration of a green light in microseconds
+	 * @param offset the date of the first switch of the lights in microseconds
+	 * @param redLight the lane currently in red light
+	 * @param nbWaitingCars the number of cars waiting at the junction
+	 * @param waiting the queues of the cars waiting on each lane
+	 * @param next the approach reached by the cars leaving each lane (-1: out of the network)
+	 * @param travelTime the time to drive to the next approach in microseconds
+	 * @param declared set once the junction is declared by the topology file
+	 * @param greenStart the date at which the green lane went green
+	 * @param arrivals the number of cars arrived on each lane
+	 * @param checkedArrivals the arrivals on the green lane at the previous decision
+	 */
+	typedef struct {
+		long greenTime;
+		long offset;
+		int redLight;
+		int nbWaitingCars;
+		LaneQueue waiting[2];
+		int next[2];
+		long travelTime[2];
+		int declared;
+		long greenStart;
+		long arrivals[2];
+		long checkedArrivals;
+	} Junction;
+
+	/**
+	 * A road network.
+	 *
+	 * @param junctions the junctions, indexed by their number
+	 * @param nbJunctions the number of junctions
+	 * @param entries the approaches where the new cars enter the network
+	 * @param nbEntries the number of entries
+	 */
+	typedef struct {
+		Junction * junctions;
+		int nbJunctions;
+		int * entries;
+		int nbEntries;
+	} Network;
+
+	/**
+	 * Build the network of the original simulation: one junction whose two
+	 * lanes are both entries and lead out of the network.
+	 *
+	 * @param network the network to initialize
+	 * @param timeSwitchWay the duration of a green light
+	 *
+	 * @return 0 if success, -1 otherwise
+	 */
+	int network_single (Network * network, int timeSwitchWay);
+
+	/**
+	 * Load a network from a topology file (@see network.h).
+	 * The errors are reported on the error output with their line.
+	 *
+	 * @param network the network to initialize
+	 * @param path the path of the topology file
+	 * @param timeSwitchWay the duration of a green light when not given by the file
+	 *
+	 * @return 0 if success, -1 otherwise
+	 */
+	int network_load (Network * network, char * path, int timeSwitchWay);
+
+	/**
+	 * Release the storage of a network.
+	 *
+	 * @param network the network to destroy
+	 */
+	void network_free (Network * network);
+
+#endif
@@ -18,6 +18,17 @@
 	#include <sys/types.h>
 	#include <sys/wait.h>
 	#include <signal.h>
+	#include <stdatomic.h>
+
+	/**
+	 * Call the sets of semaphores.
+	 */
+	#include "../inc/ipcTools.h"
+
+	/**
+	 * Call the statistics of the scheduling of the phases.
+	 */
+	#include "../inc/stats.h"
 
 	/**
 	 * Version of the current program.
@@ -29,6 +40,12 @@
 	 */
 	#define DEFAULT_WAITING_TIME 5000000 // 5s
 
+	/**
+	 * Used as the maximum of the minimum waiting time before going to the
+	 * green light, wherever it is given (-t, --sweep-t, a scenario).
+	 */
+	#define MAX_WAITING_TIME 10000000 // 10s
+
 	/**
 	 * Uses as the default maximum waiting time before the arrival of a new car
 	 * on a traffic light.
@@ -40,6 +57,12 @@
 	 */
 	#define DEFAULT_NB_CARS 30
 
+	/**
+	 * Used as the default saturation flow of a green lane, in cars per hour.
+	 * The value 0 releases all the waiting cars at once.
+	 */
+	#define DEFAULT_SATURATION_FLOW 0
+
 	/**
 	 * Define the mode of the simulation:
 	 * 		0) interactive
@@ -48,27 +71,52 @@
 	int simuAutoMode;
 
 	/**
-	 * Table containing all chidren's process Id:
-	 * 		0)	Crossroad way one PID
-	 * 		1)	Crossroad way two PID
-	 * 		2)	Cars's manager PID
-	 * 		3)	User's command manager PID (interactive mode)
+	 * Define the clock of an automatic simulation:
+	 * 		0) virtual, driven by the discrete-event engine (batch runs)
+	 * 		1) real time, driven by the processes and the threads
+	 * The interactive mode always runs in real time.
+	 */
+	int simuRealTime;
+
+	/**
+	 * Define the output of the simulation:
+	 * 		0) every event is printed
+	 * 		1) quiet, the events are only counted
 	 */
-	pid_t pids[4];
+	int simuQuiet;
+
+	/**
+	 * Size of a cache line.
+	 */
+	#define SHARED_LINE 64
 
 	/**
 	 * Shared variables used for communication betwwen all process.
 	 * 
+	 * Each variable is an atomic alone on its cache line: the lanes write
+	 * the light, the cars their counters, and none of them invalidates the
+	 * line the others read. They are updated without lock; the order of
+	 * each access is explicit where it matters (@see driving_car).
+	 * 
 	 * @param onRedLight the red light flag
 	 * @param nbWaitingCars the number of waiting cars at a red traffic light
+	 * @param laneWaitingCars the number of waiting cars on each lane
+	 * @param laneArrivals the number of cars arrived on each lane
 	 * @param userCmdInterMode the current lane choose by the user durring the simulation
-	 * @param stopSig the stop simulation flag
+	 * @param stopSig the stop simulation flag (STOP_INTERRUPT: by the user)
+	 * @param phaseEnd the planned date of the end of the last green phase,
+	 * 		on the monotonic clock in microseconds (0: none yet)
+	 * @param phases the scheduling of the green phases of each lane
 	 */
 	typedef struct {
-		int onRedLight;
-		int nbWaitingCars;
-		unsigned char userCmdInterMode;
-		int stopSig;
+		atomic_int onRedLight __attribute__ ((aligned (SHARED_LINE)));
+		atomic_int nbWaitingCars __attribute__ ((aligned (SHARED_LINE)));
+		atomic_int laneWaitingCars[2] __attribute__ ((aligned (SHARED_LINE)));
+		atomic_long laneArrivals[2] __attribute__ ((aligned (SHARED_LINE)));
+		atomic_uchar userCmdInterMode __attribute__ ((aligned (SHARED_LINE)));
+		atomic_int stopSig __attribute__ ((aligned (SHARED_LINE)));
+		atomic_long phaseEnd __attribute__ ((aligned (SHARED_LINE)));
+		PhaseStats phases[2] __attribute__ ((aligned (SHARED_LINE)));
 	} Shared;
 
 	/** 
@@ -77,41 +125,43 @@
 	Shared * shared;
 
 	/**
-	 * Table of mutex that protect shared variables:
-	 * 		0)	The "red light flag" variable
-	 * 		1)	The "number of waiting cars" variable
-	 * 		2)	The "user's lane choice" variable	
+	 * Semaphores of each lane of the crossroad (SEM_LANE + the lane's number).
 	 */
-	int mutex[3];
+	#define SEM_LANE 0
 
 	/**
-	 * The keyboard to select the lane 1.
+	 * Semaphore associated to the red traffic light switching.
 	 */
-	#define LANE_ONE_KEY '1'
+	#define SEM_CAN_ACCESS 2
 
 	/**
-	 * The keyboard to select the lane 2.
+	 * Number of semaphores of the simulation.
 	 */
-	#define LANE_TWO_KEY '2'
+	#define NB_SEMS 3
 
 	/**
-	 * Signal to update the defined lane where the new cars must arrive.
+	 * The semaphores of the simulation, allocated as a single set.
 	 */
-	#define SWITCH_LANE SIGUSR1	// Value: 10
+	SemSet sems;
 
 	/**
-	 * Signal to realease cars after traffic light going green.
+	 * The keyboard to select the lane 1.
 	 */
-	#define RELEASE_CARS SIGUSR2	// Value: 12
+	#define LANE_ONE_KEY '1'
 
 	/**
-	 * Signal to end circulation.
+	 * The keyboard to select the lane 2.
 	 */
-	#define INTERRUPT_CIRCULATION SIGCHLD	// Value: 17
+	#define LANE_TWO_KEY '2'
 
 	/**
 	 * Signal to end the program.
 	 */
 	#define STOP_PROG SIGINT	// Value: 2
 
+	/**
+	 * Value of the end flag raised by the signal, rather than by the cars.
+	 */
+	#define STOP_INTERRUPT 2
+
 #endif
\ No newline at end of file
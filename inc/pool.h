@@ -0,0 +1,120 @@
+/**
+ *
+ * @file pool.h
+ * Fixed pool of worker threads running timestamped tasks.
+ *
+ * This file declares the pool used to run the cars' behaviour. A task is
+ * an event (@see events.h) dated with the monotonic clock. The pending
+ * tasks are the timers of a hierarchical timing wheel (@see wheel.h),
+ * turned by a single timer thread: it sleeps until the next timer, then
+ * hands the due tasks to the workers, which only wait for them. A car
+ * waiting for a delay costs one entry of the wheel, not one sleeping
+ * thread nor one timer of the kernel.
+ *
+ * @see events.h
+ * @see wheel.h
+ * @version 1.1
+ *
+ * ********************************************************* */
+#ifndef __pool_H
+	#define __pool_H
+
+	#include <pthread.h>
+
+	/**
+	 * Call the timestamped events and their priority queue.
+	 */
+	#include "../inc/events.h"
+
+	/**
+	 * Call the timing wheel of the pending tasks.
+	 */
+	#include "../inc/wheel.h"
+
+	/**
+	 * Value of the stop flag once the workers are gone: the timer leaves.
+	 */
+	#define POOL_STOP_TIMER 2
+
+	/**
+	 * Function which runs a due task.
+	 */
+	typedef void (*TaskHandler) (Event * task);
+
+	/**
+	 * Pool of worker threads.
+	 *
+	 * @param workers the worker threads
+	 * @param nbWorkers the number of worker threads
+	 * @param timer the thread turning the wheel
+	 * @param mut the mutex protecting the pending and due tasks
+	 * @param cond the condition signaled when a task is due
+	 * @param tick the condition signaled when the next timer is sooner
+	 * @param timers the pending tasks
+	 * @param tasks the due tasks ordered by date
+	 * @param handler the function running the due tasks
+	 * @param stop the flag asking the workers to leave (POOL_STOP_TIMER: the timer)
+	 */
+	typedef struct {
+		pthread_t * workers;
+		int nbWorkers;
+		pthread_t timer;
+		pthread_mutex_t mut;
+		pthread_cond_t cond;
+		pthread_cond_t tick;
+		Wheel timers;
+		EventQueue tasks;
+		TaskHandler handler;
+		int stop;
+	} Pool;
+
+	/**
+	 * Read the monotonic clock used to date the tasks.
+	 *
+	 * @return the current date in microseconds
+	 */
+	long pool_now ();
+
+	/**
+	 * Sleep until a date of the monotonic clock, whatever the time spent
+	 * before: a sequence of such sleeps does not drift.
+	 *
+	 * @param date the monotonic date of the wake up (@see pool_now)
+	 */
+	void pool_sleep_until (long date);
+
+	/**
+	 * Start a pool of worker threads, and its timer thread.
+	 * The threads are started with all signals blocked.
+	 *
+	 * @param pool the pool to initialize
+	 * @param nbWorkers the number of workers, or 0 for one per online core
+	 * @param handler the function running the due tasks
+	 *
+	 * @return 0 if success, -1 otherwise
+	 */
+	int pool_init (Pool * pool, int nbWorkers, TaskHandler handler);
+
+	/**
+	 * Queue a task: a due one goes straight to the workers, the others to
+	 * the wheel.
+	 *
+	 * @param pool the pool of workers
+	 * @param date the monotonic date from which the task can run (@see pool_now)
+	 * @param type the kind of task
+	 * @param car the car concerned by the task (0: none)
+	 * @param lane the lane concerned by the task
+	 *
+	 * @return 0 if success, -1 otherwise
+	 */
+	int pool_submit (Pool * pool, long date, EventType type, Car * car, int lane);
+
+	/**
+	 * Stop the workers once the pending tasks are done, then the timer, and
+	 * release the pool's resources.
+	 *
+	 * @param pool the pool to destroy
+	 */
+	void pool_destroy (Pool * pool);
+
+#endif
@@ -0,0 +1,148 @@
+/**
+ *
+ * @file record.h
+ * Recording of the inputs and decisions of a simulation.
+ *
+ * This file declares the recording written, next to the log, by the
+ * writer thread of the event log (@see eventlog.h): a compact binary file
+ * holding the settings of the run, then one fixed-size entry for each
+ * arrival of a car (with the lane it took), each lane chosen by the user
+ * and each light going green. A recording is a scenario (@see scenario.h):
+ * replayed on the virtual clock, it drives the engine with the recorded
+ * arrivals and seed, without any draw of the arrivals nor keyboard.
+ * The processes of a simulation append their batches to the same file,
+ * opened before they start. The entries dropped by a full ring of the log
+ * are counted at the end of each process: an incomplete recording is
+ * not replayed.
+ *
+ * @see eventlog.h
+ * @see scenario.h
+ * @version 1.0
+ *
+ * ********************************************************* */
+#ifndef __record_H
+	#define __record_H
+
+	/**
+	 * Call the records of the log.
+	 */
+	#include "../inc/eventlog.h"
+
+	/**
+	 * First bytes of a recording (the last one is the version of the format).
+	 */
+	#define RECORD_MAGIC "CTS-REC\001"
+
+	/**
+	 * Length of the magic bytes.
+	 */
+	#define RECORD_MAGIC_SIZE 8
+
+	/**
+	 * Kinds of entries:
+	 * 		0) a car arrives on a lane
+	 * 		1) the user chose a lane for the new cars
+	 * 		2) a traffic light goes green
+	 * 		3) entries were dropped by the log (their number is the date)
+	 */
+	#define RECORD_ARRIVAL 0
+	#define RECORD_LANE 1
+	#define RECORD_GREEN 2
+	#define RECORD_LOST 3
+
+	/**
+	 * Settings of a recorded run, at the start of the file.
+	 *
+	 * @param magic the bytes RECORD_MAGIC
+	 * @param controller the name of the controller of the lights
+	 * @param seed the seed of the draws
+	 * @param cars the number of cars
+	 * @param green the duration of a green light in microseconds
+	 * @param flow the saturation flow in cars per hour
+	 */
+	typedef struct {
+		char magic[RECORD_MAGIC_SIZE];
+		char controller[16];
+		unsigned long seed;
+		int cars;
+		int green;
+		int flow;
+	} RecordHeader;
+
+	/**
+	 * An entry of a recording.
+	 *
+	 * @param date the date in microseconds since the start of the run
+	 * @param type the kind of entry
+	 * @param lane the lane concerned, from 0
+	 */
+	typedef struct {
+		long date;
+		int type;
+		int lane;
+	} RecordEntry;
+
+	/**
+	 * Create the recording and write the settings of the run. Called before
+	 * the roles start: the forked processes write into the same file.
+	 *
+	 * @param path the name of the file
+	 * @param controller the name of the controller of the lights
+	 * @param seed the seed of the draws
+	 * @param cars the number of cars
+	 * @param green the duration of a green light in microseconds
+	 * @param flow the saturation flow in cars per hour
+	 *
+	 * @return 0 if success, -1 otherwise
+	 */
+	int record_open (char * path, char * controller, unsigned long seed, int cars, int green,
+		int flow);
+
+	/**
+	 * Tell whether a recording is written.
+	 *
+	 * @return 1 if the recording is open, 0 otherwise
+	 */
+	int record_active ();
+
+	/**
+	 * Tell the kind of entry of a kind of record of the log.
+	 *
+	 * @param type the kind of record
+	 *
+	 * @return the kind of entry, -1 if the record is neither an input nor a decision
+	 */
+	int record_type (int type);
+
+	/**
+	 * Turn a record of the log into an entry (by the writer only).
+	 *
+	 * @param record the record of the log
+	 * @param entry the entry receiving it
+	 *
+	 * @return 1 if the record is an input or a decision, 0 otherwise
+	 */
+	int record_entry (LogRecord * record, RecordEntry * entry);
+
+	/**
+	 * Append entries to the recording.
+	 *
+	 * @param entries the entries
+	 * @param count the number of entries
+	 */
+	void record_write (RecordEntry * entries, int count);
+
+	/**
+	 * Append the count of the entries dropped by the log of the process,
+	 * once its writer has stopped.
+	 *
+	 * @param count the number of entries dropped
+	 */
+	void record_lost (long count);
+
+	/**
+	 * Close the recording.
+	 */
+	void record_close ();
+
+#endif
@@ -0,0 +1,75 @@
+/**
+ *
+ * @file rng.h
+ * Seeded streams of random numbers.
+ *
+ * This file declares the random generator of the simulation: each stream
+ * is a xoshiro256** generator whose state is derived by splitmix64 from
+ * the seed of the simulation and the number of the stream. The cars each
+ * draw from their own stream, and the arrivals from another one, so that
+ * a given seed always gives the same draws, whatever the order in which
+ * the threads run. A stream belongs to a single thread at a time: drawing
+ * takes no lock.
+ *
+ * @version 1.0
+ *
+ * ********************************************************* */
+#ifndef __rng_H
+	#define __rng_H
+
+	#include <stdint.h>
+
+	/**
+	 * Stream of the arrivals of the new cars. The stream of the car
+	 * numbered c is RNG_CAR_STREAM (c).
+	 */
+	#define RNG_ARRIVAL_STREAM 0
+
+	/**
+	 * Give the stream of a car.
+	 */
+	#define RNG_CAR_STREAM(car) ((uint64_t) (car) + 1)
+
+	/**
+	 * A stream of random numbers (xoshiro256** state).
+	 *
+	 * @param s the state, never all zero
+	 */
+	typedef struct {
+		uint64_t s[4];
+	} Rng;
+
+	/**
+	 * Seed of the simulation (--seed option).
+	 */
+	unsigned long simuSeed;
+
+	/**
+	 * Start a stream.
+	 *
+	 * @param rng the stream to start
+	 * @param seed the seed of the simulation
+	 * @param stream the number of the stream
+	 */
+	void rng_seed (Rng * rng, uint64_t seed, uint64_t stream);
+
+	/**
+	 * Draw the next number of a stream.
+	 *
+	 * @param rng the stream
+	 *
+	 * @return a number uniformly drawn among the 64 bits values
+	 */
+	uint64_t rng_next (Rng * rng);
+
+	/**
+	 * Draw a number below a bound.
+	 *
+	 * @param rng the stream
+	 * @param bound the bound, greater than 0
+	 *
+	 * @return a number from 0 to bound-1
+	 */
+	long rng_below (Rng * rng, long bound);
+
+#endif
@@ -0,0 +1,95 @@
+/**
+ *
+ * @file roles.h
+ * Roles of a real time simulation, run as processes or as threads.
+ *
+ * This file declares how the roles of a real time or interactive
+ * simulation (each lane, the cars, the user's command) are started and
+ * waited for. A role is a function run once; it runs either in a forked
+ * process, as the simulation always did, or in a thread of the main
+ * process (--roles option). The roles only meet through the objects of
+ * ipcTools.h, whose backend is the transport: System V or futex
+ * semaphores and shared mappings between processes, or the private
+ * backend between threads (@see IPC_BACKEND_PRIVATE).
+ *
+ * A role run as a thread starts with all the signals blocked: as with the
+ * processes, only the main one runs the handler of the interruption.
+ *
+ * @version 1.0
+ *
+ * ********************************************************* */
+#ifndef __roles_H
+	#define __roles_H
+
+	#include <sys/types.h>
+	#include <pthread.h>
+
+	/**
+	 * Ways of running the roles:
+	 * 		0) one forked process per role
+	 * 		1) one thread per role, in the main process
+	 */
+	#define ROLES_PROCESS 0
+	#define ROLES_THREAD 1
+
+	/**
+	 * Function run by a role, whose result is the exit status of the role.
+	 */
+	typedef int (* RoleMain) (void * arg);
+
+	/**
+	 * A started role.
+	 *
+	 * @param mode the way the role runs (@see ROLES_PROCESS)
+	 * @param pid the process of the role
+	 * @param thread the thread of the role
+	 * @param run the function of the role
+	 * @param arg the argument of the function
+	 * @param status the result of the function, once the thread is done
+	 */
+	typedef struct {
+		int mode;
+		pid_t pid;
+		pthread_t thread;
+		RoleMain run;
+		void * arg;
+		int status;
+	} Role;
+
+	/**
+	 * Way of running the roles of the simulation (--roles option).
+	 */
+	int simuRoles;
+
+	/**
+	 * Give the name of a way of running the roles.
+	 *
+	 * @param mode the way (@see ROLES_PROCESS)
+	 *
+	 * @return the name
+	 */
+	char * roles_name (int mode);
+
+	/**
+	 * Start a role. In a process, the role exits with the result of its
+	 * function; the standard output must be flushed before.
+	 *
+	 * @param role the role to start
+	 * @param mode the way the role runs (@see ROLES_PROCESS)
+	 * @param run the function of the role
+	 * @param arg the argument of the function
+	 *
+	 * @return 0 if success, -1 otherwise
+	 */
+	int role_start (Role * role, int mode, RoleMain run, void * arg);
+
+	/**
+	 * Wait for the end of a role.
+	 *
+	 * @param role the started role
+	 *
+	 * @return the exit status of the role, -1 if it can not be waited for
+	 */
+	int role_wait (Role * role);
+
+#endif
@@ -0,0 +1,142 @@
+/**
+ *
+ * @file scenario.h
+ * Scenario files: settings and schedule of the arrivals.
+ *
+ * This file declares the reader of the scenario files, which replay a
+ * given series of arrivals instead of drawing them. The file is a text
+ * file, one item per line, the text following a '#' being a comment:
+ * 		- first, the settings, one "NAME VALUE" per line:
+ * 			cars NUMBER		the number of cars (else the -n option)
+ * 			green NUMBER	the duration of a green light (as -t)
+ * 			flow NUMBER		the saturation flow (as -s)
+ * 			controller NAME	the controller of the lights (as -c)
+ * 			seed NUMBER		the seed of the draws (as --seed)
+ * 		- then, the arrivals, one "DATE LANE" per line, in chronological
+ * 		  order: the date in microseconds from the start, and the lane
+ * 		  (1 or 2; on a road network, the number of the entry, from 1).
+ *
+ * A recording of a run (@see record.h) is a scenario as well: its
+ * settings are in its header, and its arrivals are its entries of arrival.
+ * Its lights going green are read by a second cursor, for the engine to
+ * switch the lights as recorded (@see scenario_green). The lanes chosen
+ * by the user are skipped: they are the lanes of the arrivals.
+ *
+ * The file is mapped in memory and read one arrival at a time, as the
+ * simulation needs it: opening a scenario only reads its settings, and
+ * the pages already read are given back to the system, so a schedule of
+ * millions of arrivals is never held in memory.
+ *
+ * @version 1.0
+ *
+ * ********************************************************* */
+#ifndef __scenario_H
+	#define __scenario_H
+
+	#include <stddef.h>
+
+	/**
+	 * Amount of the file read before its pages are given back.
+	 */
+	#define SCENARIO_WINDOW (4 << 20)
+
+	/**
+	 * Maximum length of the name of a setting.
+	 */
+	#define SCENARIO_NAME_SIZE 16
+
+	/**
+	 * A scenario being read.
+	 *
+	 * @param path the path of the file
+	 * @param data the mapping of the file
+	 * @param size the size of the file
+	 * @param pos the offset of the next line to read
+	 * @param start the offset of the first arrival
+	 * @param released the offset up to which the pages are given back
+	 * @param line the number of the next line to read
+	 * @param startLine the number of the line of the first arrival
+	 * @param lastDate the date of the previous arrival
+	 * @param greenPos the offset of the next entry read for the lights
+	 * @param lastGreen the date of the previous light going green
+	 * @param binary set if the file is a recording
+	 * @param phases set if the lights switch as recorded
+	 */
+	typedef struct {
+		char * path;
+		char * data;
+		size_t size;
+		size_t pos;
+		size_t start;
+		size_t released;
+		long line;
+		long startLine;
+		long lastDate;
+		size_t greenPos;
+		long lastGreen;
+		int binary;
+		int phases;
+	} Scenario;
+
+	/**
+	 * Callback receiving the settings of a scenario.
+	 *
+	 * @param name the name of the setting
+	 * @param value the value of the setting
+	 *
+	 * @return 0 if the setting is valid, -1 otherwise
+	 */
+	typedef int (* ScenarioSetting) (char * name, char * value);
+
+	/**
+	 * Open a scenario and read its settings, up to the first arrival.
+	 * The errors are reported on the error output with their line.
+	 *
+	 * @param scenario the scenario to open
+	 * @param path the path of the file
+	 * @param setting the function receiving each setting
+	 *
+	 * @return 0 if success, -1 otherwise
+	 */
+	int scenario_open (Scenario * scenario, char * path, ScenarioSetting setting);
+
+	/**
+	 * Read the next arrival of a scenario.
+	 * The errors are reported on the error output with their line.
+	 *
+	 * @param scenario the scenario
+	 * @param date the date of the arrival in microseconds
+	 * @param lane the lane of the arrival, from 0
+	 *
+	 * @return 1 if an arrival is read, 0 at the end of the schedule, -1 if invalid
+	 */
+	int scenario_next (Scenario * scenario, long * date, int * lane);
+
+	/**
+	 * Read the next light going green of a recording, for its lights to
+	 * switch as recorded.
+	 * The errors are reported on the error output with their offset.
+	 *
+	 * @param scenario the scenario, a recording
+	 * @param date the date of the switch in microseconds
+	 * @param lane the lane going green, from 0
+	 *
+	 * @return 1 if a switch is read, 0 at the end of the recording, -1 if invalid
+	 */
+	int scenario_green (Scenario * scenario, long * date, int * lane);
+
+	/**
+	 * Go back to the first arrival of a scenario.
+	 *
+	 * @param scenario the scenario
+	 */
+	void scenario_rewind (Scenario * scenario);
+
+	/**
+	 * Unmap a scenario.
+	 *
+	 * @param scenario the scenario
+	 */
+	void scenario_close (Scenario * scenario);
+
+#endif
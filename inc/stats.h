@@ -0,0 +1,174 @@
+/**
+ *
+ * @file stats.h
+ * Wait times of the cars and end of run statistics.
+ *
+ * This file declares the statistics of a simulation: the wait of each car,
+ * from its arrival at a traffic light to its passage, is recorded in the
+ * histogram of its lane; the peak number of waiting cars is kept as well,
+ * and in real time, the latency of the notices received by the cars and
+ * the lateness of the switches of the lights on their planned dates.
+ * At the end of the run, the throughput, the mean and the percentiles of
+ * the waits are printed, and can be appended to a JSON or CSV file.
+ *
+ * A histogram has a fixed number of counters and records a value without
+ * any lock: the small values are counted exactly, the larger ones in
+ * buckets whose width grows with the magnitude of the value, so that each
+ * value is known within 1/HIST_HALF_BUCKETS of its size (high dynamic
+ * range histogram).
+ *
+ * @version 1.0
+ *
+ * ********************************************************* */
+#ifndef __stats_H
+	#define __stats_H
+
+	#include <stdatomic.h>
+
+	/**
+	 * Number of bits of the values counted exactly.
+	 */
+	#define HIST_SUB_BITS 7
+
+	/**
+	 * Number of buckets per power of two, beyond the exact values.
+	 */
+	#define HIST_HALF_BUCKETS (1 << (HIST_SUB_BITS - 1))
+
+	/**
+	 * Number of buckets of a histogram, enough for any positive long.
+	 */
+	#define HIST_NB_BUCKETS ((64 - HIST_SUB_BITS + 2) * HIST_HALF_BUCKETS)
+
+	/**
+	 * Lateness beyond which a switch of the lights is an overrun, in microseconds.
+	 */
+	#define STATS_OVERRUN 1000
+
+	/**
+	 * A histogram of durations in microseconds.
+	 *
+	 * @param counts the number of values recorded in each bucket
+	 * @param total the number of values recorded
+	 * @param sum the sum of the values recorded
+	 * @param max the largest value recorded
+	 */
+	typedef struct {
+		atomic_long counts[HIST_NB_BUCKETS];
+		atomic_long total;
+		atomic_long sum;
+		atomic_long max;
+	} Histogram;
+
+	/**
+	 * The scheduling of the green phases of a lane, in real time.
+	 *
+	 * @param lateness the histogram of the lateness of the switches on their planned date
+	 * @param overruns the number of switches later than STATS_OVERRUN
+	 */
+	typedef struct {
+		Histogram lateness;
+		atomic_long overruns;
+	} PhaseStats;
+
+	/**
+	 * The statistics of a simulation.
+	 *
+	 * @param waits the histogram of the waits on each lane
+	 * @param peakQueue the largest number of cars waiting at once
+	 * @param nbCars the number of cars of the simulation
+	 * @param duration the duration of the simulation in microseconds
+	 * @param controller the name of the policy of the traffic lights (0: not shown)
+	 * @param notices the histogram of the latency of the notices received by the cars
+	 * @param phases the scheduling of the phases of each lane (0: not shown)
+	 */
+	typedef struct {
+		Histogram waits[2];
+		atomic_long peakQueue;
+		long nbCars;
+		long duration;
+		char * controller;
+		Histogram notices;
+		PhaseStats * phases;
+	} Stats;
+
+	/**
+	 * The statistics of the running simulation.
+	 */
+	Stats simuStats;
+
+	/**
+	 * Prepare the statistics of a simulation. Their storage is fixed,
+	 * whatever the number of cars.
+	 *
+	 * @param stats the statistics to initialize
+	 * @param nbCars the number of cars of the simulation
+	 */
+	void stats_init (Stats * stats, long nbCars);
+
+	/**
+	 * Record the passage of a car: its wait since its arrival, carried by
+	 * the car (@see Car), goes to the histogram of its lane.
+	 *
+	 * @param stats the statistics of the simulation
+	 * @param lane the lane of the car
+	 * @param arrival the date of the arrival of the car in microseconds
+	 * @param date the date of the passage in microseconds
+	 */
+	void stats_passage (Stats * stats, int lane, long arrival, long date);
+
+	/**
+	 * Record the number of cars currently waiting.
+	 *
+	 * @param stats the statistics of the simulation
+	 * @param nbWaitingCars the number of cars waiting
+	 */
+	void stats_queue (Stats * stats, long nbWaitingCars);
+
+	/**
+	 * Record the switch of the lights ending a green phase.
+	 *
+	 * @param phase the scheduling of the phases of the lane
+	 * @param lateness the time between the planned date of the switch and
+	 * 		the switch, in microseconds
+	 */
+	void stats_phase (PhaseStats * phase, long lateness);
+
+	/**
+	 * Record a value in a histogram (lock-free).
+	 *
+	 * @param hist the histogram
+	 * @param value the value, negative values being counted as 0
+	 */
+	void hist_record (Histogram * hist, long value);
+
+	/**
+	 * Give the value below which the given percentage of the values fall.
+	 *
+	 * @param hist the histogram
+	 * @param percent the percentage, from 0 to 100
+	 *
+	 * @return the value, rounded up to its bucket but never above the maximum
+	 */
+	long hist_percentile (Histogram * hist, double percent);
+
+	/**
+	 * Print the statistics at the end of the simulation.
+	 *
+	 * @param stats the statistics of the simulation
+	 */
+	void stats_report (Stats * stats);
+
+	/**
+	 * Append the statistics to a file: a JSON object per line if the name
+	 * ends with ".json", a CSV row otherwise (with the header if the file
+	 * is empty).
+	 *
+	 * @param stats the statistics of the simulation
+	 * @param path the path of the file
+	 *
+	 * @return 0 if success, -1 otherwise
+	 */
+	int stats_export (Stats * stats, char * path);
+
+#endif
@@ -0,0 +1,91 @@
+/**
+ *
+ * @file trace.h
+ * Trace of the simulation for the Chrome and Perfetto viewers.
+ *
+ * This file declares the trace written, next to the log, by the writer
+ * thread of the event log (@see eventlog.h): the records are turned into
+ * events of the Trace Event Format (JSON array format), so the producers
+ * never format nor write anything. Each junction is a process of the
+ * trace, each of its lanes a thread:
+ * 		- the green phases of a light are slices on the track of its lane
+ * 		- each car is an asynchronous slice on its lane, from its arrival to
+ * 		  its passage, marked when it stops at the red light
+ * 		- the number of cars stopped on each lane is a counter track
+ * The events are dated by the stamps of the records. The processes of a
+ * simulation append their batches to the same file, opened before they
+ * start.
+ *
+ * @see eventlog.h
+ * @version 1.0
+ *
+ * ********************************************************* */
+#ifndef __trace_H
+	#define __trace_H
+
+	/**
+	 * Call the records of the log.
+	 */
+	#include "../inc/eventlog.h"
+
+	/**
+	 * Maximum size of the events of a record in the trace, in bytes.
+	 */
+	#define TRACE_RECORD_SIZE 1024
+
+	/**
+	 * State of a junction in the trace, kept by the writer.
+	 *
+	 * @param greenStart the date each lane went green (-1: red)
+	 * @param queue the number of cars stopped on each lane
+	 * @param named set once the names of the junction and its lanes are written
+	 */
+	typedef struct {
+		long greenStart[2];
+		long queue[2];
+		int named;
+	} TraceJunction;
+
+	/**
+	 * Create the trace file. Called before the roles start: the forked
+	 * processes write into the same file.
+	 *
+	 * @param path the name of the file
+	 *
+	 * @return 0 if success, -1 otherwise
+	 */
+	int trace_open (char * path);
+
+	/**
+	 * Tell whether a trace is written.
+	 *
+	 * @return 1 if the trace file is open, 0 otherwise
+	 */
+	int trace_active ();
+
+	/**
+	 * Format the events of a record (by the writer only).
+	 *
+	 * @param record the record to format
+	 * @param buffer the buffer receiving the events
+	 * @param size the size of the buffer, at least TRACE_RECORD_SIZE
+	 *
+	 * @return the number of characters written
+	 */
+	int trace_format (LogRecord * record, char * buffer, int size);
+
+	/**
+	 * Append formatted events to the trace file.
+	 *
+	 * @param buffer the events
+	 * @param length the number of characters
+	 */
+	void trace_write (char * buffer, int length);
+
+	/**
+	 * Close the trace file. The process which opened it ends the array of
+	 * events, once the other ones are done.
+	 */
+	void trace_close ();
+
+#endif
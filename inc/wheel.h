@@ -0,0 +1,159 @@
+/**
+ *
+ * @file wheel.h
+ * Hierarchical timing wheel of the pending tasks.
+ *
+ * This file declares the wheel holding the timers of the real time
+ * simulation (@see pool.h): the arrivals to come, the passages of the
+ * cars, the releases of the queues. The wheel has WHEEL_LEVELS levels of
+ * WHEEL_SLOTS slots; a slot of the level k spans WHEEL_SLOTS^k
+ * microseconds. A timer is linked in the slot of the lowest level whose
+ * span holds its date, found from the bits its date shares with the
+ * clock of the wheel; a timer too far for the last level waits in a list
+ * of its own. When the clock of the wheel reaches a slot of an upper
+ * level, its timers go down to the lower levels, at most once per level.
+ * Inserting and expiring a timer take a constant time, whatever the
+ * number of pending timers; a bitmap of the occupied slots of each level
+ * gives the next date without scanning the empty slots.
+ *
+ * The slots of the first level are one microsecond: a timer expires at
+ * its exact date. The timers of a slot keep their order of insertion.
+ * A timer is a small entry of a table, the free entries being linked
+ * together: 100000 pending cars cost 100000 entries, not a sleeping
+ * thread each.
+ *
+ * @see events.h
+ * @version 1.0
+ *
+ * ********************************************************* */
+#ifndef __wheel_H
+	#define __wheel_H
+
+	/**
+	 * Call the timestamped events.
+	 */
+	#include "../inc/events.h"
+
+	/**
+	 * Number of bits of the index of a slot.
+	 */
+	#define WHEEL_BITS 6
+
+	/**
+	 * Number of slots of a level (one bit each in the bitmap of the level).
+	 */
+	#define WHEEL_SLOTS (1 << WHEEL_BITS)
+
+	/**
+	 * Number of levels: the wheel spans 2^36 microseconds, about 19 hours.
+	 */
+	#define WHEEL_LEVELS 6
+
+	/**
+	 * Used as the default number of entries of the wheel (grows on demand).
+	 */
+	#define DEFAULT_WHEEL_CAPACITY 64
+
+	/**
+	 * A timer of the wheel.
+	 *
+	 * @param event the task due at the date of the timer
+	 * @param next the index of the next entry of its list, -1 for the last
+	 */
+	typedef struct {
+		Event event;
+		long next;
+	} WheelEntry;
+
+	/**
+	 * A list of entries, in their order of insertion.
+	 *
+	 * @param head the index of the first entry, -1 if empty
+	 * @param tail the index of the last entry
+	 */
+	typedef struct {
+		long head;
+		long tail;
+	} WheelList;
+
+	/**
+	 * A hierarchical timing wheel.
+	 *
+	 * @param entries the table of the entries
+	 * @param capacity the number of allocated entries
+	 * @param free the list of the free entries (head only)
+	 * @param size the number of pending timers
+	 * @param now the clock of the wheel in microseconds, never past a pending timer
+	 * @param seq the next insertion number
+	 * @param occupied the bitmap of the non-empty slots of each level
+	 * @param slots the timers of each slot of each level
+	 * @param due the timers already due
+	 * @param far the timers beyond the last level
+	 */
+	typedef struct {
+		WheelEntry * entries;
+		long capacity;
+		long free;
+		long size;
+		long now;
+		long seq;
+		unsigned long occupied[WHEEL_LEVELS];
+		WheelList slots[WHEEL_LEVELS][WHEEL_SLOTS];
+		WheelList due;
+		WheelList far;
+	} Wheel;
+
+	/**
+	 * Allocate an empty wheel.
+	 *
+	 * @param wheel the wheel to initialize
+	 * @param now the date from which the wheel turns
+	 * @param capacity the initial number of timers which can be stored
+	 *
+	 * @return 0 if success, -1 otherwise
+	 */
+	int wheel_init (Wheel * wheel, long now, long capacity);
+
+	/**
+	 * Release the storage of a wheel.
+	 *
+	 * @param wheel the wheel to destroy
+	 */
+	void wheel_free (Wheel * wheel);
+
+	/**
+	 * Insert a timer. A date already past is due at once.
+	 *
+	 * @param wheel the wheel
+	 * @param time the date of the timer
+	 * @param type the kind of task
+	 * @param car the car concerned by the task (0: none)
+	 * @param lane the lane concerned by the task
+	 *
+	 * @return 0 if success, -1 otherwise
+	 */
+	int wheel_insert (Wheel * wheel, long time, EventType type, Car * car, int lane);
+
+	/**
+	 * Give the date until which no timer expires: the date of the next
+	 * timer, or the start of the slot holding it if it must go down first.
+	 *
+	 * @param wheel the wheel
+	 * @param date the date
+	 *
+	 * @return 1 if a date is given, 0 if the wheel is empty
+	 */
+	int wheel_next (Wheel * wheel, long * date);
+
+	/**
+	 * Remove a timer due at the given date, turning the wheel up to it.
+	 *
+	 * @param wheel the wheel
+	 * @param now the current date
+	 * @param event the task of the removed timer
+	 *
+	 * @return 1 if a timer is returned, 0 if none is due
+	 */
+	int wheel_expire (Wheel * wheel, long now, Event * event);
+
+#endif
@@ -0,0 +1,281 @@
+/**
+ *
+ * @file batch.c
+ * Parameter sweep: many simulations run in parallel on the virtual clock.
+ *
+ * Implementation of functions defined in @see batch.h
+ *
+ * @version 1.0
+ *
+ * ********************************************************* */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include "../inc/batch.h"
+
+/**
+ * Read a number which must fill the given text.
+ *
+ * @param text the text to read
+ * @param value the number read
+ * @param min the smallest value allowed
+ * @param max the largest value allowed
+ *
+ * @return 0 if success, -1 otherwise
+ */
+static int batch_parse_value (char * text, long * value, long min, long max) {
+	char * near;
+
+	*value = strtol (text, &near, 10);
+	if (near == text || *near != '\0' || *value < min || *value > max)
+		return -1;
+	return 0;
+}
+
+/**
+ * Read the values of a swept parameter: a single number, a list
+ * "A,B,C" or a range "START:STOP:STEP" (both ends included).
+ *
+ * @param range the values read, replacing the previous ones
+ * @param spec the text to read
+ * @param min the smallest value allowed
+ * @param max the largest value allowed
+ *
+ * @return 0 if success, -1 if the text is invalid or the memory is lacking
+ */
+int batch_parse_range (BatchRange * range, char * spec, long min, long max) {
+	char text[256], * field, * save;
+	long start, stop, step, count, * values;
+	int i;
+
+	if (strlen (spec) >= sizeof (text))
+		return -1;
+	strcpy (text, spec);
+
+	if (strchr (text, ':')) {	/* START:STOP:STEP */
+		if (!(field = strtok_r (text, ":", &save)) || batch_parse_value (field, &start, min, max) == -1
+				|| !(field = strtok_r (0, ":", &save)) || batch_parse_value (field, &stop, start, max) == -1
+				|| !(field = strtok_r (0, ":", &save)) || batch_parse_value (field, &step, 1, max) == -1
+				|| strtok_r (0, ":", &save))
+			return -1;
+		count = (stop - start) / step + 1;
+		if (!(values = malloc (count * sizeof (long))))
+			return -1;
+		for (i = 0; i < count; i++)
+			values[i] = start + i * step;
+	} else {	/* A,B,C */
+		for (count = 1, i = 0; text[i]; i++)
+			count += text[i] == ',';
+		if (!(values = malloc (count * sizeof (long))))
+			return -1;
+		for (i = 0, field = strtok_r (text, ",", &save); field; field = strtok_r (0, ",", &save))
+			if (batch_parse_value (field, &values[i++], min, max) == -1)
+				break;
+		if (field || i != count) {	/* Invalid or empty value. */
+			free (values);
+			return -1;
+		}
+	}
+
+	free (range->values);
+	range->values = values;
+	range->nbValues = count;
+	return 0;
+}
+
+/**
+ * Give a swept parameter its single value if no value was read.
+ *
+ * @param range the swept parameter
+ * @param value the value by default
+ *
+ * @return 0 if success, -1 otherwise
+ */
+int batch_default_range (BatchRange * range, long value) {
+	if (range->nbValues)
+		return 0;
+	if (!(range->values = malloc (sizeof (long))))
+		return -1;
+	range->values[0] = value;
+	range->nbValues = 1;
+	return 0;
+}
+
+/**
+ * Main loop of a worker: do the next run of the batch until there is
+ * none left. The output of the simulations is discarded.
+ *
+ * @param shared the mapping shared by the workers
+ * @param nbTasks the number of runs of the batch
+ * @param seed the seed of the first replication, the next ones follow it
+ * @param scenario the schedule of the arrivals, replayed by every run (0: drawn)
+ * @see run_batch for the other parameters
+ */
+static void batch_worker (BatchShared * shared, long nbTasks, unsigned long seed,
+		BatchRange * switchTimes, BatchRange * timelapses, BatchRange * nbCars,
+		int nbRuns, int saturationFlow, char * networkFile, Scenario * scenario) {
+	long task, config;
+	int nullOutput, loaded, t, a, n;
+	Network network;
+	EngineResult result;
+
+	if ((nullOutput = open ("/dev/null", O_WRONLY)) != -1) {
+		dup2 (nullOutput, STDOUT_FILENO);
+		close (nullOutput);
+	}
+
+	while ((task = atomic_fetch_add (&shared->next, 1)) < nbTasks) {
+		config = task / nbRuns;
+		t = switchTimes->values[config / (timelapses->nbValues * nbCars->nbValues)];
+		a = timelapses->values[(config / nbCars->nbValues) % timelapses->nbValues];
+		n = nbCars->values[config % nbCars->nbValues];
+
+		if (networkFile)
+			loaded = network_load (&network, networkFile, t);
+		else
+			loaded = network_single (&network, t);
+		if (loaded == -1) {
+			shared->runs[task].status = 8;
+			continue;
+		}
+
+		/* Each replication draws its own cars, or replays the whole schedule. The
+		   configurations share the seeds of their replications: they differ by their
+		   settings, not by the draws (common random numbers). */
+		if (scenario)
+			scenario_rewind (scenario);
+		shared->runs[task].status = run_engine (&network, n, a, saturationFlow, scenario,
+			seed + task % nbRuns, &result);
+		shared->runs[task].result = result;
+		network_free (&network);
+	}
+}
+
+/**
+ * Print the summary row of a configuration.
+ *
+ * @param runs the replications of the configuration
+ * @param nbRuns the number of replications
+ * @param t the minimum waiting time before going to the green light
+ * @param a the maximum waiting time before a new car appear
+ * @param n the number of cars
+ */
+static void batch_report (BatchRun * runs, int nbRuns, long t, long a, long n) {
+	double endTime = 0, throughput = 0, stops = 0, wait = 0, cars = 0;
+	long maxWait = 0, maxQueue = 0;
+	int i, nbDone = 0;
+
+	for (i = 0; i < nbRuns; i++) {
+		if (runs[i].status != 0)
+			continue;
+		nbDone++;
+		endTime += runs[i].result.endTime;
+		if (runs[i].result.endTime)
+			throughput += runs[i].result.nbCars * 1000000.0 / runs[i].result.endTime;
+		stops += runs[i].result.nbStops;
+		wait += runs[i].result.totalWait;
+		cars += runs[i].result.nbCars;
+		if (runs[i].result.maxWait > maxWait)
+			maxWait = runs[i].result.maxWait;
+		if (runs[i].result.maxQueue > maxQueue)
+			maxQueue = runs[i].result.maxQueue;
+	}
+
+	printf ("%s,%ld,%ld,%ld,%d,%d,%.0f,%.3f,%.1f,%.0f,%ld,%ld\n", controller_name (controllerPolicy),
+		t, a, n, nbRuns, nbRuns - nbDone,
+		nbDone ? endTime / nbDone : 0, nbDone ? throughput / nbDone : 0,
+		nbDone ? stops / nbDone : 0, cars ? wait / cars : 0, maxWait, maxQueue);
+}
+
+/**
+ * Run every configuration of the sweep and print one CSV row per
+ * configuration on the standard output.
+ *
+ * @param switchTimes the values of the minimum waiting time before going to the green light
+ * @param timelapses the values of the maximum waiting time before a new car appear
+ * @param nbCars the values of the number of cars
+ * @param nbRuns the number of replications of each configuration
+ * @param nbJobs the number of worker processes (0: one per online core)
+ * @param saturationFlow the number of cars released per hour of green light
+ * @param networkFile the topology file of the road network (0: the single junction)
+ * @param scenario the schedule of the arrivals (0: the arrivals are drawn)
+ *
+ * @return 0 if every run succeeded, a specific number otherwise
+ */
+int run_batch (BatchRange * switchTimes, BatchRange * timelapses, BatchRange * nbCars,
+		int nbRuns, int nbJobs, int saturationFlow, char * networkFile, Scenario * scenario) {
+	long nbConfigs = (long) switchTimes->nbValues * timelapses->nbValues * nbCars->nbValues;
+	long nbTasks = nbConfigs * nbRuns, config, i;
+	size_t size = sizeof (BatchShared) + nbTasks * sizeof (BatchRun);
+	BatchShared * shared;
+	Network network;
+	unsigned long seed = simuSeed;	/* Same series of runs, whichever worker does them. */
+	pid_t * workers;
+	int nbWorkers, exec = 0;
+
+	/* Check the topology once, rather than in every run. */
+	if (networkFile) {
+		if (network_load (&network, networkFile, switchTimes->values[0]) == -1)
+			return 8;
+		network_free (&network);
+	}
+
+	shared = mmap (0, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (shared == MAP_FAILED) {
+		perror ("Error creating shared memory");
+		return 2;
+	}
+	atomic_init (&shared->next, 0);
+	for (i = 0; i < nbTasks; i++)
+		shared->runs[i].status = -1;
+
+	nbWorkers = nbJobs > 0 ? nbJobs : (int) sysconf (_SC_NPROCESSORS_ONLN);
+	if (nbWorkers < 1)
+		nbWorkers = 1;
+	if (nbWorkers > nbTasks)
+		nbWorkers = nbTasks;
+	if (!(workers = malloc (nbWorkers * sizeof (pid_t)))) {
+		perror ("Error creating batch");
+		munmap (shared, size);
+		return 2;
+	}
+
+	fflush (stdout);	/* Do not print the pending output in each worker. */
+	for (i = 0; i < nbWorkers; i++) {
+		switch (workers[i] = fork ()) {
+			case -1:
+				perror ("fork failed");
+				exec = 3;
+				break;
+			case 0:
+				batch_worker (shared, nbTasks, seed, switchTimes, timelapses, nbCars,
+					nbRuns, saturationFlow, networkFile, scenario);
+				exit (0);
+		}
+		if (exec) {
+			nbWorkers = i;
+			break;
+		}
+	}
+	for (i = 0; i < nbWorkers; i++)
+		while (waitpid (workers[i], 0, 0) == -1 && errno == EINTR);	/* Interrupted by a signal. */
+	free (workers);
+
+	puts ("controller,switch_time,timelapse,cars,runs,failed,end_time,throughput,stops,mean_wait,max_wait,max_queue");
+	for (config = 0; config < nbConfigs; config++) {
+		batch_report (&shared->runs[config * nbRuns], nbRuns,
+			switchTimes->values[config / (timelapses->nbValues * nbCars->nbValues)],
+			timelapses->values[(config / nbCars->nbValues) % timelapses->nbValues],
+			nbCars->values[config % nbCars->nbValues]);
+		for (i = 0; i < nbRuns; i++)
+			if (!exec && shared->runs[config * nbRuns + i].status != 0)
+				exec = 9;
+	}
+	fflush (stdout);
+
+	munmap (shared, size);
+	return exec;
+}
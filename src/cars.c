@@ -15,197 +15,444 @@
 #include "../inc/cars.h"
 
 /**
- * Generate the cars/threads.
+ * Monotonic date of the start of the generation (@see pool_now).
+ */
+static long start;
+
+/**
+ * Number of cars which have passed the traffic lights.
+ */
+static long nbPassedCars;
+
+/**
+ * Number of cars to be generated.
+ */
+static long nbTotalCars;
+
+/**
+ * Posted when the last car has passed (async-signal-safe wait).
+ */
+static sem_t lastCar;
+
+/**
+ * Stream of the arrivals, drawn by the generator only.
+ */
+static Rng arrivalStream;
+
+/**
+ * Time between the release of two cars waiting on a green lane (0: no limit).
+ */
+static long headway;
+
+/**
+ * Factor of the rate of the arrivals set by the user, in NOTICE_RATE_UNIT.
+ */
+static atomic_int arrivalRate;
+
+/**
+ * Set while the user stops the arrivals.
+ */
+static atomic_int arrivalsPaused;
+
+/**
+ * Posted when the user starts the arrivals again.
+ */
+static sem_t resumed;
+
+/**
+ * Run the notices received by the process of the cars, in their order of
+ * sending, until the stop notice.
+ *
+ * @param arg unused
+ */
+static void * cars_dispatch (void * arg) {
+	Notice * received[CHANNEL_BATCH];
+	int n, i, stop = 0;
+
+	while (!stop) {
+		n = channel_receive (&notices, received, CHANNEL_BATCH);
+		for (i = 0; i < n && !stop; i++) {
+			hist_record (&simuStats.notices, channel_latency (received[i]));
+			if (received[i]->type == NOTICE_RELEASE)
+				cars_release (received[i]->lane);
+			else if (received[i]->type == NOTICE_LANE)
+				lane_switch (received[i]->lane);
+			else if (received[i]->type == NOTICE_RATE)
+				cars_rate (received[i]->lane);
+			else if (received[i]->type == NOTICE_PAUSE || received[i]->type == NOTICE_RESUME)
+				cars_pause (received[i]->type == NOTICE_PAUSE);
+			else if (received[i]->type == NOTICE_STATS)
+				cars_status ();
+			else
+				stop = 1;
+		}
+		channel_release (&notices, n);
+	}
+	return 0;
+}
+
+/**
+ * Generate the cars.
  * 
- * Allow waiting cars to go when the traffic light is green. Waits for
- * the last one to finish before signaling the parent process.
+ * Each car is a sequence of tasks run by a fixed pool of worker threads.
+ * Allow waiting cars to go when the traffic light is green, as notified
+ * through the channel. Waits for the last one to pass before raising the
+ * end flag. The cars arrive as drawn by the demand, or as scheduled by a
+ * scenario until its schedule ends. Each arrival is a timer of the pool
+ * at its date from the start, set up to CARS_LOOKAHEAD ahead: the time
+ * taken to send the cars does not slow the demand down, and a high rate
+ * does not wake the generator for each car. The user's commands stretch
+ * or shrink the delays between the cars, and stop them for a while.
  * 
  * @param nbCars the number of cars to be generated
  * @param timelapseNewCars the maximum waiting time before a new car appear
- * @param mode
+ * @param saturationFlow the number of cars released per hour of green light
+ * @param scenario the schedule of the arrivals (0: the arrivals are drawn)
  * 
  * @return	0 if success, a specific number if an error occured
  */
-int generate_cars (int nbCars, int timelapseNewCars) {
-	time_t timestamp = time (NULL);
-	struct tm * timeStruct;
-	struct timeval start, end;
-
-	struct sigaction go;	/*	Used when traffic light switch to green
-								for allow cars to pass. */
-	struct sigaction newLane;	/*	Used to update the defined lane for the
-									cars/threads. */
-	long car = 0;
-
-	time (&timestamp);
-	timeStruct = localtime (&timestamp);
-	gettimeofday (&start, NULL);
-
-	go.sa_handler = cars_toggle_go;
-	sigaction (RELEASE_CARS, &go, 0);
-	newLane.sa_handler = lane_toggle_switch;
-	sigaction (SWITCH_LANE, &newLane, 0);
-	
-	/* Creation of the mutex and an attached condition. */
-	if ((pthread_mutex_init (&goMut, 0)) == -1) {
+int generate_cars (int nbCars, int timelapseNewCars, int saturationFlow, Scenario * scenario) {
+	pthread_t dispatcher;	/* Runs the notices of the junction and of the user. */
+	long car = 0, date, drawn = 0, planned = 0, paused;
+	int lane = 0, read = 1;
+	Car arriving;	/* The next new car, with its own stream. */
+	Demand demand;
+
+	start = pool_now ();
+	nbPassedCars = 0;
+	nbTotalCars = nbCars;
+	headway = crossroads_headway (saturationFlow);
+
+	/* Creation of the mutex and of the queues of waiting cars. */
+	if ((pthread_mutex_init (&goMut, 0)) != 0) {
 		perror ("Error creating mutex");
 		return 4;
 	}
-	if (pthread_cond_init (&goCond, 0) == -1) {
+	if (sem_init (&lastCar, 0, 0) == -1 || sem_init (&resumed, 0, 0) == -1) {
 		perror ("Error creating threads condition");
 		pthread_mutex_destroy (&goMut);
 		return 5;
 	}
+	atomic_store (&arrivalRate, NOTICE_RATE_UNIT);
+	atomic_store (&arrivalsPaused, 0);
+	if (lq_init (&waitingCars[0]) == -1) {
+		perror ("Error creating lane queue");
+		pthread_mutex_destroy (&goMut);
+		return 5;
+	}
+	if (lq_init (&waitingCars[1]) == -1) {
+		perror ("Error creating lane queue");
+		lq_free (&waitingCars[0]);
+		pthread_mutex_destroy (&goMut);
+		return 5;
+	}
 
-	srandom (pthread_self ());	/* Initialize random generator */
+	rng_seed (&arrivalStream, simuSeed, RNG_ARRIVAL_STREAM);
+	demand_init (&demand, &simuDemand, &arrivalStream, timelapseNewCars);
 
-	/* Creation of cars/threads */
-	for (car = 0; car < nbCars; car++) {
-		usleep (random() % timelapseNewCars);
-		pthread_create (&threads[car], 0, driving_car, (void *) car);
+	if (pool_init (&carPool, 0, cars_run_task) == -1) {
+		perror ("Error creating worker threads");
+		lq_free (&waitingCars[0]);
+		lq_free (&waitingCars[1]);
+		pthread_mutex_destroy (&goMut);
+		return 7;
 	}
-	/* No more car: destroy all threads and ressouces, and signal parent. */
-
-	gettimeofday (&end, NULL);
-	printf (
-		" T%02d:%02d:%010ld|\t\tVOITURE : aucune nouvelle voiture en vue ...\n",
-		timeStruct->tm_min,
-		timeStruct->tm_sec,
-		(end.tv_sec*1000000+end.tv_usec)-(start.tv_sec*1000000+start.tv_usec)
-	);
 
-	usleep (timelapseNewCars*2);	/* Enough to wait parent last instruction. */
+	if (pthread_create (&dispatcher, 0, cars_dispatch, 0) != 0) {
+		perror ("Error creating dispatcher thread");
+		pool_destroy (&carPool);
+		lq_free (&waitingCars[0]);
+		lq_free (&waitingCars[1]);
+		pthread_mutex_destroy (&goMut);
+		return 7;
+	}
 
-	/* Want all thread child... */
+	/* Arrival of the cars */
 	for (car = 0; car < nbCars; car++) {
-		pthread_join (threads[car], 0);
+		if (!scenario) {
+			demand_next (&demand, &date, &lane);
+		} else {
+			if ((read = scenario_next (scenario, &date, &lane)) != 1)
+				break;
+			if (lane > 1) {
+				fprintf (stderr, "%s: the junction has no lane %d\n", scenario->path, lane + 1);
+				read = -1;
+				break;
+			}
+		}
+		/* The rate set by the user scales the delay since the previous car. */
+		planned += (date - drawn) * NOTICE_RATE_UNIT
+			/ atomic_load_explicit (&arrivalRate, memory_order_relaxed);
+		drawn = date;
+		/* Stopped by the user: the next cars come as much later. */
+		if (atomic_load (&arrivalsPaused)) {
+			paused = pool_now ();
+			while (atomic_load (&arrivalsPaused))
+				while (sem_wait (&resumed) == -1);
+			planned += pool_now () - paused;
+		}
+		/* Beyond the lookahead: wait until half of it is left. */
+		if (planned - (pool_now () - start) > CARS_LOOKAHEAD)
+			pool_sleep_until (start + planned - CARS_LOOKAHEAD / 2);
+		/* Same seed, same draws: each car carries its own stream, whichever thread runs it. */
+		arriving.id = car;
+		rng_seed (&arriving.rng, simuSeed, RNG_CAR_STREAM (car));
+		pool_submit (&carPool, start + planned, EV_CAR_ARRIVAL, &arriving, lane);
+		metrics_add (&metrics->generated, 1);
+	}
+	/* The schedule ends before the last car: the cars already generated are the last ones. */
+	if (car < nbCars) {
+		pthread_mutex_lock (&goMut);
+		nbTotalCars = simuStats.nbCars = car;
+		if (nbPassedCars == car) {
+			simuStats.duration = pool_now () - start;
+			sem_post (&lastCar);
+		}
+		pthread_mutex_unlock (&goMut);
 	}
+	/* No more car: wait for the last ones, destroy ressouces, and stop the junction. */
+
+	log_event (LOG_NO_MORE_CARS, pool_now () - start, 0, 0, 0);
+
+	/* Want all cars passed... */
+	while (car > 0 && sem_wait (&lastCar) == -1);
+
+	/* The notices sent before are run first: the dispatcher is done with the pool. */
+	channel_send (&notices, NOTICE_STOP, 0);
+	pthread_join (dispatcher, 0);
+	pool_destroy (&carPool);
+	lq_free (&waitingCars[0]);
+	lq_free (&waitingCars[1]);
+	sem_destroy (&lastCar);
+	sem_destroy (&resumed);
 	pthread_mutex_destroy (&goMut);
-	pthread_cond_destroy (&goCond);
 
-	// while (!shared->stopSig)
-		kill (getppid (), INTERRUPT_CIRCULATION);
+	crossroads_stop ();
 
-	return 0;	
+	return read == -1 ? 11 : 0;	
 }
 
 /**
- * Simulates the behavior of a car.
- * 
- * The car/thread positions itself in a lane, checks whether or not the conditions
- * allow to pass a traffic light or not, and acts accordingly.
+ * Run a task of the pool: a step of a car, or the release of a lane.
  * 
- * @param i The number of the car/thread
+ * @param task the task to run
  */
-void * driving_car (void * i) {
-	time_t timestamp = time (NULL);
-	struct tm * timeStruct;
-	struct timeval start, end;
+void cars_run_task (Event * task) {
+	if (task->type == EV_LANE_DISCHARGE)
+		lane_discharge (task->lane);
+	else
+		driving_car (task);
+}
 
-	int laneChoice;
+/**
+ * Simulates the behavior of a car, one step at a time.
+ * 
+ * On arrival, the car positions itself in a lane and checks whether or not
+ * the conditions allow to pass a traffic light. If so, its passage is
+ * scheduled, otherwise it joins the end of the lane's queue until the light
+ * goes green.
+ * 
+ * @param step the task: the car's number and the step to run
+ */
+void driving_car (Event * step) {
+	LaneQueue * queue;
+	int laneChoice, parked = 0, discharge = 0;
+	long waiting = 0;
 
-	time (&timestamp);
-	timeStruct = localtime (&timestamp);
-	gettimeofday (&start, NULL);
+	if (step->type == EV_CAR_PASSED) {
+		log_event (LOG_CAR_PASSED, pool_now () - start, step->car.id, step->lane, 0);
+		stats_passage (&simuStats, step->lane, step->car.arrival, pool_now () - start);
+		metrics_add (&metrics->lanes[step->lane].passed, 1);
 
-	if (!simuAutoMode) {
 		pthread_mutex_lock (&goMut);
-
-		/* Interactive simulation: the car/thread musts be in the defined lane */
-		laneChoice = laneUserChoice;
-
+		if (++nbPassedCars == nbTotalCars) {
+			simuStats.duration = pool_now () - start;
+			sem_post (&lastCar);
+		}
 		pthread_mutex_unlock (&goMut);
-	} else {
-		srandom (pthread_self ());	/* Initialize random generator */
-		laneChoice = random() % 2;	
+		return;
 	}
+
+	pthread_mutex_lock (&goMut);
+
+	/* Interactive simulation: the car musts be in the defined lane. The lane is drawn
+	   even if given: the passage is drawn at the same place of the stream of the car,
+	   as when it is replayed (@see run_engine). */
+	laneChoice = car_choose_lane (&step->car.rng);
+	if (step->lane != -1)
+		laneChoice = step->lane;
+
+	pthread_mutex_unlock (&goMut);
 	
-	gettimeofday (&end, NULL);
-	printf (
-		" T%02d:%02d:%010ld|\t\tVOITURE : arrivée de la voiture %ld sur la voie %d\n",
-		timeStruct->tm_min,
-		timeStruct->tm_sec,
-		(end.tv_sec*1000000+end.tv_usec)-(start.tv_sec*1000000+start.tv_usec),
-		(long) i+1,
-		laneChoice+1
-	);
-
-	if (shared->onRedLight == laneChoice) {
-		gettimeofday (&end, NULL);
-		printf (
-			" T%02d:%02d:%010ld|\t\tVOITURE : la voiture %ld est en attente\n",
-			timeStruct->tm_min,
-			timeStruct->tm_sec,
-			(end.tv_sec*1000000+end.tv_usec)-(start.tv_sec*1000000+start.tv_usec),
-			(long) i+1
-		);
-
-		P (mutex[1]);
-		shared->nbWaitingCars++;
-		gettimeofday (&end, NULL);
-		printf (
-			" T%02d:%02d:%010ld|\t\tVOITURE : il y a %d voiture(s) en attente\n",
-			timeStruct->tm_min,
-			timeStruct->tm_sec,
-			(end.tv_sec*1000000+end.tv_usec)-(start.tv_sec*1000000+start.tv_usec),
-			shared->nbWaitingCars
-		);
-		V (mutex[1]);
+	log_event (LOG_CAR_ARRIVAL, pool_now () - start, step->car.id, laneChoice, 0);
+	step->car.arrival = pool_now () - start;	/* Carried to its passage. */
+
+	/* If the traffic light is red, or if cars are still queued on a green
+	   light, the car waits its turn behind them. */
+	/* Counted for the controller of the lights. */
+	atomic_fetch_add_explicit (&shared->laneArrivals[laneChoice], 1, memory_order_relaxed);
+	metrics_add (&metrics->lanes[laneChoice].arrivals, 1);
+
+	queue = &waitingCars[laneChoice];
+	pthread_mutex_lock (&queue->mut);
+	if (atomic_load_explicit (&shared->onRedLight, memory_order_acquire) == laneChoice
+			|| queue->size != 0) {
+		if (lq_push (queue, &step->car) == 0) {
+			parked = 1;
+			/* Counted, then the light read again (both sequentially consistent): either
+			   the junction going green sees this car, or this car sees the green. */
+			atomic_fetch_add (&shared->laneWaitingCars[laneChoice], 1);
+			waiting = atomic_fetch_add_explicit (&shared->nbWaitingCars, 1, memory_order_relaxed) + 1;
+			metrics_add (&metrics->lanes[laneChoice].queue, 1);
+			metrics_add (&metrics->lanes[laneChoice].stops, 1);
+			if (atomic_load (&shared->onRedLight) != laneChoice && !queue->discharging)
+				discharge = queue->discharging = 1;
+		}
 	}
+	pthread_mutex_unlock (&queue->mut);
 
-	/* If the traffic light is red, the car waits until it go to green. */
-	while (shared->onRedLight == laneChoice) {
-		pthread_mutex_lock (&goMut);
+	if (!parked) {	/* It takes a while for the car to pass... */
+		pool_submit (&carPool, pool_now () + car_pass_delay (&step->car.rng),
+			EV_CAR_PASSED, &step->car, laneChoice);
+		return;
+	}
+	if (discharge)
+		pool_submit (&carPool, pool_now (), EV_LANE_DISCHARGE, 0, laneChoice);
 
-		/* Wait the parent-thread signal to pass the condition. */
-		pthread_cond_wait (&goCond, &goMut);
+	stats_queue (&simuStats, waiting);
+	log_event (LOG_CAR_WAITING, pool_now () - start, step->car.id, laneChoice, 0);
+	log_event (LOG_CARS_WAITING, pool_now () - start, step->car.id, laneChoice, waiting);
+}
 
-		pthread_mutex_unlock (&goMut);
+/**
+ * Release the cars waiting on a green lane, in their order of arrival.
+ * 
+ * Without saturation flow, the whole queue goes at once. Otherwise the first
+ * car goes, and the release of the next one is scheduled one headway later,
+ * until the queue is empty or the light goes red again.
+ * 
+ * @param lane the lane's number
+ */
+void lane_discharge (int lane) {
+	LaneQueue * queue = &waitingCars[lane];
+	long released = 0;
+	Car car;
+
+	pthread_mutex_lock (&queue->mut);
+	while (atomic_load_explicit (&shared->onRedLight, memory_order_acquire) != lane
+			&& lq_pop (queue, &car)) {
+		pool_submit (&carPool, pool_now () + car_pass_delay (&car.rng), EV_CAR_PASSED,
+			&car, lane);
+		released++;
+		if (headway)
+			break;
 	}
 
-	usleep (random() % 1000000);	/* It takes a while for the car to pass... */
-	gettimeofday (&end, NULL);
-	printf (
-		" T%02d:%02d:%010ld|\t\tVOITURE : la voiture %ld est passée\n",
-		timeStruct->tm_min,
-		timeStruct->tm_sec,
-		(end.tv_sec*1000000+end.tv_usec)-(start.tv_sec*1000000+start.tv_usec),
-		(long) i+1
-	);
+	atomic_fetch_sub_explicit (&shared->laneWaitingCars[lane], released, memory_order_relaxed);
+	atomic_fetch_sub_explicit (&shared->nbWaitingCars, released, memory_order_relaxed);
+	metrics_add (&metrics->lanes[lane].queue, -released);
 
-	return 0;
+	if (headway && queue->size != 0
+			&& atomic_load_explicit (&shared->onRedLight, memory_order_acquire) != lane)
+		pool_submit (&carPool, pool_now () + headway, EV_LANE_DISCHARGE, 0, lane);
+	else
+		queue->discharging = 0;	/* The next green light restarts the release. */
+	pthread_mutex_unlock (&queue->mut);
 }
 
 /**
- * Unlock the cars/threads waiting at a traffic light.
+ * Choose the lane on which a new car arrives: the user's choice in
+ * interactive mode, a random lane in automatic mode. The lane is drawn
+ * in both modes, so that the next draws of the car do not depend on it.
  * 
- * @param sigNum the signal associated to the calling function
+ * @param rng the stream of the car
+ * 
+ * @return the lane's number
  */
-void cars_toggle_go (int sigNum) {
-	pthread_mutex_lock (&goMut);
+int car_choose_lane (Rng * rng) {
+	int drawn = rng_below (rng, 2);
 
-	/* The parent/thread signal all waiting cars/threads to pass. */
-	pthread_cond_broadcast (&goCond);
+	return simuAutoMode ? drawn : laneUserChoice;
+}
 
-	pthread_mutex_unlock (&goMut);
+/**
+ * Draw the time it takes for a car to pass the traffic light.
+ * 
+ * @param rng the stream of the car
+ * 
+ * @return the delay in microseconds
+ */
+long car_pass_delay (Rng * rng) {
+	return rng_below (rng, 1000000);
+}
+
+/**
+ * Unlock the cars waiting at a traffic light.
+ * 
+ * Only the queue of the lane going green is woken up.
+ * 
+ * @param lane the lane going green
+ */
+void cars_release (int lane) {
+	LaneQueue * queue = &waitingCars[lane];
+	int discharge = 0;
+
+	pthread_mutex_lock (&queue->mut);
+	if (queue->size != 0 && !queue->discharging)
+		discharge = queue->discharging = 1;
+	pthread_mutex_unlock (&queue->mut);
+
+	if (discharge)
+		pool_submit (&carPool, pool_now (), EV_LANE_DISCHARGE, 0, lane);
 }
 
 /**
  * Update the lane on which the new generated cars/threads must arrive.
  * 
- * @param sigNum the signal associated to the calling function
+ * @param lane the lane chosen by the user
  */
-void lane_toggle_switch (int sigNum) {
+void lane_switch (int lane) {
 	pthread_mutex_lock (&goMut);
-
-	P (mutex[2]);
-	if (shared->userCmdInterMode == LANE_ONE_KEY) {
-		laneUserChoice = 0;
-	} else if (shared->userCmdInterMode == LANE_TWO_KEY) {
-		laneUserChoice = 1;
-	}
-	V (mutex[2]);
-	printf ("\n\t[ COMMAND: CHOOSE LANE %d ]\n\n", laneUserChoice+1);
+	laneUserChoice = lane;
+	log_event (LOG_LANE_COMMAND, pool_now () - start, 0, laneUserChoice, 0);
 
 	pthread_mutex_unlock (&goMut);
-}
\ No newline at end of file
+}
+
+/**
+ * Change the rate of the arrivals of the new cars, as asked by the user.
+ * 
+ * @param rate the factor of the rate of the demand, in NOTICE_RATE_UNIT
+ */
+void cars_rate (int rate) {
+	atomic_store_explicit (&arrivalRate, rate, memory_order_relaxed);
+}
+
+/**
+ * Stop or start again the arrivals of the new cars, as asked by the user.
+ * The cars already due within the lookahead still arrive.
+ * 
+ * @param pause 1 to stop the arrivals, 0 to start them again
+ */
+void cars_pause (int pause) {
+	if (pause)
+		atomic_store (&arrivalsPaused, 1);
+	else if (atomic_exchange (&arrivalsPaused, 0))
+		sem_post (&resumed);	/* A post left by a former resume only makes the generator check again. */
+}
+
+/**
+ * Print the counters of the cars, as asked by the user.
+ */
+void cars_status () {
+	log_flush ();	/* After the events logged before. */
+	printf ("\n\t[ STATUS: %ld generated, %ld passed, %ld waiting (lane 1: %ld, lane 2: %ld),"
+		" rate x%.3f%s ]\n\n",
+		atomic_load (&metrics->generated),
+		atomic_load (&metrics->lanes[0].passed) + atomic_load (&metrics->lanes[1].passed),
+		atomic_load (&metrics->lanes[0].queue) + atomic_load (&metrics->lanes[1].queue),
+		atomic_load (&metrics->lanes[0].queue), atomic_load (&metrics->lanes[1].queue),
+		(double) atomic_load (&arrivalRate) / NOTICE_RATE_UNIT,
+		atomic_load (&arrivalsPaused) ? ", paused" : "");
+	fflush (stdout);
+}
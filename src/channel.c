@@ -0,0 +1,102 @@
+/**
+ *
+ * @file channel.c
+ * Notices sent to the process of the cars.
+ *
+ * Implementation of functions defined in @see channel.h
+ *
+ * @version 1.0
+ *
+ * ********************************************************* */
+#include <time.h>
+#include "../inc/channel.h"
+
+/**
+ * Give the monotonic date in microseconds, the same in every process.
+ */
+static long channel_now () {
+	struct timespec now;
+	clock_gettime (CLOCK_MONOTONIC, &now);
+	return now.tv_sec*1000000 + now.tv_nsec/1000;
+}
+
+/**
+ * Open a channel. Every process forked afterwards can send and receive.
+ *
+ * @param channel the channel to open
+ *
+ * @return 0 if success, -1 otherwise
+ */
+int channel_open (Channel * channel) {
+	channel->ring = ringalloc (sizeof (Notice), CHANNEL_CAPACITY);
+	return channel->ring ? 0 : -1;
+}
+
+/**
+ * Close a channel in the calling process.
+ *
+ * @param channel the channel to close
+ */
+void channel_close (Channel * channel) {
+	ringfree (channel->ring);
+	channel->ring = 0;
+}
+
+/**
+ * Send a notice, waiting for room if the channel is full.
+ *
+ * The notice is written directly in its slot of the ring: the sender
+ * enters the kernel only to wake a sleeping receiver.
+ *
+ * @param channel the channel
+ * @param type the kind of notice
+ * @param lane the lane concerned, or the value of a command
+ *
+ * @return 0 if success, -1 otherwise
+ */
+int channel_send (Channel * channel, int type, int lane) {
+	Notice * notice;
+
+	if (ringreserve (channel->ring, (void **) &notice, 1) == -1)
+		return -1;
+	notice->type = type;
+	notice->lane = lane;
+	notice->date = channel_now ();
+	ringcommit (channel->ring, (void **) &notice, 1);
+	return 0;
+}
+
+/**
+ * Wait for the next notices, to be read in place. Only one thread of
+ * one process receives.
+ *
+ * @param channel the channel
+ * @param notices the notices received, in their order of sending
+ * @param max the maximum number of notices
+ *
+ * @return the number of notices, at least 1
+ */
+int channel_receive (Channel * channel, Notice ** notices, int max) {
+	return ringpeek (channel->ring, (void **) notices, max);
+}
+
+/**
+ * Give back the room of the notices read.
+ *
+ * @param channel the channel
+ * @param n the number of notices given by channel_receive
+ */
+void channel_release (Channel * channel, int n) {
+	ringrelease (channel->ring, n);
+}
+
+/**
+ * Give the time a notice took to be received.
+ *
+ * @param notice the notice received
+ *
+ * @return the latency in microseconds
+ */
+long channel_latency (Notice * notice) {
+	return channel_now () - notice->date;
+}
@@ -0,0 +1,164 @@
+/**
+ *
+ * @file command.c
+ * Commands of the user, from the terminal or from a script.
+ *
+ * Implementation of functions defined in @see command.h
+ *
+ * @version 1.0
+ *
+ * ********************************************************* */
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "../inc/command.h"
+
+/**
+ * Send a command to the process of the cars.
+ *
+ * @param line the line holding the command
+ */
+static void command_run (char * line) {
+	int type, value;
+
+	/* Nobody runs the notices once the cars are done. */
+	if (atomic_load_explicit (&shared->stopSig, memory_order_relaxed))
+		return;
+	switch (command_parse (line, &type, &value)) {
+		case -1:
+			fprintf (stderr, " COMMAND: unknown command \"%s\", see the manual (option -m)\n", line);
+			return;
+		case 0:
+			return;
+	}
+	if (type == NOTICE_LANE)
+		atomic_store_explicit (&shared->userCmdInterMode,
+			value == 0 ? LANE_ONE_KEY : LANE_TWO_KEY, memory_order_relaxed);
+	if (channel_send (&notices, type, value) == -1)
+		perror ("Error sending notice");
+}
+
+/**
+ * Open the input of the commands. A FIFO is opened for writing as well:
+ * the scripts writing into it may come and go, the input never ends.
+ *
+ * @param path the name of the file or of the FIFO (0: the terminal)
+ *
+ * @return the file descriptor, -1 if the file could not be opened
+ */
+int command_open (char * path) {
+	struct stat status;
+
+	if (!path)
+		return STDIN_FILENO;
+	if (stat (path, &status) == 0 && S_ISFIFO (status.st_mode))
+		return open (path, O_RDWR | O_NONBLOCK);
+	return open (path, O_RDONLY | O_NONBLOCK);
+}
+
+/**
+ * Read a command.
+ *
+ * @param line the line holding the command, its comment is cut off
+ * @param type the kind of notice sent for the command
+ * @param value the value of the notice (@see Notice)
+ *
+ * @return 1 if a command is read, 0 if the line is blank, -1 if invalid
+ */
+int command_parse (char * line, int * type, int * value) {
+	char word[16], extra[2], * rest;
+	double rate;
+	int n;
+
+	line[strcspn (line, "#\r")] = '\0';
+	if (sscanf (line, " %15s %n", word, &n) != 1)
+		return 0;
+	rest = line + n;
+
+	if ((strcmp (word, "1") == 0 || strcmp (word, "2") == 0) && *rest == '\0') {
+		*type = NOTICE_LANE;
+		*value = word[0] == LANE_ONE_KEY ? 0 : 1;
+	} else if (strcmp (word, "lane") == 0) {
+		if (sscanf (rest, "%d %1s", value, extra) != 1 || *value < 1 || *value > 2)
+			return -1;
+		*type = NOTICE_LANE;
+		(*value)--;
+	} else if (strcmp (word, "rate") == 0) {
+		if (sscanf (rest, "%lf %1s", &rate, extra) != 1 || !(rate > 0) || rate > COMMAND_MAX_RATE)
+			return -1;
+		*type = NOTICE_RATE;
+		*value = (int) (rate * NOTICE_RATE_UNIT + 0.5);
+		if (*value < 1)
+			*value = 1;
+	} else if (*rest != '\0') {
+		return -1;
+	} else if (strcmp (word, "pause") == 0) {
+		*type = NOTICE_PAUSE;
+		*value = 0;
+	} else if (strcmp (word, "resume") == 0) {
+		*type = NOTICE_RESUME;
+		*value = 0;
+	} else if (strcmp (word, "stats") == 0) {
+		*type = NOTICE_STATS;
+		*value = 0;
+	} else {
+		return -1;
+	}
+	return 1;
+}
+
+/**
+ * Run the commands of the input, until its end or the end of the
+ * simulation.
+ *
+ * @param input the file descriptor of the input
+ */
+void command_loop (int input) {
+	char buffer[COMMAND_BUFFER_SIZE], * line, * newline;
+	struct pollfd ready;
+	size_t length = 0;
+	ssize_t n;
+	int skipping = 0;
+
+	atomic_store_explicit (&shared->userCmdInterMode, LANE_ONE_KEY, memory_order_relaxed);
+	ready.fd = input;
+	ready.events = POLLIN;
+
+	while (!atomic_load_explicit (&shared->stopSig, memory_order_relaxed)) {
+		/* Wake up now and then to see the end of the simulation. */
+		if (poll (&ready, 1, COMMAND_POLL_TIME) <= 0)
+			continue;
+		n = read (input, buffer + length, sizeof (buffer) - 1 - length);
+		if (n == -1 && (errno == EAGAIN || errno == EINTR))
+			continue;
+		if (n <= 0) {	/* The end of a file: its last line may lack its newline. */
+			buffer[length] = '\0';
+			if (length && !skipping)
+				command_run (buffer);
+			return;
+		}
+		length += n;
+
+		/* Run each whole line, keep the last one until its end comes. */
+		line = buffer;
+		while ((newline = memchr (line, '\n', buffer + length - line))) {
+			*newline = '\0';
+			if (!skipping)
+				command_run (line);
+			skipping = 0;
+			line = newline + 1;
+		}
+		length -= line - buffer;
+		memmove (buffer, line, length);
+		if (length == sizeof (buffer) - 1) {	/* Too long: dropped up to its end. */
+			fprintf (stderr, " COMMAND: line longer than %d characters ignored\n",
+				COMMAND_BUFFER_SIZE - 1);
+			skipping = 1;
+			length = 0;
+		}
+	}
+}
@@ -15,6 +15,62 @@
 #include <stdlib.h>
 #include "../inc/config.h"
 
+/**
+ * Long names of the command line options.
+ */
+static struct option longOptions[] = {
+	{"quiet", no_argument, 0, 'q'},
+	{"sync", required_argument, 0, OPT_SYNC},
+	{"sweep-t", required_argument, 0, OPT_SWEEP_T},
+	{"sweep-a", required_argument, 0, OPT_SWEEP_A},
+	{"sweep-n", required_argument, 0, OPT_SWEEP_N},
+	{"runs", required_argument, 0, OPT_RUNS},
+	{"jobs", required_argument, 0, OPT_JOBS},
+	{"reap", no_argument, 0, OPT_REAP},
+	{"seed", required_argument, 0, OPT_SEED},
+	{"demand", required_argument, 0, OPT_DEMAND},
+	{"rates", required_argument, 0, OPT_RATES},
+	{"profile", required_argument, 0, OPT_PROFILE},
+	{"platoon", required_argument, 0, OPT_PLATOON},
+	{"roles", required_argument, 0, OPT_ROLES},
+	{"trace", required_argument, 0, OPT_TRACE},
+	{"record", required_argument, 0, OPT_RECORD},
+	{"replay", required_argument, 0, OPT_REPLAY},
+	{"commands", required_argument, 0, OPT_COMMANDS},
+	{0, 0, 0, 0}
+};
+
+/**
+ * Apply a setting of a scenario file, with the checks of its option.
+ *
+ * @param name the name of the setting
+ * @param value the value of the setting
+ *
+ * @return 0 if the setting is valid, -1 otherwise
+ */
+static int config_setting (char * name, char * value) {
+	char * near;
+	long number = strtol (value, &near, 10);
+
+	if (strcmp (name, "controller") == 0)
+		return (controllerPolicy = controller_policy (value)) == -1 ? -1 : 0;
+	if (strcmp (name, "seed") == 0) {
+		simuSeed = strtoul (value, &near, 10);
+		return *near != '\0' ? -1 : 0;
+	}
+	if (*near != '\0' || number < 0)
+		return -1;
+	if (strcmp (name, "cars") == 0 && number <= 0x7fffffff)
+		nbMaxCars = (int) number;
+	else if (strcmp (name, "green") == 0 && number <= MAX_WAITING_TIME)
+		timeSwitchWay = (int) number;
+	else if (strcmp (name, "flow") == 0 && number <= 0x7fffffff)
+		saturationFlow = (int) number;
+	else
+		return -1;
+	return 0;
+}
+
 /**
  * 
  * Configure the program's environment from the information provided on
@@ -27,7 +83,7 @@
  */
 int analyze_command_line_args (int argc, char * argv[]) {
 	time_t timestamp  = time (NULL);
-	int i = 0, cmd;
+	int i = 0, cmd, controlled = 0;	/* Set if -c follows the scenario. */
     char * near = "";
 
 	time (&timestamp);
@@ -35,6 +91,21 @@ int analyze_command_line_args (int argc, char * argv[]) {
 	nbMaxCars = DEFAULT_NB_CARS;
 	timelapseNewCars = DEFAULT_MAX_TIMELAPSE;
 	timeSwitchWay = DEFAULT_WAITING_TIME;
+	saturationFlow = DEFAULT_SATURATION_FLOW;
+	syncBackend = IPC_BACKEND_SYSV;
+	simuRoles = ROLES_PROCESS;
+	networkFile = 0;
+	statsFile = 0;
+	traceFile = 0;
+	recordFile = 0;
+	commandFile = 0;
+	scenarioFile = 0;
+	controllerPolicy = CTRL_FIXED;
+	batchMode = 0;
+	batchRuns = DEFAULT_BATCH_RUNS;
+	batchJobs = 0;
+	demand_default (&simuDemand);
+	simuSeed = (unsigned long) timestamp ^ ((unsigned long) getpid () << 16);	/* Printed to replay the run. */
 
 	/* No argument specified: set the interactive mode with default value. */
 	if (argc < 2) {
@@ -45,7 +116,10 @@ int analyze_command_line_args (int argc, char * argv[]) {
 	for (i = 1; i < argc; i++) {
 		cmd = (int) strtol (argv[i], &near, 10);
 		if (strcmp (near, "") != 0) {	/* The argument is a string. */
-			if (strlen (argv[i]) <= 3) {	/* Maybe an option... */
+			/* Maybe an option... unless it is the value of a long option or of a name. */
+			if (strlen (argv[i]) <= 3 && strncmp (argv[i-1], "--", 2) != 0
+					&& strcmp (argv[i-1], "-c") != 0 && strcmp (argv[i-1], "-g") != 0
+					&& strcmp (argv[i-1], "-o") != 0 && strcmp (argv[i-1], "-f") != 0) {
 				if (strchr (argv[i], '-') == NULL) {
 					fprintf (stderr, "Unknow option at index %d, use -h for help\n", i+1);
 					return -1;
@@ -60,11 +134,11 @@ int analyze_command_line_args (int argc, char * argv[]) {
 	}       
 
 	/* Second check and setting up */
-    while ((cmd = getopt (argc, argv, "n:a:t:vhm")) != EOF) {
+    while ((cmd = getopt_long (argc, argv, "n:a:t:s:g:o:c:f:rqvhm", longOptions, 0)) != EOF) {
     	switch (cmd) {
 			case 'n':	/* Number of cars option. */
 				nbMaxCars = (int) strtol (optarg, &near, 10);
-				if (nbMaxCars < 0 || nbMaxCars > 50) {
+				if (nbMaxCars < 0) {
 					fprintf (stderr, "Unauthorized number at index %d, use -h for help\n", optind);
 					return -1;
 				}
@@ -82,11 +156,144 @@ int analyze_command_line_args (int argc, char * argv[]) {
 				break;
 			case 't':	/* Timelapse before the traffic light go to green */
 				timeSwitchWay = (int) strtol (optarg, &near, 10);
-				if (timeSwitchWay < 0 || timeSwitchWay > 1000000) {
+				if (timeSwitchWay < 0 || timeSwitchWay > MAX_WAITING_TIME) {
+					fprintf (stderr, "Unauthorized number at index %d, use -h for help\n", optind);
+					return -1;
+				}
+				break;
+			case 's':	/* Saturation flow of a green lane */
+				saturationFlow = (int) strtol (optarg, &near, 10);
+				if (saturationFlow < 0) {
+					fprintf (stderr, "Unauthorized number at index %d, use -h for help\n", optind);
+					return -1;
+				}
+				break;
+			case 'g':	/* Road network */
+				networkFile = optarg;
+				simuAutoMode = 1;
+				break;
+			case 'f':	/* Scenario: its settings apply, the next options override them */
+			case OPT_REPLAY:	/* A scenario which must be a recording */
+				if (scenarioFile)
+					scenario_close (&scenario);
+				scenarioFile = optarg;
+				simuAutoMode = 1;
+				if (scenario_open (&scenario, scenarioFile, config_setting) == -1) {
+					scenarioFile = 0;
+					return -1;
+				}
+				if (cmd == OPT_REPLAY && !scenario.binary) {
+					fprintf (stderr, "%s is not a recording, use -h for help\n", scenarioFile);
+					scenario_close (&scenario);
+					scenarioFile = 0;
+					return -1;
+				}
+				controlled = 0;
+				break;
+			case 'c':	/* Policy of the traffic lights */
+				if ((controllerPolicy = controller_policy (optarg)) == -1) {
+					fprintf (stderr, "Unknow controller at index %d, use -h for help\n", optind);
+					return -1;
+				}
+				controlled = 1;
+				break;
+			case 'o':	/* Export of the statistics */
+				statsFile = optarg;
+				break;
+			case 'q':	/* Quiet: count the events, do not print them */
+				simuQuiet = 1;
+				break;
+			case OPT_TRACE:	/* Trace of the simulation */
+				traceFile = optarg;
+				break;
+			case OPT_RECORD:	/* Recording of the inputs and decisions */
+				recordFile = optarg;
+				break;
+			case OPT_COMMANDS:	/* Commands of the user from a file or a FIFO */
+				commandFile = optarg;
+				break;
+			case OPT_SYNC:	/* Backend of the semaphores */
+				if (strcmp (optarg, "sysv") == 0) {
+					syncBackend = IPC_BACKEND_SYSV;
+				} else if (strcmp (optarg, "futex") == 0) {
+					syncBackend = IPC_BACKEND_FUTEX;
+				} else {
+					fprintf (stderr, "Unknow semaphore backend at index %d, use -h for help\n", optind);
+					return -1;
+				}
+				break;
+			case OPT_ROLES:	/* Processes or threads */
+				if (strcmp (optarg, "process") == 0) {
+					simuRoles = ROLES_PROCESS;
+				} else if (strcmp (optarg, "thread") == 0) {
+					simuRoles = ROLES_THREAD;
+				} else {
+					fprintf (stderr, "Unknow way of running the roles at index %d, use -h for help\n", optind);
+					return -1;
+				}
+				break;
+			case OPT_SWEEP_T:	/* Swept values of the parameters */
+			case OPT_SWEEP_A:
+			case OPT_SWEEP_N:
+				batchMode = 1;
+				simuAutoMode = 1;
+				if (batch_parse_range (cmd == OPT_SWEEP_T ? &sweepSwitchTimes
+						: cmd == OPT_SWEEP_A ? &sweepTimelapses : &sweepNbCars,
+						optarg, 0, cmd == OPT_SWEEP_N ? 0x7fffffff
+						: cmd == OPT_SWEEP_T ? MAX_WAITING_TIME : 10000000) == -1) {
+					fprintf (stderr, "Invalid values at index %d, use -h for help\n", optind);
+					return -1;
+				}
+				break;
+			case OPT_RUNS:	/* Replications of each configuration of a sweep */
+			case OPT_JOBS:	/* Worker processes of a sweep */
+				batchMode = 1;
+				simuAutoMode = 1;
+				i = (int) strtol (optarg, &near, 10);
+				if (*near != '\0' || i < (cmd == OPT_RUNS ? 1 : 0)) {
 					fprintf (stderr, "Unauthorized number at index %d, use -h for help\n", optind);
 					return -1;
 				}
+				if (cmd == OPT_RUNS)
+					batchRuns = i;
+				else
+					batchJobs = i;
 				break;
+			case OPT_SEED:	/* Seed of the random streams */
+				simuSeed = strtoul (optarg, &near, 10);
+				if (*near != '\0' || optarg == near) {
+					fprintf (stderr, "Unauthorized number at index %d, use -h for help\n", optind);
+					return -1;
+				}
+				break;
+			case OPT_DEMAND:	/* Model of the arrivals */
+				simuAutoMode = 1;
+				if ((simuDemand.model = demand_model (optarg)) == -1) {
+					fprintf (stderr, "Unknow demand model at index %d, use -h for help\n", optind);
+					return -1;
+				}
+				break;
+			case OPT_RATES:	/* Rates of the lanes */
+			case OPT_PROFILE:	/* Profile of the rates */
+			case OPT_PLATOON:	/* Platoons of cars */
+				simuAutoMode = 1;
+				if ((cmd == OPT_RATES ? demand_parse_rates (&simuDemand, optarg)
+						: cmd == OPT_PROFILE ? demand_parse_profile (&simuDemand, optarg)
+						: demand_parse_platoon (&simuDemand, optarg)) == -1) {
+					fprintf (stderr, "Invalid values at index %d, use -h for help\n", optind);
+					return -1;
+				}
+				break;
+			case 'r':	/* Real time automatic mode */
+				simuRealTime = 1;
+				break;
+			case OPT_REAP:	/* Cleanup of the killed instances */
+				if ((i = ipcreap ()) == -1) {
+					perror ("Error reading the instances");
+					return -1;
+				}
+				printf (" REAPER: %d instance(s) cleaned up\n", i);
+				return 0;
 			case 'v':	/* Version */
 				printf ("Crossroad Trafic Simulation v%f\n", VERSION);
 				return 0;
@@ -103,17 +310,99 @@ int analyze_command_line_args (int argc, char * argv[]) {
 		}
 	}
 
+	/* A road network is only simulated by the engine. */
+	if (networkFile && simuRealTime) {
+		fprintf (stderr, "A road network can not be run in real time, use -h for help\n");
+		return -1;
+	}
+
+	/* The rates and the profile only shape a random demand. */
+	if ((simuDemand.nbLanes || simuDemand.nbPeriods) && simuDemand.model == DEMAND_UNIFORM) {
+		fprintf (stderr, "The rates need a demand model (--demand), use -h for help\n");
+		return -1;
+	}
+	if (simuDemand.model == DEMAND_PIECEWISE && !simuDemand.nbPeriods) {
+		fprintf (stderr, "The piecewise demand needs a profile (--profile), use -h for help\n");
+		return -1;
+	}
+	if (simuDemand.nbLanes > 2 && !networkFile) {
+		fprintf (stderr, "The junction has only 2 lanes to rate, use -h for help\n");
+		return -1;
+	}
+
+	/* A sweep is only simulated by the engine. */
+	if (batchMode && simuRealTime) {
+		fprintf (stderr, "A parameter sweep can not be run in real time, use -h for help\n");
+		return -1;
+	}
+
+	/* On the virtual clock, the seed is enough to run a simulation again. */
+	if (recordFile && simuAutoMode && !simuRealTime) {
+		fprintf (stderr, "Only a real time or interactive run can be recorded, use -h for help\n");
+		return -1;
+	}
+
+	/* The engine runs without any user. */
+	if (commandFile && (batchMode || (simuAutoMode && !simuRealTime))) {
+		fprintf (stderr, "Only a real time or interactive run takes commands, use -h for help\n");
+		return -1;
+	}
+
+	/* The runs of a sweep log nothing. */
+	if (batchMode && traceFile) {
+		fprintf (stderr, "A parameter sweep can not be traced, use -h for help\n");
+		return -1;
+	}
+
+	/* The engine switches the lights of a recording as recorded, unless a controller
+	   follows it on the command line or its green time is swept (comparison of controllers
+	   on the same traffic). In real time or on a network, the controller always decides. */
+	if (scenarioFile && (controlled || sweepSwitchTimes.nbValues || simuRealTime || networkFile))
+		scenario.phases = 0;
+
+	/* The threads of a single process share nothing with other processes. */
+	if (simuRoles == ROLES_THREAD)
+		syncBackend = IPC_BACKEND_PRIVATE;
+
 	/* Analyze done: start with configured settings. */
 	puts (" ==== CTS ==================================");
 	printf (" SESSION: %s", ctime (&timestamp));
-	if (simuAutoMode)
-		puts (" MODE: AUTOMATIC\n");
+	if (batchMode)
+		puts (" MODE: PARAMETER SWEEP (VIRTUAL CLOCK)\n");
+	else if (simuAutoMode && simuRealTime)
+		puts (" MODE: AUTOMATIC (REAL TIME)\n");
+	else if (simuAutoMode)
+		puts (" MODE: AUTOMATIC (VIRTUAL CLOCK)\n");
 	else
 		puts (" MODE: INTERACTIVE\n");
 	puts (" CONFIGURATION");
 	printf (" Number of cars: %d\n", nbMaxCars);
 	printf (" Timelapse new arrival of a car: %d ms\n", timelapseNewCars);
 	printf (" Timelapse traffic light: %d ms\n", timeSwitchWay);
+	if (saturationFlow)
+		printf (" Saturation flow: %d cars/h\n", saturationFlow);
+	else
+		puts (" Saturation flow: unlimited");
+	printf (" Controller: %s\n", controller_name (controllerPolicy));
+	printf (" Seed: %lu\n", simuSeed);
+	printf (" Demand: %s\n", demand_name (simuDemand.model));
+	printf (" Semaphores: %s\n", syncBackend == IPC_BACKEND_FUTEX ? "futex"
+		: syncBackend == IPC_BACKEND_PRIVATE ? "private" : "sysv");
+	if (!simuAutoMode || simuRealTime)
+		printf (" Roles: %s\n", roles_name (simuRoles));
+	if (networkFile)
+		printf (" Network: %s\n", networkFile);
+	if (scenarioFile)
+		printf (" Scenario: %s%s\n", scenarioFile, scenario.phases ? " (recorded lights)" : "");
+	if (traceFile)
+		printf (" Trace: %s\n", traceFile);
+	if (recordFile)
+		printf (" Recording: %s\n", recordFile);
+	if (commandFile)
+		printf (" Commands: %s\n", commandFile);
+	if (batchMode)
+		printf (" Replications: %d, workers: %d\n", batchRuns,
+			batchJobs ? batchJobs : (int) sysconf (_SC_NPROCESSORS_ONLN));
 	puts (" ===========================================\n");
 
 	return 1;
@@ -132,7 +421,8 @@ void help_menu () {
 
 	puts ("\n  -n [NUMBER]");
 	puts ("\tSets the maximum number of cars which can wait at a traffic light.");
-	puts ("\tBy default this value is limited to 50 cars.");
+	puts ("\tThe cars are run by a fixed pool of threads, so this number is");
+	puts ("\tonly limited by the memory.");
 	puts ("\t/!\\ This option is required to start the simulation.");
 	printf ("\t(i) Default number of cars: %d\n", DEFAULT_NB_CARS);
 
@@ -142,6 +432,137 @@ void help_menu () {
 	puts ("\tbe set in milliseconds.");
 	printf ("\t(i) Default duration: %d ms\n", DEFAULT_WAITING_TIME);
 
+	puts ("\n  -s [NUMBER]");
+	puts ("\tSets the saturation flow of a green lane, in cars per hour: the");
+	puts ("\twaiting cars are released one by one, in their order of arrival,");
+	puts ("\tand those still queued when the light goes red wait for the next");
+	puts ("\tgreen light.");
+	printf ("\t(i) Default saturation flow: %d (all the cars at once)\n", DEFAULT_SATURATION_FLOW);
+
+	puts ("\n  -c [fixed|actuated|lqf]");
+	puts ("\tSelect the controller of the traffic lights:");
+	puts ("\t - fixed: the lights switch every -t");
+	puts ("\t - actuated: after half of -t, the green is kept while cars keep");
+	puts ("\t   arriving or leaving on its lane, up to twice -t, and given up");
+	puts ("\t   as soon as its lane is idle and a car waits on the other one");
+	puts ("\t - lqf: after half of -t, the green goes to the longest queue,");
+	puts ("\t   a lane keeping it up to twice -t");
+	puts ("\t(i) Default controller: fixed");
+
+	puts ("\n  -q, --quiet");
+	puts ("\tDo not print the events of the simulation, only count them and");
+	puts ("\tprint the totals at the end.");
+
+	puts ("\n  -o [FILE]");
+	puts ("\tAppend the statistics printed at the end of the simulation to a");
+	puts ("\tfile: one JSON object per line if its name ends with \".json\",");
+	puts ("\tone CSV row otherwise (the header is written in an empty file).");
+
+	puts ("\n  --trace [FILE]");
+	puts ("\tWrite a trace of the simulation to a file, in the JSON format of");
+	puts ("\tthe Chrome and Perfetto viewers: the green phases of the lights,");
+	puts ("\tthe cars from their arrival to their passage, and the number of");
+	puts ("\tcars stopped on each lane. Works with -q.");
+
+	puts ("\n  --record [FILE]");
+	puts ("\tRecord a real time or interactive simulation in a binary file:");
+	puts ("\tits settings and seed, the arrival and lane of each car, the");
+	puts ("\tlanes chosen by the user and the switches of the lights.");
+
+	puts ("\n  --replay [FILE]");
+	puts ("\tReplay a recording on the virtual clock, as fast as the engine");
+	puts ("\tgoes: the recorded cars arrive at their date on their lane, with");
+	puts ("\tthe recorded settings and seed, and the lights switch as recorded.");
+	puts ("\tAs with -f, the options given after it override the settings: -c");
+	puts ("\tor --sweep-t hand the lights to a controller, to compare them.");
+
+	puts ("\n  --commands [FILE]");
+	puts ("\tRead the user's commands from a file or a FIFO instead of the");
+	puts ("\tterminal, in real time or interactive mode: 1, 2 or lane N, rate F,");
+	puts ("\tpause, resume and stats, one per line (see the manual). A FIFO");
+	puts ("\tstays open: scripts may write into it until the end of the run.");
+
+	puts ("\n  -r");
+	puts ("\tRun the automatic mode in real time. By default, an automatic");
+	puts ("\tsimulation is driven by a virtual clock and ends as soon as the");
+	puts ("\tlast car has passed.");
+
+	puts ("\n  -g [FILE]");
+	puts ("\tSimulate a road network described by a topology file instead of");
+	puts ("\tthe single junction (see the manual). The cars leaving a junction");
+	puts ("\tdrive to the next one; the simulation runs in automatic mode on");
+	puts ("\tthe virtual clock.");
+
+	puts ("\n  -f [FILE]");
+	puts ("\tReplay the arrivals of a scenario file instead of drawing them");
+	puts ("\t(see the manual). The settings of the file replace the options");
+	puts ("\tgiven before -f; the options given after it override the file.");
+	puts ("\tThe simulation runs in automatic mode and ends with the schedule");
+	puts ("\tif it has fewer arrivals than -n.");
+
+	puts ("\n  --sweep-t [VALUES], --sweep-a [VALUES], --sweep-n [VALUES]");
+	puts ("\tRun a parameter sweep: the simulation is run for every combination");
+	puts ("\tof the values of -t, -a and -n, given as a list \"A,B,C\" or a");
+	puts ("\trange \"START:STOP:STEP\". A parameter which is not swept keeps its");
+	puts ("\tsingle value. One CSV row is printed per combination.");
+
+	puts ("\n  --runs [NUMBER]");
+	puts ("\tNumber of replications of each combination of a parameter sweep.");
+	printf ("\t(i) Default replications: %d\n", DEFAULT_BATCH_RUNS);
+
+	puts ("\n  --jobs [NUMBER]");
+	puts ("\tNumber of processes running the simulations of a parameter sweep");
+	puts ("\tin parallel.");
+	puts ("\t(i) Default: one per online core");
+
+	puts ("\n  --seed [NUMBER]");
+	puts ("\tSeed of the random draws: the same seed gives the same arrivals,");
+	puts ("\tlanes and passage times. The seed is printed at the start of each");
+	puts ("\tsimulation; the replications of a sweep use the following seeds,");
+	puts ("\tthe same ones for each configuration.");
+	puts ("\t(i) Default: drawn from the date and the process id");
+
+	puts ("\n  --demand [uniform|poisson|piecewise|platoon]");
+	puts ("\tSelect the model of the arrivals of the cars:");
+	puts ("\t - uniform: the delay between two cars is drawn below -a");
+	puts ("\t - poisson: the cars arrive at a constant rate");
+	puts ("\t - piecewise: the rate follows a profile (--profile)");
+	puts ("\t - platoon: the cars arrive in platoons (--platoon)");
+	puts ("\tWithout rates, the mean rate is the one of -a.");
+	puts ("\t(i) Default model: uniform");
+
+	puts ("\n  --rates [R1,R2,...]");
+	puts ("\tRate of each lane in cars per hour, or of each entry of a road");
+	puts ("\tnetwork. The lane of each car is drawn in proportion.");
+
+	puts ("\n  --profile [PERIOD:F1,F2,...]");
+	puts ("\tProfile of the piecewise demand: the duration of a period in");
+	puts ("\tmicroseconds, then the factor of the rates during each period,");
+	puts ("\trepeated once the last one is over.");
+
+	puts ("\n  --platoon [SIZE[:GAP]]");
+	puts ("\tMean number of cars of a platoon, and mean gap between them in");
+	puts ("\tmicroseconds.");
+	printf ("\t(i) Default: %d cars, %d us\n", DEMAND_PLATOON_SIZE, DEMAND_PLATOON_GAP);
+
+	puts ("\n  --sync [sysv|futex]");
+	puts ("\tSelect the semaphores shared by the processes: System V (one");
+	puts ("\tsystem call per operation), or futex words in shared memory (no");
+	puts ("\tsystem call without contention).");
+	puts ("\t(i) Default backend: sysv");
+
+	puts ("\n  --roles [process|thread]");
+	puts ("\tRun the lanes, the cars and the user's command of a real time or");
+	puts ("\tinteractive simulation as forked processes, or as threads of a");
+	puts ("\tsingle process synchronized in its own memory (--sync is then");
+	puts ("\tignored).");
+	puts ("\t(i) Default: process");
+
+	puts ("\n  --reap");
+	puts ("\tDestroy the semaphores left by the instances which were killed");
+	puts ("\tbefore cleaning up, then quit. This is also done at the start of");
+	puts ("\teach real time or interactive simulation.");
+
 	puts ("\n  -h");
 	puts ("\tDisplay the program's help menu.");
 
@@ -166,11 +587,44 @@ void manual () {
 	puts ("\t - Key [ 1 ]: the main lane");
 	puts ("\t - Key [ 2 ]: the second lane");
 
+	puts ("\n  * Commands");
+	puts ("\tThe terminal, or the file or FIFO of option \"--commands\", takes");
+	puts ("\tone command per line, in interactive or real time mode ('#'");
+	puts ("\tstarts a comment):");
+	puts ("\t - 1, 2 or lane N: the lane of the new cars (interactive mode)");
+	puts ("\t - rate F: the new cars arrive at F times their rate (F <= 1000)");
+	puts ("\t - pause, resume: stop the arrivals, then start them again");
+	puts ("\t - stats: print the cars generated, passed and waiting");
+
 	puts ("\n  * Automatic Mode");
 	puts ("\tArrivals of cars on the lanes happen randomly from a maximum");
 	puts ("\ttimelapse value in milliseconds. By default this value is limited");
 	puts ("\tto 1 s. To activate the mode and change this timelapse, use option");
-	puts ("\t\"-a\" in command line.");
+	puts ("\t\"-a\" in command line. The simulation is computed on a virtual");
+	puts ("\tclock, use option \"-r\" to watch it in real time.");
+
+	puts ("\n  * Road Network");
+	puts ("\tWith option \"-g\", several junctions are linked by roads. The");
+	puts ("\ttopology file holds one declaration per line (durations in");
+	puts ("\tmicroseconds, lanes numbered 1 and 2, '#' starts a comment):");
+	puts ("\t - junction ID [GREEN [OFFSET]]: a junction, numbered from 0,");
+	puts ("\t   its green light duration (default: -t) and first switch date");
+	puts ("\t - road FROM LANE TO LANE TRAVEL: the cars leaving a lane drive");
+	puts ("\t   to a lane of another junction; other lanes leave the network");
+	puts ("\t - entry JUNCTION LANE: a lane where the new cars appear");
+	puts ("\t   (default: every lane no road leads to)");
+	puts ("\tThe roads must not loop.");
+
+	puts ("\n  * Scenario");
+	puts ("\tWith option \"-f\", the arrivals are read from a scenario file");
+	puts ("\t('#' starts a comment). It starts with its settings, one per line:");
+	puts ("\t - cars NUMBER, green NUMBER, flow NUMBER, controller NAME and");
+	puts ("\t   seed NUMBER, as options -n, -t, -s, -c and --seed");
+	puts ("\tthen holds one arrival per line, in chronological order:");
+	puts ("\t - DATE LANE: the date in microseconds from the start, and the");
+	puts ("\t   lane (1 or 2), or the entry of a road network (from 1)");
+	puts ("\tThe file is read as the simulation goes: its size does not delay");
+	puts ("\tthe start.");
 
 	puts ("\n  (i) For more details about parameters and settings, see the help");
 	puts ("      menu (option -h)");
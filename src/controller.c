@@ -0,0 +1,125 @@
+/**
+ *
+ * @file controller.c
+ * Policies deciding how long a traffic light stays green.
+ *
+ * Implementation of functions defined in @see controller.h
+ *
+ * @version 1.0
+ *
+ * ********************************************************* */
+#include <string.h>
+#include "../inc/controller.h"
+
+/**
+ * A policy: its name and its decision function.
+ */
+typedef struct {
+	char * name;
+	long (* decide) (JunctionView * view);
+} Controller;
+
+/**
+ * Give the time between two decisions of an adaptive policy, shortened
+ * to reach the maximum green on time.
+ */
+static long controller_extension (JunctionView * view) {
+	long extension = view->greenTime / CTRL_EXTENSION_DIVISOR;
+	long left = view->greenTime * CTRL_MAX_GREEN_FACTOR - view->elapsed;
+
+	if (extension < 1)
+		extension = 1;
+	return (left > 0 && left < extension) ? left : extension;
+}
+
+/**
+ * Fixed time: the light switches every greenTime.
+ */
+static long controller_fixed (JunctionView * view) {
+	return view->elapsed < view->greenTime ? view->greenTime - view->elapsed : 0;
+}
+
+/**
+ * Actuated: extend the green while the green lane is in use, give it up
+ * as soon as it is idle and a car waits on the red lane.
+ */
+static long controller_actuated (JunctionView * view) {
+	long minGreen = view->greenTime / CTRL_MIN_GREEN_DIVISOR;
+	int red = 1 - view->green;
+
+	if (view->elapsed < minGreen)
+		return minGreen - view->elapsed;
+	if (view->elapsed >= view->greenTime * CTRL_MAX_GREEN_FACTOR)
+		return view->queues[red] ? 0 : controller_extension (view);
+	if (view->queues[red] == 0)
+		return controller_extension (view);	/* Nobody to give the green to. */
+	if (view->newArrivals > 0 || view->queues[view->green] > 0)
+		return controller_extension (view);	/* The lane is still in use. */
+	return 0;	/* Gap out. */
+}
+
+/**
+ * Longest queue first: the green goes to the lane with the most waiting cars.
+ */
+static long controller_lqf (JunctionView * view) {
+	long minGreen = view->greenTime / CTRL_MIN_GREEN_DIVISOR;
+	int red = 1 - view->green;
+
+	if (view->elapsed < minGreen)
+		return minGreen - view->elapsed;
+	if (view->queues[red] == 0)
+		return controller_extension (view);
+	if (view->elapsed >= view->greenTime * CTRL_MAX_GREEN_FACTOR
+			|| view->queues[red] > view->queues[view->green])
+		return 0;
+	return controller_extension (view);
+}
+
+/**
+ * The policies, indexed by their number.
+ */
+static Controller controllers[] = {
+	{"fixed", controller_fixed},
+	{"actuated", controller_actuated},
+	{"lqf", controller_lqf}
+};
+
+/**
+ * Give the number of a policy.
+ *
+ * @param name the name of the policy
+ *
+ * @return the number of the policy, -1 if unknown
+ */
+int controller_policy (char * name) {
+	int i;
+
+	for (i = 0; i < (int) (sizeof (controllers) / sizeof (Controller)); i++)
+		if (strcmp (controllers[i].name, name) == 0)
+			return i;
+	return -1;
+}
+
+/**
+ * Give the name of a policy.
+ *
+ * @param policy the number of the policy
+ *
+ * @return the name of the policy
+ */
+char * controller_name (int policy) {
+	return controllers[policy].name;
+}
+
+/**
+ * Decide whether the green lane stays green.
+ *
+ * @param policy the number of the policy
+ * @param view the state of the junction
+ *
+ * @return the time to wait before the next decision in microseconds,
+ * 		0 to give the green light to the other lane now
+ */
+long controller_decide (int policy, JunctionView * view) {
+	return controllers[policy].decide (view);
+}
@@ -11,161 +11,195 @@
  * ********************************************************* */
 #include <stdio.h>
 #include <stdlib.h>
+#include <errno.h>
 #include "../inc/crossroads.h"
 
 /**
  * Manages the intersection.
  * 
  * Each lane of the crossroad is a processus. There are notify when the traffic
- * light change to red. At the end of the circulation, an end signal is send to
- * these processus.
- * 
- * @param timeSwitchWay the minimum waiting time before going to the green light
+ * light change to red. The process of the cars is notified through the channel
+ * when a lane goes green.
  */
-void manage_junction (int timeSwitchWay) {
-	time_t timestamp = time (NULL);
-	struct tm * timeStruct;
+void manage_junction () {
 	struct timeval start, end;
 
 	int priority = 1;	/* Ensure shifting between the two lanes. */
+	int waiting;
 
-	time (&timestamp);
-	timeStruct = localtime (&timestamp);
 	gettimeofday (&start, NULL);
 
-	P (mutex[0]);
-	shared->onRedLight = priority;
-	V (mutex[0]);
+	atomic_store (&shared->onRedLight, priority);
 
 	do {
 		gettimeofday (&end, NULL);
-		printf (
-			" T%02d:%02d:%010ld|\tCARREFOUR : le feu %d passe au rouge\n",
-			timeStruct->tm_min,
-			timeStruct->tm_sec,
+		log_event (LOG_LIGHT_RED,
 			(end.tv_sec*1000000+end.tv_usec)-(start.tv_sec*1000000+start.tv_usec),
-			priority+1
-		);
+			0, priority, 0);
 
-		priority = (priority == 1) ? 0 : 1;
+		priority = crossroads_next_lane (priority);
+		atomic_store (&metrics->green, priority);
+		atomic_store (&metrics->greenStart, metrics_now ());
+		metrics_add (&metrics->switches, 1);
 
 		gettimeofday (&end, NULL);
-		printf (
-			" T%02d:%02d:%010ld|\tCARREFOUR : le feu %d passe au vert\n",
-			timeStruct->tm_min,
-			timeStruct->tm_sec,
+		log_event (LOG_LIGHT_GREEN,
 			(end.tv_sec*1000000+end.tv_usec)-(start.tv_sec*1000000+start.tv_usec),
-			priority+1
-		);
+			0, priority, 0);
 
-		/* Going green: update the number of car waiting at the traffic lights. */
-		P (mutex[1]);
-		if (shared->nbWaitingCars != 0) {
-			/* Signal child process to release all waiting cars. */
-			kill (pids[2], RELEASE_CARS);
+		/* Going green: check the number of car waiting on this lane. The lane going
+		   red stored the light before: a car parked unseen sees the green (@see driving_car). */
+		if ((waiting = atomic_load (&shared->laneWaitingCars[priority])) != 0) {
+			/* Notify child process to release the cars waiting on this lane. */
+			if (channel_send (&notices, NOTICE_RELEASE, priority) == -1)
+				perror ("Error sending notice");
 
 			gettimeofday (&end, NULL);
-			printf (
-				" T%02d:%02d:%010ld|\tCARREFOUR : On libère %d voiture(s)\n",
-				timeStruct->tm_min,
-				timeStruct->tm_sec,
+			log_event (LOG_CARS_RELEASED,
 				(end.tv_sec*1000000+end.tv_usec)-(start.tv_sec*1000000+start.tv_usec),
-				shared->nbWaitingCars
-			);
-
-			shared->nbWaitingCars = 0;
+				0, priority, waiting);
 		}
-		V (mutex[1]);
 
-		/* Give the priority to the lane in green light. */
-		V (lane[priority]);
-		usleep (timeSwitchWay);
-		P (canAccess);
-	} while (!shared->stopSig);
+		/* Give the priority to the lane in green light, its controller decides when it ends. */
+		Vset (&sems, SEM_LANE + priority);
+		Pset (&sems, SEM_CAN_ACCESS);
+	} while (!atomic_load_explicit (&shared->stopSig, memory_order_relaxed));
 
-	/* If it's still waiting cars, signal child process to liberate them. */
-	kill (pids[2], RELEASE_CARS);
+	/* If it's still waiting cars, notify child process to liberate them. */
+	channel_send (&notices, NOTICE_RELEASE,
+		crossroads_next_lane (atomic_load_explicit (&shared->onRedLight, memory_order_relaxed)));
 
+	log_flush ();
 	puts (" FIN CARREFOUR\n");
 }
 
+/**
+ * Sleep until a date of the monotonic clock, or until the program stops.
+ * The date is absolute: the time spent deciding is not added to the phase.
+ *
+ * @param date the date of the wake up in microseconds (@see metrics_now)
+ */
+static void crossroads_sleep_until (long date) {
+	struct timespec until;
+
+	until.tv_sec = date / 1000000;
+	until.tv_nsec = date % 1000000 * 1000;
+	while (clock_nanosleep (CLOCK_MONOTONIC, TIMER_ABSTIME, &until, 0) == EINTR
+		&& !atomic_load_explicit (&shared->stopSig, memory_order_relaxed));
+}
+
 /**
  * Allow traffic on one lane.
  * Each lane of the crossroad use this function to to allow the passage of vehicles.
+ * The light stays green as long as the controller decides so, from the
+ * cars waiting and arriving on each lane.
+ * 
+ * The phases follow a timeline of planned dates: a green phase starts at
+ * the planned end of the previous one, and each decision of the controller
+ * is taken at a planned date. The time spent handing over the junction or
+ * waking up is thus not added to the phases: it is recorded as the lateness
+ * of the switch (@see stats_phase).
  * 
  * @param i the lane's number
  * @param timeSwitchWay the minimum waiting time before going to the green light
  */
 void run_circulation (int i, int timeSwitchWay) {
+	JunctionView view;
+	long phaseStart, deadline, arrivals, checkedArrivals, delay;
+	int released[2] = {SEM_LANE + i, SEM_CAN_ACCESS};
+
+	view.green = i;
+	view.greenTime = timeSwitchWay;
+
 	do {
-		P (lane[i]);
+		Pset (&sems, SEM_LANE + i);
 
-		if (shared->stopSig)
+		if (atomic_load_explicit (&shared->stopSig, memory_order_relaxed))
 			break;
 
-		/* Cars come and go ... */
-		usleep (timeSwitchWay);
+		/* Cars come and go ... from the planned end of the previous phase, if not too late. */
+		deadline = metrics_now ();
+		phaseStart = atomic_load_explicit (&shared->phaseEnd, memory_order_acquire);
+		if (phaseStart == 0 || deadline - phaseStart > timeSwitchWay)
+			phaseStart = deadline;
+		deadline = phaseStart;
+		checkedArrivals = atomic_load_explicit (&shared->laneArrivals[i], memory_order_relaxed);
+
+		/* The counters are only hints for the controller: no order needed. */
+		while (!atomic_load_explicit (&shared->stopSig, memory_order_relaxed)) {
+			view.queues[0] = atomic_load_explicit (&shared->laneWaitingCars[0], memory_order_relaxed);
+			view.queues[1] = atomic_load_explicit (&shared->laneWaitingCars[1], memory_order_relaxed);
+			arrivals = atomic_load_explicit (&shared->laneArrivals[i], memory_order_relaxed);
+			view.newArrivals = arrivals - checkedArrivals;
+			view.elapsed = deadline - phaseStart;
+			checkedArrivals = arrivals;
+
+			if ((delay = controller_decide (controllerPolicy, &view)) == 0)
+				break;
+			deadline += delay;
+			crossroads_sleep_until (deadline);
+		}
+
+		if (!atomic_load_explicit (&shared->stopSig, memory_order_relaxed))
+			stats_phase (&shared->phases[i], metrics_now () - deadline);
 
-		/* Going red: update of the "red light flag" to signal this. */
-		P (mutex[0]);
-		shared->onRedLight = i;
-		V (mutex[0]);
+		/* Going red: update of the "red light flag" to signal this (sequentially consistent,
+		   @see manage_junction), the end of the phase being published with it. */
+		atomic_store_explicit (&shared->phaseEnd, deadline, memory_order_release);
+		atomic_store (&shared->onRedLight, i);
 
-		V (canAccess);
-	} while (!shared->stopSig);
+		Vset (&sems, SEM_CAN_ACCESS);
+	} while (!atomic_load_explicit (&shared->stopSig, memory_order_relaxed));
 
 	/* The program is stopped: release semaphores. */
-	V (mutex[0]);
-	V (lane[i]);
-	V (canAccess);
+	Vmulti (&sems, released, 2);
 }
 
 /**
- * Simply update the user's lane selection.
+ * Give the lane which goes to green after the given one.
+ * Ensure shifting between the two lanes.
  * 
- * The information provided on the command line is analyzed at any time.
- * If the key entered is valid, the choice is saved and the car generator
- * is warned.
+ * @param priority the lane currently in green light
+ * 
+ * @return the lane's number which goes to green next
  */
-void user_lane_choice () {
-	unsigned char previous = '1', next = '\0';
+int crossroads_next_lane (int priority) {
+	return (priority == 1) ? 0 : 1;
+}
 
-	P (mutex[2]);
-	shared->userCmdInterMode = '1';
-	V (mutex[2]);
+/**
+ * Give the time between the release of two cars waiting on a green lane.
+ * 
+ * @param saturationFlow the number of cars released per hour (0: no limit)
+ * 
+ * @return the headway in microseconds, 0 to release all the cars at once
+ */
+long crossroads_headway (int saturationFlow) {
+	if (saturationFlow <= 0)
+		return 0;
+	return 3600000000L / saturationFlow;
+}
 
-	do {
-		next = getchar ();
-
-		if (next != '\n') {
-			/* Save the current value only if it's valid. */
-			previous = next;
-		} else {
-			/* Analyze the previous value only if the '\n' is found */
-			if (previous == LANE_ONE_KEY || previous == LANE_TWO_KEY) {
-				P (mutex[2]);
-				shared->userCmdInterMode = previous;
-				V (mutex[2]);
-
-				/* Signal brother process to use the new lane for new cars/threads. */
-				kill (pids[2], SWITCH_LANE);
-			}
-		}
-	} while (shared->stopSig || next != EOF);
+/**
+ * Raise the program's end flag, once the last car has passed.
+ */
+void crossroads_stop () {
+	atomic_store (&shared->stopSig, 1);
+	atomic_store (&metrics->running, 0);
 }
 
 /**
- * Toggle the program's end flag.
+ * Raise the program's end flag on an interruption by the user.
+ * Only async-signal-safe calls are made: the flag and the end of the
+ * metrics are lock-free atomics, read by the loops of the processes.
  * 
  * @param sigNum a signal associated to the end's flag
  */
 void crossroads_toggle_stop (int sigNum) {
+	static const char message[] = "\n\t[ INTERRUPT SIGNAL ]\n\n";
+
 	if (sigNum == STOP_PROG)
-		puts ("\n\t[ INTERRUPT SIGNAL ]\n");
-	
-	P (mutex[0]);
-	P (mutex[1]);
-	shared->stopSig = 1;
-	V (mutex[0]);
-	V (mutex[1]);
+		write (STDOUT_FILENO, message, sizeof (message) - 1);
+	atomic_store (&shared->stopSig, STOP_INTERRUPT);
+	atomic_store (&metrics->running, 0);
 }
\ No newline at end of file
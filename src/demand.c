@@ -0,0 +1,358 @@
+/**
+ *
+ * @file demand.c
+ * Models of the arrivals of the new cars.
+ *
+ * Implementation of functions defined in @see demand.h
+ *
+ * @version 1.0
+ *
+ * ********************************************************* */
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "../inc/demand.h"
+
+/**
+ * Names of the models, in the order of their numbers.
+ */
+static char * demandNames[] = {"uniform", "poisson", "piecewise", "platoon"};
+
+/**
+ * Draw a number uniformly in ]0, 1], never 0 so that its logarithm is finite.
+ */
+static inline double demand_unit (Rng * rng) {
+	return ((rng_next (rng) >> 11) + 1) * (1.0 / 9007199254740992.0);
+}
+
+/**
+ * Give the lane of a draw, in proportion to the rates of the lanes.
+ */
+static inline int demand_lane (Demand * demand, double u) {
+	int lane = 0;
+
+	while (lane < demand->model->nbLanes - 1 && u > demand->cumul[lane])
+		lane++;
+	return lane;
+}
+
+/**
+ * Read a list of positive numbers separated by commas.
+ *
+ * @return the number of values read, -1 if invalid
+ */
+static int demand_parse_list (char * text, double * values, int max) {
+	char * near;
+	int n = 0;
+
+	do {
+		if (n == max)
+			return -1;
+		values[n] = strtod (text, &near);
+		if (near == text || values[n] < 0 || !isfinite (values[n]))
+			return -1;
+		n++;
+		text = near + 1;
+	} while (*near == ',');
+	return *near == '\0' ? n : -1;
+}
+
+/**
+ * Draw a batch of the uniform model: the delays below the timelapse, the
+ * lanes being chosen by the cars.
+ */
+static void demand_fill_uniform (Demand * demand) {
+	long delays[DEMAND_BATCH];
+	int i;
+
+	for (i = 0; i < DEMAND_BATCH; i++)
+		delays[i] = demand->timelapse > 0 ? rng_below (demand->rng, demand->timelapse) : 0;
+	for (i = 0; i < DEMAND_BATCH; i++) {
+		demand->clock += delays[i];
+		demand->dates[i] = (long) demand->clock;
+		demand->lanes[i] = -1;
+	}
+}
+
+/**
+ * Draw the lanes of a batch in proportion to the rates, or leave them to the cars.
+ */
+static void demand_fill_lanes (Demand * demand) {
+	double draws[DEMAND_BATCH];
+	int i;
+
+	if (demand->model->nbLanes == 0) {
+		for (i = 0; i < DEMAND_BATCH; i++)
+			demand->lanes[i] = -1;
+		return;
+	}
+	for (i = 0; i < DEMAND_BATCH; i++)
+		draws[i] = demand_unit (demand->rng);
+	for (i = 0; i < DEMAND_BATCH; i++)
+		demand->lanes[i] = demand_lane (demand, draws[i]);
+}
+
+/**
+ * Draw a batch of the poisson model: exponential delays at the mean rate.
+ */
+static void demand_fill_poisson (Demand * demand) {
+	double delays[DEMAND_BATCH];
+	int i;
+
+	for (i = 0; i < DEMAND_BATCH; i++)
+		delays[i] = demand_unit (demand->rng);
+	for (i = 0; i < DEMAND_BATCH; i++)
+		delays[i] = -log (delays[i]) * demand->mean;
+	for (i = 0; i < DEMAND_BATCH; i++) {
+		demand->clock += delays[i];
+		demand->dates[i] = (long) demand->clock;
+	}
+	demand_fill_lanes (demand);
+}
+
+/**
+ * Draw a batch of the piecewise model. Each delay is an exponential amount
+ * of expected cars, spent along the profile: a period of factor f holds
+ * f times the cars of a period at the mean rate, and a period of factor 0
+ * holds none.
+ */
+static void demand_fill_piecewise (Demand * demand) {
+	DemandModel * model = demand->model;
+	double amounts[DEMAND_BATCH], end, room, factor;
+	long period;
+	int i;
+
+	for (i = 0; i < DEMAND_BATCH; i++)
+		amounts[i] = demand_unit (demand->rng);
+	for (i = 0; i < DEMAND_BATCH; i++)
+		amounts[i] = -log (amounts[i]) * demand->mean;
+	for (i = 0; i < DEMAND_BATCH; i++) {
+		while (1) {
+			period = (long) (demand->clock / model->period);
+			factor = model->factors[period % model->nbPeriods];
+			end = (double) (period + 1) * model->period;
+			room = (end - demand->clock) * factor;
+			if (amounts[i] < room) {
+				demand->clock += amounts[i] / factor;
+				break;
+			}
+			amounts[i] -= room;
+			demand->clock = end;
+		}
+		demand->dates[i] = (long) demand->clock;
+	}
+	demand_fill_lanes (demand);
+}
+
+/**
+ * Draw a batch of the platoon model. A leader comes an exponential delay
+ * after the end of the previous platoon, on a lane drawn in proportion to
+ * the rates, followed by a geometric number of cars on the same lane; the
+ * delay of the leaders keeps the mean rate of the demand whenever the
+ * platoons fit in it.
+ */
+static void demand_fill_platoon (Demand * demand) {
+	DemandModel * model = demand->model;
+	double delays[DEMAND_BATCH], lanes[DEMAND_BATCH], sizes[DEMAND_BATCH];
+	double gap = model->platoonGap, leader;
+	double stay = model->platoonSize > 1 ? log (1 - 1 / model->platoonSize) : 0;
+	int i;
+
+	leader = model->platoonSize * demand->mean - (model->platoonSize - 1) * gap;
+	if (leader < gap)
+		leader = gap;
+	for (i = 0; i < DEMAND_BATCH; i++) {
+		delays[i] = demand_unit (demand->rng);
+		lanes[i] = demand_unit (demand->rng);
+		sizes[i] = demand_unit (demand->rng);
+	}
+	for (i = 0; i < DEMAND_BATCH; i++)
+		sizes[i] = stay ? floor (log (sizes[i]) / stay) : 0;
+	for (i = 0; i < DEMAND_BATCH; i++) {
+		if (demand->platoonLeft > 0) {
+			/* A follower: around the gap after the previous car. */
+			demand->clock += gap * (0.5 + lanes[i]);
+			demand->platoonLeft--;
+		} else {
+			demand->clock += -log (delays[i]) * leader;
+			demand->platoonLane = model->nbLanes ? demand_lane (demand, lanes[i]) : -1;
+			demand->platoonLeft = (long) sizes[i];
+		}
+		demand->dates[i] = (long) demand->clock;
+		demand->lanes[i] = demand->platoonLane;
+	}
+}
+
+/**
+ * Set the default demand: uniform, without rates.
+ *
+ * @param model the settings to reset
+ */
+void demand_default (DemandModel * model) {
+	memset (model, 0, sizeof (DemandModel));
+	model->model = DEMAND_UNIFORM;
+	model->platoonSize = DEMAND_PLATOON_SIZE;
+	model->platoonGap = DEMAND_PLATOON_GAP;
+}
+
+/**
+ * Give the number of a model.
+ *
+ * @param name the name of the model
+ *
+ * @return the number of the model, -1 if unknown
+ */
+int demand_model (char * name) {
+	int i;
+
+	for (i = 0; i < (int) (sizeof (demandNames) / sizeof (char *)); i++)
+		if (strcmp (demandNames[i], name) == 0)
+			return i;
+	return -1;
+}
+
+/**
+ * Give the name of a model.
+ *
+ * @param model the number of the model
+ *
+ * @return the name of the model
+ */
+char * demand_name (int model) {
+	return demandNames[model];
+}
+
+/**
+ * Read the rates of the lanes, "R1,R2,..." in cars per hour.
+ *
+ * @param model the settings receiving the rates
+ * @param text the list of rates
+ *
+ * @return 0 if success, -1 if invalid
+ */
+int demand_parse_rates (DemandModel * model, char * text) {
+	double total = 0;
+	int i, n;
+
+	if ((n = demand_parse_list (text, model->rates, DEMAND_MAX_LANES)) == -1)
+		return -1;
+	for (i = 0; i < n; i++)
+		total += model->rates[i];
+	if (total <= 0)
+		return -1;
+	model->nbLanes = n;
+	return 0;
+}
+
+/**
+ * Read a profile, "PERIOD:F1,F2,...": the duration of a period in
+ * microseconds, then the factor of the rates during each period.
+ *
+ * @param model the settings receiving the profile
+ * @param text the profile
+ *
+ * @return 0 if success, -1 if invalid
+ */
+int demand_parse_profile (DemandModel * model, char * text) {
+	double total = 0;
+	char * near;
+	int i, n;
+
+	model->period = strtol (text, &near, 10);
+	if (near == text || *near != ':' || model->period <= 0)
+		return -1;
+	if ((n = demand_parse_list (near + 1, model->factors, DEMAND_MAX_PERIODS)) == -1)
+		return -1;
+	for (i = 0; i < n; i++)
+		total += model->factors[i];
+	if (total <= 0)
+		return -1;
+	model->nbPeriods = n;
+	return 0;
+}
+
+/**
+ * Read the platoons, "SIZE[:GAP]": the mean number of cars of a platoon
+ * and the mean gap between them in microseconds.
+ *
+ * @param model the settings receiving the platoons
+ * @param text the platoons
+ *
+ * @return 0 if success, -1 if invalid
+ */
+int demand_parse_platoon (DemandModel * model, char * text) {
+	char * near;
+
+	model->platoonSize = strtod (text, &near);
+	if (near == text || model->platoonSize < 1 || !isfinite (model->platoonSize))
+		return -1;
+	if (*near == ':') {
+		text = near + 1;
+		model->platoonGap = strtol (text, &near, 10);
+		if (near == text || model->platoonGap < 0)
+			return -1;
+	}
+	return *near == '\0' ? 0 : -1;
+}
+
+/**
+ * Start the arrivals of a simulation, from the date 0.
+ *
+ * Without rates, the mean delay is the one of the uniform model, half
+ * of the timelapse.
+ *
+ * @param demand the arrivals to start
+ * @param model the settings of the demand
+ * @param rng the stream of the arrivals, already seeded
+ * @param timelapse the maximum delay of the uniform model in microseconds
+ */
+void demand_init (Demand * demand, DemandModel * model, Rng * rng, long timelapse) {
+	double total = 0, sum = 0;
+	int i;
+
+	demand->model = model;
+	demand->rng = rng;
+	demand->timelapse = timelapse;
+	demand->clock = 0;
+	demand->platoonLeft = 0;
+	demand->platoonLane = -1;
+	demand->count = demand->next = 0;
+
+	for (i = 0; i < model->nbLanes; i++)
+		total += model->rates[i];
+	for (i = 0; i < model->nbLanes; i++) {
+		sum += model->rates[i];
+		demand->cumul[i] = sum / total;
+	}
+	/* Cars per hour to microseconds between two cars. */
+	demand->mean = model->nbLanes ? 3600000000.0 / total : timelapse / 2.0;
+}
+
+/**
+ * Give the next arrival, drawing a new batch when needed.
+ *
+ * @param demand the arrivals
+ * @param date the date of the arrival in microseconds
+ * @param lane the lane of the arrival, -1 if the car chooses it
+ */
+void demand_next (Demand * demand, long * date, int * lane) {
+	if (demand->next == demand->count) {
+		switch (demand->model->model) {
+			case DEMAND_POISSON:
+				demand_fill_poisson (demand);
+				break;
+			case DEMAND_PIECEWISE:
+				demand_fill_piecewise (demand);
+				break;
+			case DEMAND_PLATOON:
+				demand_fill_platoon (demand);
+				break;
+			default:
+				demand_fill_uniform (demand);
+		}
+		demand->count = DEMAND_BATCH;
+		demand->next = 0;
+	}
+	*date = demand->dates[demand->next];
+	*lane = demand->lanes[demand->next++];
+}
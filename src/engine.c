@@ -0,0 +1,347 @@
+/**
+ *
+ * @file engine.c
+ * Discrete-event simulation of the crossroad driven by a virtual clock.
+ *
+ * This file replays the circulation of the junctions as a sequence of
+ * timestamped events, without sleeping. Every event carries the approach
+ * concerned (@see network.h), so one queue of events drives any number of
+ * junctions.
+ *
+ * @see engine.h
+ * @version 1.0
+ *
+ * ********************************************************* */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../inc/engine.h"
+
+/**
+ * Set if the network has several junctions: the log then names them.
+ */
+static int namedJunctions;
+
+/**
+ * Give the junction named in the log.
+ *
+ * @param junction the number of the junction
+ *
+ * @return the junction, or -1 for the only junction of the network
+ */
+static int engine_log_junction (int junction) {
+	return namedJunctions ? junction : -1;
+}
+
+/**
+ * Give the date and the entry of the next new car: drawn by the demand, or
+ * read from the schedule of the scenario.
+ *
+ * @param scenario the scenario (0: the arrivals are drawn)
+ * @param network the junctions and the roads
+ * @param demand the arrivals drawn ahead
+ * @param date the date of the arrival
+ * @param entry the number of the entry, -1 to draw it
+ *
+ * @return 1 if a car comes, 0 if the schedule is over, -1 if the scenario is invalid
+ */
+static int engine_next_car (Scenario * scenario, Network * network, Demand * demand,
+		long * date, int * entry) {
+	int read;
+
+	if (!scenario) {
+		demand_next (demand, date, entry);
+		return 1;
+	}
+	if ((read = scenario_next (scenario, date, entry)) == 1 && *entry >= network->nbEntries) {
+		fprintf (stderr, "%s: the network has no entry %d\n", scenario->path, *entry + 1);
+		return -1;
+	}
+	return read;
+}
+
+/**
+ * Ask the controller whether the green lane of a junction stays green,
+ * and schedule its decision: the switch of the lights, or the next check.
+ *
+ * @param queue the queue of events
+ * @param network the junctions and the roads
+ * @param j the number of the junction
+ *
+ * @return 0 if success, -1 otherwise
+ */
+static int engine_check_light (EventQueue * queue, Network * network, int j) {
+	Junction * junction = &network->junctions[j];
+	JunctionView view;
+	long delay;
+
+	view.green = crossroads_next_lane (junction->redLight);
+	view.elapsed = virtualClock - junction->greenStart;
+	view.queues[0] = junction->waiting[0].size;
+	view.queues[1] = junction->waiting[1].size;
+	view.newArrivals = junction->arrivals[view.green] - junction->checkedArrivals;
+	view.greenTime = junction->greenTime;
+	junction->checkedArrivals = junction->arrivals[view.green];
+
+	delay = controller_decide (controllerPolicy, &view);
+	if (delay == 0 && view.elapsed < ENGINE_MIN_GREEN)	/* The clock moves between two switches. */
+		delay = ENGINE_MIN_GREEN - view.elapsed;
+	if (delay == 0)
+		return evq_push (queue, virtualClock, EV_LIGHT_SWITCH, 0,
+			NETWORK_APPROACH (j, junction->redLight));
+	return evq_push (queue, virtualClock + delay, EV_LIGHT_CHECK, 0, NETWORK_APPROACH (j, view.green));
+}
+
+/**
+ * Schedule the next switch of the lights of a recording: the lane going
+ * green at its recorded date, or at once if the date is past.
+ *
+ * @param queue the queue of events
+ * @param scenario the recording
+ * @param j the number of the junction
+ * @param error set if the switch could not be scheduled
+ *
+ * @return 1 if a switch is scheduled, 0 at the end of the recording, -1 if invalid
+ */
+static int engine_recorded_light (EventQueue * queue, Scenario * scenario, int j, int * error) {
+	long date;
+	int lane, read;
+
+	if ((read = scenario_green (scenario, &date, &lane)) == 1)
+		*error |= evq_push (queue, date > virtualClock ? date : virtualClock, EV_LIGHT_SWITCH, 0,
+			NETWORK_APPROACH (j, lane));
+	return read;
+}
+
+/**
+ * Run the whole simulation on the virtual clock.
+ *
+ * The cars arrive, wait and pass exactly as with the processes and the
+ * threads, but the delays are not slept: the engine handles the events
+ * in chronological order until the last car has left the network. A car
+ * passing a junction drives to the next one along the road of its lane.
+ * The new cars arrive as drawn by the demand (@see demand.h), or as
+ * scheduled by a scenario, until its schedule ends. The draws follow the
+ * seed: the same seed gives the same run. A recording also switches the
+ * lights as recorded, unless it is replayed with a controller: each car
+ * drawing its lane even if it is given, the cars of the recording pass
+ * as they were drawn in real time.
+ *
+ * @param network the junctions and the roads
+ * @param nbCars the number of cars to be generated
+ * @param timelapseNewCars the maximum waiting time before a new car appear
+ * @param saturationFlow the number of cars released per hour of green light
+ * @param scenario the schedule of the arrivals, read from its current
+ * 		arrival (0: the arrivals are drawn)
+ * @param seed the seed of the random streams
+ * @param result the summary of the run, filled if not null
+ *
+ * @return 0 if success, a specific number if an error occured
+ */
+int run_engine (Network * network, int nbCars, int timelapseNewCars, int saturationFlow,
+		Scenario * scenario, unsigned long seed, EngineResult * result) {
+	EngineResult summary = {0, 0, 0, 0, 0, 0};
+	EventQueue queue;
+	Event event;
+	Junction * junction;
+	LaneQueue * waiting;
+	long headway = crossroads_headway (saturationFlow);
+	long wait, date;
+	Car car;
+	Rng arrivalStream;
+	Demand demand;
+	int j, lane, entering, entry, next, drawn, error = 0, invalid = 0;
+	int replayed = scenario && scenario->phases;	/* The lights switch as recorded. */
+
+	virtualClock = 0;
+	namedJunctions = network->nbJunctions > 1;
+
+	/* Each rate of the demand is the one of an entry. */
+	if (!scenario && simuDemand.nbLanes > network->nbEntries) {
+		fprintf (stderr, "The network has no entry %d for the rates of the demand\n",
+			network->nbEntries + 1);
+		return 11;
+	}
+
+	if (evq_init (&queue, DEFAULT_EVENT_CAPACITY) == -1) {
+		perror ("Error creating event queue");
+		return 6;
+	}
+	/* The same streams as in real time: the arrivals, and one carried by each car. */
+	rng_seed (&arrivalStream, seed, RNG_ARRIVAL_STREAM);
+	demand_init (&demand, &simuDemand, &arrivalStream, timelapseNewCars);
+
+	/* The first lane of each junction goes to green, the first car is on its way. */
+	for (j = 0; j < network->nbJunctions; j++) {
+		junction = &network->junctions[j];
+		if (replayed && (next = engine_recorded_light (&queue, scenario, j, &error)) != 0)
+			invalid |= next == -1;
+		else
+			error |= evq_push (&queue, junction->offset, EV_LIGHT_SWITCH, 0,
+				NETWORK_APPROACH (j, crossroads_next_lane (junction->redLight)));
+	}
+	if (nbCars > 0) {
+		next = engine_next_car (scenario, network, &demand, &date, &entry);
+		if (next == 1) {
+			error |= evq_push (&queue, date, EV_CAR_ARRIVAL, 0, -1);
+		} else {	/* Empty schedule. */
+			invalid = next == -1;
+			nbCars = 0;
+		}
+	}
+
+	while (!error && !invalid && summary.nbCars < nbCars && evq_pop (&queue, &event)) {
+		virtualClock = event.time;
+
+		switch (event.type) {
+			case EV_CAR_ARRIVAL:
+				/* A new car enters the network, the others come from the previous junction. */
+				entering = event.lane == -1;
+				if (entering) {	/* Its entry is drawn even if given, as in real time. */
+					rng_seed (&event.car.rng, seed, RNG_CAR_STREAM (event.car.id));
+					drawn = rng_below (&event.car.rng, network->nbEntries);
+					event.lane = network->entries[entry != -1 ? entry : drawn];
+				}
+				j = NETWORK_JUNCTION (event.lane);
+				lane = NETWORK_LANE (event.lane);
+				junction = &network->junctions[j];
+				waiting = &junction->waiting[lane];
+				log_junction_event (LOG_CAR_ARRIVAL, virtualClock, engine_log_junction (j),
+					event.car.id, lane, 0);
+				event.car.arrival = virtualClock;	/* Carried to its passage. */
+				junction->arrivals[lane]++;
+
+				/* Red light, or cars still queued: the car waits its turn. */
+				if (junction->redLight == lane || waiting->size != 0) {
+					log_junction_event (LOG_CAR_WAITING, virtualClock, engine_log_junction (j),
+						event.car.id, lane, 0);
+					error |= lq_push (waiting, &event.car);	/* Stopped at its arrival date. */
+					summary.nbStops++;
+					if (waiting->size > summary.maxQueue)
+						summary.maxQueue = waiting->size;
+					junction->nbWaitingCars++;
+					stats_queue (&simuStats, junction->nbWaitingCars);
+					log_junction_event (LOG_CARS_WAITING, virtualClock, engine_log_junction (j),
+						event.car.id, lane, junction->nbWaitingCars);
+					if (junction->redLight != lane && !waiting->discharging) {
+						waiting->discharging = 1;
+						error |= evq_push (&queue, virtualClock, EV_LANE_DISCHARGE, 0, event.lane);
+					}
+				} else {
+					error |= evq_push (&queue, virtualClock + car_pass_delay (&event.car.rng),
+						EV_CAR_PASSED, &event.car, event.lane);
+				}
+
+				/* Next car, if any. */
+				if (!entering)
+					break;
+				/* Only one new car is on its way at a time: its entry waits here. */
+				memset (&car, 0, sizeof (Car));	/* Its stream is seeded on arrival. */
+				car.id = event.car.id + 1;
+				if (car.id < nbCars && (next = engine_next_car (scenario, network,
+						&demand, &date, &entry)) == 1) {
+					error |= evq_push (&queue, date, EV_CAR_ARRIVAL, &car, -1);
+				} else {
+					if (car.id < nbCars) {	/* The schedule ends before the last car. */
+						invalid = next == -1;
+						nbCars = car.id;
+					}
+					log_event (LOG_NO_MORE_CARS, virtualClock, event.car.id, 0, 0);
+				}
+				break;
+
+			case EV_CAR_PASSED:
+				j = NETWORK_JUNCTION (event.lane);
+				lane = NETWORK_LANE (event.lane);
+				junction = &network->junctions[j];
+				log_junction_event (LOG_CAR_PASSED, virtualClock, engine_log_junction (j),
+					event.car.id, lane, 0);
+				stats_passage (&simuStats, lane, event.car.arrival, virtualClock);
+
+				/* Drive to the next junction, or leave the network. */
+				if (junction->next[lane] != -1)
+					error |= evq_push (&queue, virtualClock + junction->travelTime[lane],
+						EV_CAR_ARRIVAL, &event.car, junction->next[lane]);
+				else
+					summary.nbCars++;
+				break;
+
+			case EV_LIGHT_SWITCH:
+				j = NETWORK_JUNCTION (event.lane);
+				lane = NETWORK_LANE (event.lane);
+				junction = &network->junctions[j];
+				waiting = &junction->waiting[lane];
+				junction->redLight = crossroads_next_lane (lane);
+				log_junction_event (LOG_LIGHT_RED, virtualClock, engine_log_junction (j),
+					0, junction->redLight, 0);
+				log_junction_event (LOG_LIGHT_GREEN, virtualClock, engine_log_junction (j),
+					0, lane, 0);
+
+				/* Going green: release the cars waiting on this lane. */
+				if (waiting->size != 0) {
+					log_junction_event (LOG_CARS_RELEASED, virtualClock, engine_log_junction (j),
+						0, lane, waiting->size);
+					if (!waiting->discharging) {
+						waiting->discharging = 1;
+						error |= evq_push (&queue, virtualClock, EV_LANE_DISCHARGE, 0, event.lane);
+					}
+				}
+
+				/* The controller decides how long the light stays green, once the
+				   recorded switches are over. */
+				junction->greenStart = virtualClock;
+				junction->checkedArrivals = junction->arrivals[lane];
+				if (replayed && (next = engine_recorded_light (&queue, scenario, j, &error)) != 0)
+					invalid |= next == -1;
+				else
+					error |= engine_check_light (&queue, network, j);
+				break;
+
+			case EV_LIGHT_CHECK:
+				error |= engine_check_light (&queue, network, NETWORK_JUNCTION (event.lane));
+				break;
+
+			case EV_LANE_DISCHARGE:
+				j = NETWORK_JUNCTION (event.lane);
+				lane = NETWORK_LANE (event.lane);
+				junction = &network->junctions[j];
+				waiting = &junction->waiting[lane];
+
+				/* Release the first cars in their order of arrival, one per headway. */
+				while (junction->redLight != lane && lq_pop (waiting, &car)) {
+					junction->nbWaitingCars--;
+					wait = virtualClock - car.arrival;
+					summary.totalWait += wait;
+					if (wait > summary.maxWait)
+						summary.maxWait = wait;
+					error |= evq_push (&queue, virtualClock + car_pass_delay (&car.rng),
+						EV_CAR_PASSED, &car, event.lane);
+					if (headway)
+						break;
+				}
+				if (headway && waiting->size != 0 && junction->redLight != lane)
+					error |= evq_push (&queue, virtualClock + headway,
+						EV_LANE_DISCHARGE, 0, event.lane);
+				else
+					waiting->discharging = 0;
+				break;
+		}
+	}
+
+	evq_free (&queue);
+
+	summary.endTime = virtualClock;
+	if (result)
+		*result = summary;
+
+	if (error) {
+		perror ("Error scheduling event");
+		return 6;
+	}
+	if (invalid)
+		return 11;	/* Reported by the reader of the scenario. */
+
+	log_flush ();
+	puts (" FIN CARREFOUR\n");
+	return 0;
+}
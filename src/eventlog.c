@@ -0,0 +1,465 @@
+/**
+ *
+ * @file eventlog.c
+ * Asynchronous log of the simulation's events.
+ *
+ * Implementation of functions defined in @see eventlog.h
+ *
+ * The ring buffer is a bounded multi-producer queue: each slot carries a
+ * sequence number, a producer claims a slot by moving the enqueue position
+ * with a compare-and-swap, fills it, then publishes it by updating its
+ * sequence number. The writer thread is the only consumer. When a trace
+ * or a recording is written, the ring is kept in quiet mode as well: the
+ * writer only formats them.
+ *
+ * @version 1.0
+ *
+ * ********************************************************* */
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <unistd.h>
+#include <time.h>
+#include <sched.h>
+#include "../inc/trace.h"
+#include "../inc/record.h"
+
+/**
+ * The ring buffer of records.
+ */
+static LogSlot * ring;
+
+/**
+ * Position of the next slot to be claimed by a producer.
+ */
+static atomic_long enqueuePos;
+
+/**
+ * Position of the next slot to be read by the writer.
+ */
+static long dequeuePos;
+
+/**
+ * Position of the last slot read by the writer, published for log_flush.
+ */
+static atomic_long flushedPos;
+
+/**
+ * Number of events logged of each kind.
+ */
+static atomic_long counters[LOG_NB_TYPES];
+
+/**
+ * Number of records dropped because the ring was full.
+ */
+static atomic_long dropped;
+
+/**
+ * Number of entries of the recording dropped with their records.
+ */
+static atomic_long lost;
+
+/**
+ * Set to ask the writer thread to flush and leave.
+ */
+static atomic_int stopWriter;
+
+/**
+ * Set if the records are only counted.
+ */
+static int quietMode;
+
+/**
+ * Set if the records are written in the trace.
+ */
+static int traced;
+
+/**
+ * Set if the records are written in the recording.
+ */
+static int recorded;
+
+/**
+ * Monotonic date from which the records are stamped, in microseconds
+ * (0: stamped with their date).
+ */
+static long stampOrigin;
+
+/**
+ * Set if a producer waits for a free slot instead of dropping its record.
+ */
+static int losslessMode;
+
+/**
+ * The writer thread.
+ */
+static pthread_t writer;
+
+/**
+ * Wall clock minutes and seconds at the start of the log, used as the
+ * prefix of each line.
+ */
+static struct tm timeStruct;
+
+/**
+ * Read the monotonic clock in microseconds.
+ */
+static long log_now () {
+	struct timespec now;
+	clock_gettime (CLOCK_MONOTONIC, &now);
+	return now.tv_sec*1000000 + now.tv_nsec/1000;
+}
+
+/**
+ * Format the end of the log line of an event of a road network, which
+ * names the junction concerned.
+ *
+ * @param record the record to format
+ * @param line the buffer receiving the end of the line
+ * @param size the size of the buffer
+ * @param n the number of characters already written before the buffer
+ *
+ * @return the number of characters of the whole line
+ */
+static int log_format_junction (LogRecord * record, char * line, int size, int n) {
+	int m;
+
+	switch (record->type) {
+		case LOG_CAR_ARRIVAL:
+			m = snprintf (line, size,
+				"\t\tVOITURE : arrivée de la voiture %ld au carrefour %d sur la voie %d\n",
+				record->car+1, record->junction, record->lane+1);
+			break;
+		case LOG_CAR_WAITING:
+			m = snprintf (line, size,
+				"\t\tVOITURE : la voiture %ld est en attente au carrefour %d\n",
+				record->car+1, record->junction);
+			break;
+		case LOG_CARS_WAITING:
+			m = snprintf (line, size,
+				"\t\tVOITURE : il y a %ld voiture(s) en attente au carrefour %d\n",
+				record->value, record->junction);
+			break;
+		case LOG_CAR_PASSED:
+			m = snprintf (line, size,
+				"\t\tVOITURE : la voiture %ld est passée au carrefour %d\n",
+				record->car+1, record->junction);
+			break;
+		case LOG_LIGHT_RED:
+			m = snprintf (line, size,
+				"\tCARREFOUR %d : le feu %d passe au rouge\n", record->junction, record->lane+1);
+			break;
+		case LOG_LIGHT_GREEN:
+			m = snprintf (line, size,
+				"\tCARREFOUR %d : le feu %d passe au vert\n", record->junction, record->lane+1);
+			break;
+		case LOG_CARS_RELEASED:
+			m = snprintf (line, size,
+				"\tCARREFOUR %d : On libère %ld voiture(s)\n", record->junction, record->value);
+			break;
+		default:
+			m = snprintf (line, size, "\n");
+	}
+	return n + (m < size ? m : size - 1);
+}
+
+/**
+ * Format a record as a log line.
+ *
+ * @param record the record to format
+ * @param line the buffer receiving the line
+ * @param size the size of the buffer
+ *
+ * @return the number of characters written
+ */
+static int log_format (LogRecord * record, char * line, int size) {
+	int n;
+
+	if (record->type == LOG_LANE_COMMAND)
+		return snprintf (line, size, "\n\t[ COMMAND: CHOOSE LANE %d ]\n\n", record->lane+1);
+
+	n = snprintf (line, size, " T%02d:%02d:%010ld|",
+		timeStruct.tm_min, timeStruct.tm_sec, record->time);
+
+	if (record->junction >= 0)
+		return log_format_junction (record, line + n, size - n, n);
+
+	switch (record->type) {
+		case LOG_CAR_ARRIVAL:
+			n += snprintf (line + n, size - n,
+				"\t\tVOITURE : arrivée de la voiture %ld sur la voie %d\n",
+				record->car+1, record->lane+1);
+			break;
+		case LOG_CAR_WAITING:
+			n += snprintf (line + n, size - n,
+				"\t\tVOITURE : la voiture %ld est en attente\n", record->car+1);
+			break;
+		case LOG_CARS_WAITING:
+			n += snprintf (line + n, size - n,
+				"\t\tVOITURE : il y a %ld voiture(s) en attente\n", record->value);
+			break;
+		case LOG_CAR_PASSED:
+			n += snprintf (line + n, size - n,
+				"\t\tVOITURE : la voiture %ld est passée\n", record->car+1);
+			break;
+		case LOG_NO_MORE_CARS:
+			n += snprintf (line + n, size - n,
+				"\t\tVOITURE : aucune nouvelle voiture en vue ...\n");
+			break;
+		case LOG_LIGHT_RED:
+			n += snprintf (line + n, size - n,
+				"\tCARREFOUR : le feu %d passe au rouge\n", record->lane+1);
+			break;
+		case LOG_LIGHT_GREEN:
+			n += snprintf (line + n, size - n,
+				"\tCARREFOUR : le feu %d passe au vert\n", record->lane+1);
+			break;
+		case LOG_CARS_RELEASED:
+			n += snprintf (line + n, size - n,
+				"\tCARREFOUR : On libère %ld voiture(s)\n", record->value);
+			break;
+		default:
+			n += snprintf (line + n, size - n, "\n");
+	}
+	return n < size ? n : size - 1;
+}
+
+/**
+ * Take the next published record of the ring, if any.
+ *
+ * @param record the removed record
+ *
+ * @return 1 if a record is returned, 0 if the ring is empty
+ */
+static int log_take (LogRecord * record) {
+	LogSlot * slot = &ring[dequeuePos & (LOG_RING_SIZE - 1)];
+
+	if (atomic_load_explicit (&slot->seq, memory_order_acquire) != dequeuePos + 1)
+		return 0;
+	*record = slot->record;
+	/* Hand the slot back to the producers for the next lap. */
+	atomic_store_explicit (&slot->seq, dequeuePos + LOG_RING_SIZE, memory_order_release);
+	dequeuePos++;
+	return 1;
+}
+
+/**
+ * Main loop of the writer: format the pending records and flush them
+ * in batches, sleep when there is nothing to write.
+ *
+ * @param arg unused
+ */
+static void * log_writer (void * arg) {
+	static char batch[LOG_BATCH_SIZE * 128];
+	static char events[LOG_BATCH_SIZE * TRACE_RECORD_SIZE];
+	static RecordEntry entries[LOG_BATCH_SIZE];
+	LogRecord record;
+	int length, traceLength, nbEntries, nbRecords;
+
+	while (1) {
+		length = traceLength = nbEntries = 0;
+		for (nbRecords = 0; nbRecords < LOG_BATCH_SIZE && log_take (&record); nbRecords++) {
+			if (!quietMode)
+				length += log_format (&record, batch + length, sizeof (batch) - length);
+			if (traced)
+				traceLength += trace_format (&record, events + traceLength,
+					sizeof (events) - traceLength);
+			if (recorded)
+				nbEntries += record_entry (&record, &entries[nbEntries]);
+		}
+
+		if (nbRecords) {
+			if (length) {
+				fwrite (batch, 1, length, stdout);
+				fflush (stdout);
+			}
+			if (traceLength)
+				trace_write (events, traceLength);
+			if (nbEntries)
+				record_write (entries, nbEntries);
+			atomic_store (&flushedPos, dequeuePos);
+		} else if (atomic_load (&stopWriter)) {
+			break;
+		} else {
+			usleep (LOG_IDLE_TIME);
+		}
+	}
+	return 0;
+}
+
+/**
+ * Stamp the records with the monotonic clock from now on: in real time,
+ * each role dates its events from its own start, the stamps share this
+ * origin. Called before the roles start; otherwise, the stamp of a
+ * record is its date (virtual clock).
+ */
+void log_origin () {
+	stampOrigin = log_now ();
+}
+
+/**
+ * Start the log of the calling process, and its writer thread.
+ * Must be called again in a forked process, and after the trace and the
+ * recording are open. The entries of the recording dropped with their
+ * records are counted in it when the log is closed.
+ *
+ * @param quiet if set, the records are only counted, never printed
+ * @param lossless if set, a producer finding the ring full yields until the
+ * 		writer frees a slot (for the virtual clock, where nothing is late)
+ *
+ * @return 0 if success, -1 otherwise
+ */
+int log_init (int quiet, int lossless) {
+	time_t timestamp = time (NULL);
+	sigset_t all, previous;
+	long i;
+
+	localtime_r (&timestamp, &timeStruct);
+	for (i = 0; i < LOG_NB_TYPES; i++)
+		atomic_init (&counters[i], 0);
+	atomic_init (&dropped, 0);
+	atomic_init (&lost, 0);
+	atomic_init (&stopWriter, 0);
+	quietMode = quiet;
+	traced = trace_active ();
+	recorded = record_active ();
+	losslessMode = lossless;
+	ring = 0;
+
+	if (quietMode && !traced && !recorded)
+		return 0;
+
+	ring = malloc (LOG_RING_SIZE * sizeof (LogSlot));
+	if (!ring)
+		return -1;
+	for (i = 0; i < LOG_RING_SIZE; i++)
+		atomic_init (&ring[i].seq, i);
+	atomic_init (&enqueuePos, 0);
+	atomic_init (&flushedPos, 0);
+	dequeuePos = 0;
+
+	/* The writer never runs the signal handlers. */
+	sigfillset (&all);
+	pthread_sigmask (SIG_SETMASK, &all, &previous);
+	i = pthread_create (&writer, 0, log_writer, 0);
+	pthread_sigmask (SIG_SETMASK, &previous, 0);
+
+	if (i != 0) {
+		free (ring);
+		ring = 0;
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * Log an event (lock-free, never blocks).
+ *
+ * @param type the kind of event
+ * @param time the date of the event in microseconds since the start
+ * @param car the number of the car concerned by the event
+ * @param lane the lane concerned by the event
+ * @param value a number attached to the event
+ */
+void log_event (LogType type, long time, long car, int lane, long value) {
+	log_junction_event (type, time, -1, car, lane, value);
+}
+
+/**
+ * Log an event of a junction of a road network (lock-free, never blocks).
+ *
+ * @param type the kind of event
+ * @param time the date of the event in microseconds since the start
+ * @param junction the junction concerned by the event (-1: the only one)
+ * @param car the number of the car concerned by the event
+ * @param lane the lane concerned by the event
+ * @param value a number attached to the event
+ */
+void log_junction_event (LogType type, long time, int junction, long car, int lane, long value) {
+	LogSlot * slot;
+	long pos, seq;
+
+	atomic_fetch_add_explicit (&counters[type], 1, memory_order_relaxed);
+	if (!ring)
+		return;
+
+	pos = atomic_load_explicit (&enqueuePos, memory_order_relaxed);
+	while (1) {
+		slot = &ring[pos & (LOG_RING_SIZE - 1)];
+		seq = atomic_load_explicit (&slot->seq, memory_order_acquire);
+		if (seq == pos) {	/* Free slot: try to claim it. */
+			if (atomic_compare_exchange_weak_explicit (&enqueuePos, &pos, pos + 1,
+					memory_order_relaxed, memory_order_relaxed))
+				break;
+		} else if (seq < pos) {	/* Ring full: never wait for the writer... */
+			if (!losslessMode) {
+				atomic_fetch_add_explicit (&dropped, 1, memory_order_relaxed);
+				if (recorded && record_type (type) != -1)
+					atomic_fetch_add_explicit (&lost, 1, memory_order_relaxed);
+				return;
+			}
+			sched_yield ();	/* ... unless no one is late. */
+			pos = atomic_load_explicit (&enqueuePos, memory_order_relaxed);
+		} else {	/* Claimed by another producer meanwhile. */
+			pos = atomic_load_explicit (&enqueuePos, memory_order_relaxed);
+		}
+	}
+
+	slot->record.time = time;
+	slot->record.stamp = stampOrigin ? log_now () - stampOrigin : time;
+	slot->record.car = car;
+	slot->record.value = value;
+	slot->record.lane = lane;
+	slot->record.junction = junction;
+	slot->record.type = type;
+	atomic_store_explicit (&slot->seq, pos + 1, memory_order_release);
+}
+
+/**
+ * Wait until the writer has printed all the records logged so far.
+ * Used before printing directly on the standard output.
+ */
+void log_flush () {
+	long pos;
+
+	if (!ring)
+		return;
+	pos = atomic_load (&enqueuePos);
+	while (atomic_load (&flushedPos) < pos)
+		usleep (LOG_IDLE_TIME);
+}
+
+/**
+ * Flush the pending records, stop the writer thread, close the trace and
+ * the recording and, in quiet mode, print the number of events of each kind.
+ */
+void log_close () {
+	if (ring) {
+		atomic_store (&stopWriter, 1);
+		pthread_join (writer, 0);
+		free (ring);
+		ring = 0;
+	}
+	trace_close ();
+	if (atomic_load (&lost))
+		record_lost (atomic_load (&lost));
+	record_close ();
+
+	if (quietMode) {
+		printf (
+			" EVENTS: %ld arrival(s), %ld stop(s), %ld passage(s), %ld light switch(es), %ld release(s)\n",
+			atomic_load (&counters[LOG_CAR_ARRIVAL]),
+			atomic_load (&counters[LOG_CAR_WAITING]),
+			atomic_load (&counters[LOG_CAR_PASSED]),
+			atomic_load (&counters[LOG_LIGHT_GREEN]),
+			atomic_load (&counters[LOG_CARS_RELEASED])
+		);
+		fflush (stdout);
+	}
+	if (atomic_load (&dropped))
+		fprintf (stderr, " LOG: %ld record(s) dropped, the ring buffer was full\n",
+			atomic_load (&dropped));
+	if (atomic_load (&lost))
+		fprintf (stderr, " LOG: %ld entrie(s) missing from the recording, it cannot be replayed\n",
+			atomic_load (&lost));
+}
@@ -0,0 +1,140 @@
+/**
+ *
+ * @file events.c
+ * Timestamped events and the priority queue ordering them.
+ *
+ * Implementation of functions defined in @see events.h
+ *
+ * @version 1.0
+ *
+ * ********************************************************* */
+#include <stdlib.h>
+#include <string.h>
+#include "../inc/events.h"
+
+/**
+ * Tell if an event must be handled before another one.
+ */
+static int evq_before (Event * a, Event * b) {
+	if (a->time != b->time)
+		return a->time < b->time;
+	return a->seq < b->seq;
+}
+
+/**
+ * Allocate an empty event queue.
+ *
+ * @param queue the queue to initialize
+ * @param capacity the initial number of events which can be stored
+ *
+ * @return 0 if success, -1 otherwise
+ */
+int evq_init (EventQueue * queue, long capacity) {
+	if (capacity <= 0)
+		capacity = DEFAULT_EVENT_CAPACITY;
+	queue->events = malloc (capacity * sizeof (Event));
+	if (!queue->events)
+		return -1;
+	queue->size = 0;
+	queue->capacity = capacity;
+	queue->seq = 0;
+	return 0;
+}
+
+/**
+ * Release the storage of an event queue.
+ *
+ * @param queue the queue to destroy
+ */
+void evq_free (EventQueue * queue) {
+	free (queue->events);
+	queue->events = 0;
+	queue->size = queue->capacity = 0;
+}
+
+/**
+ * Insert an event in the queue.
+ *
+ * @param queue the event queue
+ * @param time the date of the event
+ * @param type the kind of event
+ * @param car the car concerned by the event (0: none)
+ * @param lane the lane concerned by the event
+ *
+ * @return 0 if success, -1 otherwise
+ */
+int evq_push (EventQueue * queue, long time, EventType type, Car * car, int lane) {
+	Event * grown, event;
+	long i, parent;
+
+	if (queue->size == queue->capacity) {
+		grown = realloc (queue->events, 2 * queue->capacity * sizeof (Event));
+		if (!grown)
+			return -1;
+		queue->events = grown;
+		queue->capacity *= 2;
+	}
+
+	event.time = time;
+	event.seq = queue->seq++;
+	event.type = type;
+	if (car)
+		event.car = *car;
+	else
+		memset (&event.car, 0, sizeof (Car));	/* No stray byte copied with the event. */
+	event.lane = lane;
+
+	/* Sift up from the last leaf. */
+	for (i = queue->size++; i > 0; i = parent) {
+		parent = (i - 1) / 2;
+		if (!evq_before (&event, &queue->events[parent]))
+			break;
+		queue->events[i] = queue->events[parent];
+	}
+	queue->events[i] = event;
+	return 0;
+}
+
+/**
+ * Remove the earliest event from the queue.
+ *
+ * @param queue the event queue
+ * @param event the removed event
+ *
+ * @return 1 if an event is returned, 0 if the queue is empty
+ */
+int evq_pop (EventQueue * queue, Event * event) {
+	Event last;
+	long i, child;
+
+	if (queue->size == 0)
+		return 0;
+
+	*event = queue->events[0];
+	last = queue->events[--queue->size];
+
+	/* Sift down the last leaf from the root. */
+	for (i = 0; (child = 2 * i + 1) < queue->size; i = child) {
+		if (child + 1 < queue->size
+				&& evq_before (&queue->events[child + 1], &queue->events[child]))
+			child++;
+		if (!evq_before (&queue->events[child], &last))
+			break;
+		queue->events[i] = queue->events[child];
+	}
+	queue->events[i] = last;
+	return 1;
+}
+
+/**
+ * Give the earliest event of the queue without removing it.
+ *
+ * @param queue the event queue
+ *
+ * @return the earliest event, 0 if the queue is empty
+ */
+Event * evq_peek (EventQueue * queue) {
+	if (queue->size == 0)
+		return 0;
+	return &queue->events[0];
+}
@@ -1,7 +1,7 @@
 /**
  * 
  * @file ipcTools.c
- * Shared memory segments, semaphores and message queues
+ * Shared memory segments, semaphores and message rings
  * for collaborative processes synchronization.
  * 
  * Implementation of functions defined in @see ipcTools.h
@@ -10,6 +10,16 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <errno.h>
+#include <limits.h>
+#include <signal.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
 #include "../inc/ipcTools.h"
 
 /**
@@ -30,11 +40,170 @@ key_t convertkey (char * path, int prjt_id) {
         path = DEFAULT_PRJT_PATH;
     if (prjt_id < 0)
         prjt_id = DEFAULT_PRJT_ID;
-    if ((key = ftok (path, prjt_id) == -1))
+    if ((key = ftok (path, prjt_id)) == -1)
 		return -1;
 	return key;
 }
 
+/**
+ * A semaphore of the futex backend, alone on its cache line.
+ * 
+ * @param value the value of the semaphore, also the futex word
+ * @param waiters the number of processes sleeping on the futex
+ * @param key the key associated with the semaphore
+ * @param used set if the slot is allocated
+ */
+typedef struct {
+	atomic_int value;
+	atomic_int waiters;
+	key_t key;
+	int used;
+} __attribute__ ((aligned (64))) FutexSem;
+
+/**
+ * The selected backend of the semaphores.
+ */
+static int semBackend = IPC_BACKEND_SYSV;
+
+/**
+ * Table of the futex semaphores, in a shared anonymous mapping inherited
+ * by the forked processes.
+ */
+static FutexSem * futexSems;
+
+/**
+ * Flag of the futex operations: FUTEX_PRIVATE_FLAG with the private backend.
+ */
+static int futexPrivate;
+
+/**
+ * Sharing of the anonymous mappings: MAP_PRIVATE with the private backend.
+ */
+static int mapSharing = MAP_SHARED;
+
+/**
+ * Select the backend of the semaphores (@see IPC_BACKEND_SYSV).
+ * Must be called before allocating any semaphore, shared memory area or
+ * ring; the futex backend must be selected before forking the processes
+ * sharing the semaphores, and the private one shares nothing with them.
+ * 
+ * @param backend the backend's number
+ * 
+ * @return 0 if success, -1 otherwise
+ */
+int ipcbackend (int backend) {
+	if (backend != IPC_BACKEND_SYSV && backend != IPC_BACKEND_FUTEX
+			&& backend != IPC_BACKEND_PRIVATE)
+		return -1;
+	futexPrivate = (backend == IPC_BACKEND_PRIVATE) ? FUTEX_PRIVATE_FLAG : 0;
+	mapSharing = (backend == IPC_BACKEND_PRIVATE) ? MAP_PRIVATE : MAP_SHARED;
+	if (backend != IPC_BACKEND_SYSV && !futexSems) {
+		futexSems = mmap (0, MAX_FUTEX_SEM * sizeof (FutexSem), PROT_READ|PROT_WRITE,
+			mapSharing|MAP_ANONYMOUS, -1, 0);
+		if (futexSems == MAP_FAILED) {
+			futexSems = 0;
+			return -1;
+		}
+	}
+	semBackend = backend;
+	return 0;
+}
+
+/**
+ * Allocate a set of semaphores of the futex backend: consecutive slots of
+ * the table, the key being kept by the first one.
+ * 
+ * @return 0 if success, -1 otherwise
+ */
+static int futexsetalloc (SemSet * set, key_t key, int nbSems, unsigned short * values) {
+	int i, k, first = -1;
+
+	for (i = 0; i < MAX_FUTEX_SEM && key != IPC_PRIVATE; i++) {
+		if (futexSems[i].used && futexSems[i].key == key) {
+			set->id = i;	/* Already associated with the key. */
+			set->nbSems = nbSems;
+			return 0;
+		}
+	}
+	for (i = 0; i < MAX_FUTEX_SEM && first == -1; i++) {
+		for (k = 0; k < nbSems && i + k < MAX_FUTEX_SEM && !futexSems[i + k].used; k++);
+		if (k == nbSems)
+			first = i;
+	}
+	if (first == -1)
+		return -1;
+	for (k = 0; k < nbSems; k++) {
+		atomic_init (&futexSems[first + k].value, values ? values[k] : DEFAULT_SEM_VAL_INIT);
+		atomic_init (&futexSems[first + k].waiters, 0);
+		futexSems[first + k].key = k == 0 ? key : IPC_PRIVATE;
+		futexSems[first + k].used = 1;
+	}
+	set->id = first;
+	set->nbSems = nbSems;
+	return 0;
+}
+
+/**
+ * Allocate a set of semaphores at once.
+ * If a set is already associated with the given key, it is simply
+ * returned (not reallocated). With the System V backend, the set is a
+ * single semget, all the values being set by a single semctl.
+ * 
+ * @param set the set to initialize
+ * @param key the key associated with the set
+ * @param nbSems the number of semaphores of the set
+ * @param values the initial value of each semaphore (0: DEFAULT_SEM_VAL_INIT)
+ * 
+ * @return 0 if success, -1 otherwise
+ */
+int semsetalloc (SemSet * set, key_t key, int nbSems, unsigned short * values) {
+	unsigned short defaults[nbSems];
+	int i;
+
+	if (nbSems <= 0)
+		return -1;
+	if (semBackend != IPC_BACKEND_SYSV)
+		return futexsetalloc (set, key, nbSems, values);
+	set->nbSems = nbSems;
+	/* A private key always creates a new set: nothing to look up. */
+	set->id = (key == IPC_PRIVATE) ? -1 : semget (key, nbSems, 0);
+	if (set->id == -1) {	/* The set does not exist yet. */
+		set->id = semget (key, nbSems, IPC_CREAT|IPC_EXCL|0600);
+		if (set->id == -1)
+			return -1;
+		if (!values) {
+			for (i = 0; i < nbSems; i++)
+				defaults[i] = DEFAULT_SEM_VAL_INIT;
+			values = defaults;
+		}
+		if (semctl (set->id, 0, SETALL, values) == -1) {
+			semctl (set->id, 0, IPC_RMID, 0);
+			return -1;
+		}
+	}
+	return 0;
+}
+
+/**
+ * Destroy a set of semaphores, all its semaphores at once.
+ * 
+ * @param set the set
+ * 
+ * @return 0 if success, -1 otherwise
+ */
+int semsetfree (SemSet * set) {
+	int k;
+
+	if (semBackend != IPC_BACKEND_SYSV) {
+		if (set->id < 0 || set->id + set->nbSems > MAX_FUTEX_SEM || !futexSems[set->id].used)
+			return -1;
+		for (k = 0; k < set->nbSems; k++)
+			futexSems[set->id + k].used = 0;
+		return 0;
+	}
+	return semctl (set->id, 0, IPC_RMID, 0);
+}
+
 /**
  * Allocate a semaphore.
  * If a semaphore is already associated with the given key, it is
@@ -46,19 +215,10 @@ key_t convertkey (char * path, int prjt_id) {
  * @return the generated id of the sempahore if success, -1 otherwise
  */
 int semalloc (key_t key, int valInit) {
-	int semid = semget (key, 1, 0);
-	if (semid == -1) {	/* The semaphore does not exist yet. */
-		semid = semget (key, 1, IPC_CREAT|IPC_EXCL|0600);
-		if (semid == -1)
-			return -1;
-		if (valInit < 0)
-			valInit = DEFAULT_SEM_VAL_INIT;
-		if (semctl (semid, 0, SETVAL, valInit) == -1) {
-			semctl (semid, 0, IPC_RMID, 0);
-			return -1;
-		}
-	}
-	return semid;
+	unsigned short value = (valInit < 0) ? DEFAULT_SEM_VAL_INIT : valInit;
+	SemSet set;
+
+	return semsetalloc (&set, key, 1, &value) == -1 ? -1 : set.id;
 }
 
 /**
@@ -69,18 +229,146 @@ int semalloc (key_t key, int valInit) {
  * @return 0 if success, -1 otherwise
  */
 int semfree (int semid) {
-	return semctl (semid, 0, IPC_RMID, 0);
+	SemSet set = {semid, 1};
+
+	return semsetfree (&set);
+}
+
+/**
+ * Block on a futex semaphore: decrement it in user space if it is
+ * positive, sleep in the kernel only while it is zero.
+ */
+static void futexP (FutexSem * sem) {
+	int value;
+
+	while (1) {
+		value = atomic_load (&sem->value);
+		while (value > 0) {
+			if (atomic_compare_exchange_weak (&sem->value, &value, value - 1))
+				return;
+		}
+		atomic_fetch_add (&sem->waiters, 1);
+		/* Sleeps only if the value is still zero when the kernel checks it. */
+		syscall (SYS_futex, &sem->value, FUTEX_WAIT|futexPrivate, 0, 0, 0, 0);
+		atomic_fetch_sub (&sem->waiters, 1);
+	}
+}
+
+/**
+ * Unlock a futex semaphore: increment it in user space, enter the
+ * kernel only if a process sleeps on it.
+ */
+static void futexV (FutexSem * sem) {
+	atomic_fetch_add (&sem->value, 1);
+	if (atomic_load (&sem->waiters) > 0)
+		syscall (SYS_futex, &sem->value, FUTEX_WAKE|futexPrivate, 1, 0, 0, 0);
+}
+
+/**
+ * Block on a semaphore of a set.
+ * 
+ * @param set the set
+ * @param sem the number of the semaphore in the set
+ */
+void Pset (SemSet * set, int sem) {
+	struct sembuf op = {sem, -1, 0};
+
+	if (semBackend != IPC_BACKEND_SYSV)
+		futexP (&futexSems[set->id + sem]);
+	else
+		semop (set->id, &op, 1);
 }
 
 /**
- * Used to implement the P operation on semaphores (decrementation).
+ * Take a semaphore of a set if it is free, without blocking.
+ * 
+ * @param set the set
+ * @param sem the number of the semaphore in the set
+ * 
+ * @return 0 if taken, -1 if it would block
  */
-static struct sembuf sP = {0,-1,0};
+int Ptryset (SemSet * set, int sem) {
+	struct sembuf op = {sem, -1, IPC_NOWAIT};
+	FutexSem * futex;
+	int value;
+
+	if (semBackend == IPC_BACKEND_SYSV)
+		return semop (set->id, &op, 1);
+	futex = &futexSems[set->id + sem];
+	value = atomic_load (&futex->value);
+	while (value > 0)
+		if (atomic_compare_exchange_weak (&futex->value, &value, value - 1))
+			return 0;
+	return -1;
+}
+
+/**
+ * Unlock a semaphore of a set.
+ * 
+ * @param set the set
+ * @param sem the number of the semaphore in the set
+ */
+void Vset (SemSet * set, int sem) {
+	struct sembuf op = {sem, 1, 0};
+
+	if (semBackend != IPC_BACKEND_SYSV)
+		futexV (&futexSems[set->id + sem]);
+	else
+		semop (set->id, &op, 1);
+}
+
+/**
+ * Block on several semaphores of a set.
+ * With the System V backend, they are all taken at once by a single
+ * semop, or none while one of them is zero. With the futex backends, they
+ * are taken one after the other, in the given order: all the callers must
+ * give them in the same order (the increasing one).
+ * 
+ * @param set the set
+ * @param sems the numbers of the semaphores in the set
+ * @param n the number of semaphores
+ */
+void Pmulti (SemSet * set, int * sems, int n) {
+	struct sembuf ops[n];
+	int i;
+
+	if (semBackend != IPC_BACKEND_SYSV) {
+		for (i = 0; i < n; i++)
+			futexP (&futexSems[set->id + sems[i]]);
+		return;
+	}
+	for (i = 0; i < n; i++) {
+		ops[i].sem_num = sems[i];
+		ops[i].sem_op = -1;
+		ops[i].sem_flg = 0;
+	}
+	semop (set->id, ops, n);
+}
 
 /**
- * Used to implement the V operation on semaphores (incrementation).
+ * Unlock several semaphores of a set, with a single semop on the System V
+ * backend.
+ * 
+ * @param set the set
+ * @param sems the numbers of the semaphores in the set
+ * @param n the number of semaphores
  */
-static struct sembuf sV = {0, 1,0};
+void Vmulti (SemSet * set, int * sems, int n) {
+	struct sembuf ops[n];
+	int i;
+
+	if (semBackend != IPC_BACKEND_SYSV) {
+		for (i = 0; i < n; i++)
+			futexV (&futexSems[set->id + sems[i]]);
+		return;
+	}
+	for (i = 0; i < n; i++) {
+		ops[i].sem_num = sems[i];
+		ops[i].sem_op = 1;
+		ops[i].sem_flg = 0;
+	}
+	semop (set->id, ops, n);
+}
 
 /**
  * Block on a semaphore.
@@ -88,7 +376,22 @@ static struct sembuf sV = {0, 1,0};
  * @param semid the semaphore's id
  */
 void P (int semid) {
-	semop (semid, &sP, 1);
+	SemSet set = {semid, 1};
+
+	Pset (&set, 0);
+}
+
+/**
+ * Take a semaphore if it is free, without blocking.
+ * 
+ * @param semid the semaphore's id
+ * 
+ * @return 0 if taken, -1 if it would block
+ */
+int Ptry (int semid) {
+	SemSet set = {semid, 1};
+
+	return Ptryset (&set, 0);
 }
 
 /**
@@ -97,13 +400,18 @@ void P (int semid) {
  * @param semid the semaphore's id
  */
 void V (int semid) {
-	semop (semid, &sV, 1);
+	SemSet set = {semid, 1};
+
+	Vset (&set, 0);
 }
 
 /**
  * Allocate a shared memory area.
  * If a shared memory is already allocated with the specified key,
  * its address will be returned and not reallocated.
+ * A private area is destroyed by the system as soon as the last process
+ * attached to it (the caller and its forked children) detaches or ends;
+ * with the private backend, it is only mapped in the calling process.
  * 
  * @param key the key associated with the shared memory
  * @param size the size of the memory segment
@@ -114,7 +422,14 @@ void * shmalloc (key_t key, int size) {
     void * addr;
 	int alreadyCreat = 0;	/*	Used for specified if its already allocated
 								0: not yet,	1: yes	*/
-	int shmid = shmget (key, 1, 0600);
+	int shmid;
+	/* No other process to share it with: an anonymous mapping of the process. */
+	if (key == IPC_PRIVATE && semBackend == IPC_BACKEND_PRIVATE) {
+		addr = mmap (0, size, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+		return addr == MAP_FAILED ? 0 : addr;
+	}
+	/* A private key always creates a new area: nothing to look up. */
+	shmid = (key == IPC_PRIVATE) ? -1 : shmget (key, 1, 0600);
 	if (shmid == -1) {	/* The shared memory does not exist yet. */
 		alreadyCreat = 1;
 		shmid = shmget (key, size, IPC_CREAT|IPC_EXCL|0600);
@@ -127,6 +442,9 @@ void * shmalloc (key_t key, int size) {
 			shmctl (shmid, IPC_RMID, 0);
 		return 0;
 	}
+	/* Nobody else can find a private area: never leave it behind a crash. */
+	if (key == IPC_PRIVATE)
+		shmctl (shmid, IPC_RMID, 0);
     return addr;
 }
 
@@ -138,83 +456,383 @@ void * shmalloc (key_t key, int size) {
  * @return 0 if success, -1 otherwise
  */
 int shmfree (key_t key) {
-	int shmid = shmget (key, 0, 0600);
+	int shmid;
+	if (key == IPC_PRIVATE)
+		return 0;	/* Already marked for destruction by shmalloc. */
+	shmid = shmget (key, 0, 0600);
 	return shmctl (shmid, IPC_RMID, NULL);
 }
 
 /**
- * Allocate a message queue.
- * If a message queue is already associated with the given key,
- * the existing id is returned (not reallocated).
+ * The process which registered the semaphores of the instance.
+ */
+static pid_t registeredPid;
+
+/**
+ * Give the path of the registry file of an instance.
+ */
+static void ipcinstancepath (pid_t pid, char * path, int size) {
+	snprintf (path, size, "%s%d", DEFAULT_INSTANCES_PATH, (int) pid);
+}
+
+/**
+ * Record the running instance and its System V semaphores, so that they
+ * can be destroyed by ipcreap if the instance is killed.
+ * The futex semaphores live in an anonymous mapping: they are not recorded.
  * 
- * @param key the key associated with the message queue
+ * @param semids the ids of the semaphores
+ * @param nbSems the number of semaphores
  * 
- * @return the associated id of the message queue, -1 otherwise
+ * @return 0 if success, -1 otherwise
  */
-int msgalloc (key_t key) {
-    int msgqid = msgget (key, 0);
-	if (msgqid == -1) {	/* The message queue does not exist yet. */
-		msgqid = msgget (key, IPC_CREAT|IPC_EXCL|0777);
+int ipcregister (int * semids, int nbSems) {
+	char path[64];
+	FILE * file;
+	int i;
+
+	if (semBackend != IPC_BACKEND_SYSV)
+		nbSems = 0;
+	mkdir (DEFAULT_ETC_PATH, 0700);	/* May already exist. */
+	mkdir (DEFAULT_INSTANCES_PATH, 0700);
+
+	ipcinstancepath (getpid (), path, sizeof (path));
+	if (!(file = fopen (path, "w")))
+		return -1;
+	for (i = 0; i < nbSems; i++)
+		fprintf (file, "sem %d\n", semids[i]);
+	if (fclose (file) == EOF) {
+		unlink (path);
+		return -1;
 	}
-	return msgqid;
+	registeredPid = getpid ();
+	return 0;
+}
+
+/**
+ * Forget the semaphores recorded by ipcregister. Must be called before
+ * destroying them: once destroyed, their ids may be given to another
+ * instance, which ipcreap must never touch.
+ * 
+ * @return 0 if success, -1 otherwise
+ */
+int ipcunregister () {
+	char path[64];
+
+	if (!registeredPid)
+		return 0;
+	ipcinstancepath (registeredPid, path, sizeof (path));
+	registeredPid = 0;
+	return unlink (path);
 }
 
 /**
- * Destroy the message queue associated with the given id.
+ * Record another object of the running instance, for the tools which
+ * look at it (@see ipclookup). The reaper leaves these objects alone.
  * 
- * @param msgqid the id associated with the message queue.
+ * @param kind the kind of the object, a single word
+ * @param id the id of the object
  * 
  * @return 0 if success, -1 otherwise
  */
-int msgfree (int msgqid) {
-    return msgctl (msgqid, IPC_RMID, NULL);
+int ipcpublish (char * kind, int id) {
+	char path[64];
+	FILE * file;
+
+	if (!registeredPid)
+		return -1;
+	ipcinstancepath (registeredPid, path, sizeof (path));
+	if (!(file = fopen (path, "a")))
+		return -1;
+	fprintf (file, "%s %d\n", kind, id);
+	return fclose (file) == EOF ? -1 : 0;
 }
 
 /**
- * The statically allocated buffer to handle messages
- * in message-queue-related functions
+ * Give the running instances recorded in the registry.
+ * 
+ * @param pids the process ids of the instances
+ * @param max the maximum number of instances
+ * 
+ * @return the number of instances, -1 if the registry can not be read
  */
-static struct { long type; char msg[MAX_MSG_SIZE]; } buffer;
+int ipcinstances (int * pids, int max) {
+	struct dirent * entry;
+	DIR * registry;
+	int pid, n = 0;
+	char * near;
+
+	if (!(registry = opendir (DEFAULT_INSTANCES_PATH)))
+		return (errno == ENOENT) ? 0 : -1;
+	while (n < max && (entry = readdir (registry))) {
+		pid = (int) strtol (entry->d_name, &near, 10);
+		if (near == entry->d_name || *near != '\0' || pid <= 0)
+			continue;
+		if (kill (pid, 0) == 0 || errno != ESRCH)
+			pids[n++] = pid;
+	}
+	closedir (registry);
+	return n;
+}
 
 /**
- * Send a message in a message queue with the specified id in input.
+ * Give the id of an object recorded by an instance.
  * 
- * @param msgqid the id associated with the message queue.
- * @param msg the sended message in the message queue
- * @param size the size of the message
+ * @param pid the process id of the instance
+ * @param kind the kind of the object
  * 
- * @return 0 if success, -1 otherwise
+ * @return the id of the object, -1 if it is not recorded
  */
-int msgsend (int msgqid, char * msg, int size) {
+int ipclookup (int pid, char * kind) {
+	char path[64], name[16];
+	FILE * file;
+	int id, found = -1;
 
-	if (size > MAX_MSG_SIZE) {
-		perror ("Sended message size too long");
+	ipcinstancepath (pid, path, sizeof (path));
+	if (!(file = fopen (path, "r")))
 		return -1;
+	while (found == -1 && fscanf (file, "%15s %d", name, &id) == 2)
+		if (strcmp (name, kind) == 0)
+			found = id;
+	fclose (file);
+	return found;
+}
+
+/**
+ * Destroy the semaphores left by the instances which ended without
+ * cleaning up (killed or crashed), then forget these instances.
+ * The running instances are left untouched.
+ * 
+ * @return the number of reaped instances, -1 if the registry can not be read
+ */
+int ipcreap () {
+	char path[64 + 256], kind[8];
+	struct dirent * entry;
+	DIR * registry;
+	FILE * file;
+	int pid, id, nbReaped = 0;
+	char * near;
+
+	if (!(registry = opendir (DEFAULT_INSTANCES_PATH)))
+		return (errno == ENOENT) ? 0 : -1;
+
+	while ((entry = readdir (registry))) {
+		pid = (int) strtol (entry->d_name, &near, 10);
+		if (near == entry->d_name || *near != '\0' || pid <= 0)
+			continue;	/* "." and "..", or not a registry file. */
+		if (kill (pid, 0) == 0 || errno != ESRCH)
+			continue;	/* Still running. */
+
+		snprintf (path, sizeof (path), "%s%s", DEFAULT_INSTANCES_PATH, entry->d_name);
+		if ((file = fopen (path, "r"))) {
+			while (fscanf (file, "%7s %d", kind, &id) == 2)
+				if (strcmp (kind, "sem") == 0)
+					semctl (id, 0, IPC_RMID, 0);	/* May already be destroyed. */
+			fclose (file);
+		}
+		unlink (path);
+		nbReaped++;
 	}
-	buffer.type = 1;
-	strncpy (buffer.msg, msg, size);
-	return msgsnd (msgqid, &buffer, size, 0);
+	closedir (registry);
+	return nbReaped;
 }
 
 /**
- * Receive a message from a message queue with the corresponding id
- * specified as input.
+ * The header of a slot of a ring, followed by the record.
  * 
- * @param msgqid the id associated with the message queue.
- * @param msg the received message from the message queue
- * @param size the size of the message
+ * @param seq the position for which the slot is free (seq == position), or
+ * 		holds a published record (seq == position + 1)
+ * @param pos the position reserved by the producer writing the slot
+ */
+typedef struct {
+	atomic_long seq;
+	long pos;
+} RingSlot;
+
+/**
+ * A ring of slots (@see ipcTools.h). The fields written by the producers,
+ * by the consumer, and the fixed ones are on distinct cache lines.
+ * 
+ * @param head the next position to reserve
+ * @param released the futex word of the producers, bumped at each release
+ * @param producers the number of producers sleeping on released
+ * @param tail the next position to read (consumer only)
+ * @param committed the futex word of the consumer, bumped at each commit
+ * @param consumer set while the consumer sleeps on committed
+ * @param mask the number of slots minus one
+ * @param stride the distance between two slots
+ * @param size the size of the mapping
+ * @param slots the slots
+ */
+struct Ring {
+	atomic_long head __attribute__ ((aligned (64)));
+	atomic_int released;
+	atomic_int producers;
+	long tail __attribute__ ((aligned (64)));
+	atomic_int committed;
+	atomic_int consumer;
+	long mask __attribute__ ((aligned (64)));
+	long stride;
+	size_t size;
+	char slots[] __attribute__ ((aligned (64)));
+};
+
+/**
+ * Give the slot of a position.
+ */
+static inline RingSlot * ringslot (Ring * ring, long pos) {
+	return (RingSlot *) (ring->slots + (pos & ring->mask) * ring->stride);
+}
+
+/**
+ * Allocate a ring, shared with the processes forked afterwards (only
+ * with the threads of the process with the private backend).
+ * Each slot starts on a cache line, so that two processes writing
+ * neighbour slots do not share it.
+ * 
+ * @param slotSize the size of a record
+ * @param nbSlots the number of slots, rounded up to a power of two
+ * 
+ * @return the ring if success, 0 otherwise
+ */
+Ring * ringalloc (int slotSize, int nbSlots) {
+	long stride = (sizeof (RingSlot) + slotSize + 63) & ~63L;
+	long nb = 1, i;
+	size_t size;
+	Ring * ring;
+
+	if (slotSize <= 0 || nbSlots <= 0)
+		return 0;
+	while (nb < nbSlots)
+		nb <<= 1;
+	size = sizeof (Ring) + nb * stride;
+	ring = mmap (0, size, PROT_READ|PROT_WRITE, mapSharing|MAP_ANONYMOUS, -1, 0);
+	if (ring == MAP_FAILED)
+		return 0;
+	atomic_init (&ring->head, 0);
+	atomic_init (&ring->released, 0);
+	atomic_init (&ring->producers, 0);
+	ring->tail = 0;
+	atomic_init (&ring->committed, 0);
+	atomic_init (&ring->consumer, 0);
+	ring->mask = nb - 1;
+	ring->stride = stride;
+	ring->size = size;
+	for (i = 0; i < nb; i++)
+		atomic_init (&ringslot (ring, i)->seq, i);
+	return ring;
+}
+
+/**
+ * Unmap a ring in the calling process.
+ * 
+ * @param ring the ring
+ * 
+ * @return 0 if success, -1 otherwise
+ */
+int ringfree (Ring * ring) {
+	return munmap (ring, ring->size);
+}
+
+/**
+ * Reserve consecutive slots to write records in place, waiting for
+ * the consumer to free them if the ring is full.
  * 
- * @return the number of byte read if success, -1 otherwise
+ * The positions are taken with a single atomic addition, whatever the
+ * number of slots and of producers.
+ * 
+ * @param ring the ring
+ * @param slots the addresses of the reserved slots
+ * @param n the number of slots, at most the size of the ring
+ * 
+ * @return n if success, -1 otherwise
  */
-int msgrecv (int msgqid, char * msg, int size) {
-	int rcv;
-	if (size > MAX_MSG_SIZE) {
-		perror ("Received message size too long");
+int ringreserve (Ring * ring, void ** slots, int n) {
+	RingSlot * slot;
+	long pos;
+	int i, released;
+
+	if (n <= 0 || n > ring->mask + 1)
 		return -1;
+	pos = atomic_fetch_add (&ring->head, n);
+	for (i = 0; i < n; i++, pos++) {
+		slot = ringslot (ring, pos);
+		while (atomic_load (&slot->seq) != pos) {	/* Full: wait for a release. */
+			released = atomic_load (&ring->released);
+			atomic_fetch_add (&ring->producers, 1);
+			if (atomic_load (&slot->seq) != pos)
+				syscall (SYS_futex, &ring->released, FUTEX_WAIT|futexPrivate, released, 0, 0, 0);
+			atomic_fetch_sub (&ring->producers, 1);
+		}
+		slot->pos = pos;
+		slots[i] = slot + 1;
+	}
+	return n;
+}
+
+/**
+ * Publish the records written in reserved slots, waking the consumer
+ * only if it sleeps.
+ * 
+ * @param ring the ring
+ * @param slots the addresses given by ringreserve
+ * @param n the number of slots
+ */
+void ringcommit (Ring * ring, void ** slots, int n) {
+	RingSlot * slot;
+	int i;
+
+	for (i = 0; i < n; i++) {
+		slot = (RingSlot *) slots[i] - 1;
+		atomic_store (&slot->seq, slot->pos + 1);
 	}
-	buffer.type = 1;
-	rcv = msgrcv (msgqid, &buffer, size, 1, 0);
-	if (rcv != -1)
-		strncpy (msg, buffer.msg, size);
-    return rcv;
-}
\ No newline at end of file
+	atomic_fetch_add (&ring->committed, 1);
+	if (atomic_load (&ring->consumer))
+		syscall (SYS_futex, &ring->committed, FUTEX_WAKE|futexPrivate, 1, 0, 0, 0);
+}
+
+/**
+ * Wait for published records and give the slots holding them, in order,
+ * to be read in place. Only the consumer calls it.
+ * 
+ * @param ring the ring
+ * @param slots the addresses of the slots ready to be read
+ * @param max the maximum number of slots
+ * 
+ * @return the number of slots, at least 1
+ */
+int ringpeek (Ring * ring, void ** slots, int max) {
+	RingSlot * slot = ringslot (ring, ring->tail);
+	int n, committed;
+
+	while (atomic_load (&slot->seq) != ring->tail + 1) {	/* Empty: wait for a commit. */
+		committed = atomic_load (&ring->committed);
+		atomic_store (&ring->consumer, 1);
+		if (atomic_load (&slot->seq) != ring->tail + 1)
+			syscall (SYS_futex, &ring->committed, FUTEX_WAIT|futexPrivate, committed, 0, 0, 0);
+		atomic_store (&ring->consumer, 0);
+	}
+	for (n = 0; n < max && n <= ring->mask; n++) {
+		slot = ringslot (ring, ring->tail + n);
+		if (atomic_load (&slot->seq) != ring->tail + n + 1)
+			break;
+		slots[n] = slot + 1;
+	}
+	return n;
+}
+
+/**
+ * Give back to the producers the first slots given by ringpeek, waking
+ * them only if some sleep.
+ * 
+ * @param ring the ring
+ * @param n the number of slots read
+ */
+void ringrelease (Ring * ring, int n) {
+	int i;
+
+	for (i = 0; i < n; i++, ring->tail++)
+		atomic_store (&ringslot (ring, ring->tail)->seq, ring->tail + ring->mask + 1);
+	atomic_fetch_add (&ring->released, 1);
+	if (atomic_load (&ring->producers) > 0)
+		syscall (SYS_futex, &ring->released, FUTEX_WAKE|futexPrivate, INT_MAX, 0, 0, 0);
+}
@@ -0,0 +1,92 @@
+/**
+ *
+ * @file lanequeue.c
+ * First-in first-out queue of the cars stopped on one lane.
+ *
+ * Implementation of functions defined in @see lanequeue.h
+ *
+ * @version 1.0
+ *
+ * ********************************************************* */
+#include <stdlib.h>
+#include "../inc/lanequeue.h"
+
+/**
+ * Allocate an empty lane queue.
+ *
+ * @param queue the queue to initialize
+ *
+ * @return 0 if success, -1 otherwise
+ */
+int lq_init (LaneQueue * queue) {
+	queue->cars = malloc (DEFAULT_LANE_CAPACITY * sizeof (Car));
+	if (!queue->cars)
+		return -1;
+	if (pthread_mutex_init (&queue->mut, 0) != 0) {
+		free (queue->cars);
+		return -1;
+	}
+	queue->head = 0;
+	queue->size = 0;
+	queue->capacity = DEFAULT_LANE_CAPACITY;
+	queue->discharging = 0;
+	return 0;
+}
+
+/**
+ * Release the storage of a lane queue.
+ *
+ * @param queue the queue to destroy
+ */
+void lq_free (LaneQueue * queue) {
+	free (queue->cars);
+	queue->cars = 0;
+	queue->size = queue->capacity = 0;
+	pthread_mutex_destroy (&queue->mut);
+}
+
+/**
+ * Add a car at the end of the queue.
+ *
+ * @param queue the lane queue
+ * @param car the car
+ *
+ * @return 0 if success, -1 otherwise
+ */
+int lq_push (LaneQueue * queue, Car * car) {
+	Car * grown;
+	long i;
+
+	if (queue->size == queue->capacity) {
+		grown = malloc (2 * queue->capacity * sizeof (Car));
+		if (!grown)
+			return -1;
+		/* Unroll the ring at the start of the new storage. */
+		for (i = 0; i < queue->size; i++)
+			grown[i] = queue->cars[(queue->head + i) % queue->capacity];
+		free (queue->cars);
+		queue->cars = grown;
+		queue->head = 0;
+		queue->capacity *= 2;
+	}
+	queue->cars[(queue->head + queue->size) % queue->capacity] = *car;
+	queue->size++;
+	return 0;
+}
+
+/**
+ * Remove the first car of the queue.
+ *
+ * @param queue the lane queue
+ * @param car the removed car
+ *
+ * @return 1 if a car is returned, 0 if the queue is empty
+ */
+int lq_pop (LaneQueue * queue, Car * car) {
+	if (queue->size == 0)
+		return 0;
+	*car = queue->cars[queue->head];
+	queue->head = (queue->head + 1) % queue->capacity;
+	queue->size--;
+	return 1;
+}
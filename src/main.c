@@ -9,8 +9,58 @@
  * ********************************************************* */
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "../inc/main.h"
 
+/**
+ * Role of a lane: its circulation.
+ *
+ * @param arg the lane's number
+ */
+static int main_lane (void * arg) {
+	run_circulation ((int) (long) arg, timeSwitchWay);
+	return 0;
+}
+
+/**
+ * Role of the cars: their arrivals, then the report of the simulation.
+ *
+ * @param arg unused
+ */
+static int main_cars (void * arg) {
+	int exec;
+
+	/* A process has a log of its own, the threads share the one of main. */
+	if (simuRoles == ROLES_PROCESS && log_init (simuQuiet, 0) == -1) {
+		perror ("Error creating event log");
+		massive_cleanup (7, 99);
+	}
+	stats_init (&simuStats, nbMaxCars);
+	simuStats.phases = shared->phases;	/* Recorded by the lanes. */
+	exec = generate_cars (nbMaxCars, timelapseNewCars, saturationFlow,
+		scenarioFile ? &scenario : 0);
+	if (simuRoles == ROLES_PROCESS)
+		log_close ();
+	else
+		log_flush ();
+	scenario_close (&scenario);
+	if (!exec)
+		main_report ();
+	if (exec)
+		massive_cleanup (exec, 99);
+	return exec;
+}
+
+/**
+ * Role of the user's commands, from the terminal or from a script.
+ *
+ * @param arg the file descriptor of the input
+ */
+static int main_command (void * arg) {
+	command_loop ((int) (long) arg);
+	return 0;
+}
+
 /**
  * The main part of the program:
  * 		- Set up environnement with command line arguments
@@ -20,172 +70,204 @@
  */
 int main (int argc, char * argv[]) {
 
-	key_t key;	/* The first key */
-	struct sigaction endCirc, endProg;	/* Used to signal the end of the program */
-	int i, exec;
+	int lanes[2] = {SEM_LANE, SEM_LANE + 1};
+	struct sigaction endProg;	/* Used to signal the end of the program */
+	Network network;	/* The junctions simulated by the engine */
+	EngineResult result;	/* The summary of the engine's run */
+	int commands = -1;	/* The input of the user's commands (-1: none) */
+	int i;
 
 	/* COMMAND LINE ARGUMENTS */
 
 	simuAutoMode = 0;	/* Choose the interactive mode by default */
+	simuRealTime = 0;	/* Batch runs use the virtual clock by default */
+	simuQuiet = 0;	/* Print every event by default */
 
 	if ((i = analyze_command_line_args (argc, argv)) <= 0)
 		return i;
 
-	/* SET UP & ALLOCATIONS */
-
-	if ((key = convertkey ("", -1)) == -1) {
-	    perror ("Converkey failed");
-		exit (1);
+	/* A parameter sweep: each configuration keeps its single value if not swept. */
+	if (batchMode) {
+		if (batch_default_range (&sweepSwitchTimes, timeSwitchWay) == -1
+				|| batch_default_range (&sweepTimelapses, timelapseNewCars) == -1
+				|| batch_default_range (&sweepNbCars, nbMaxCars) == -1) {
+			perror ("Error creating batch");
+			exit (2);
+		}
+		i = run_batch (&sweepSwitchTimes, &sweepTimelapses, &sweepNbCars,
+			batchRuns, batchJobs, saturationFlow, networkFile, scenarioFile ? &scenario : 0);
+		scenario_close (&scenario);
+		return i;
 	}
 
-	if ((lane[0] = semalloc (key+1, 0)) == -1) {
-		perror ("Error creating semaphore");
-		massive_cleanup (2, 0, 0);
-	}
-	if ((lane[1] = semalloc (key+2, 0)) == -1) {
-		perror ("Error creating semaphore");
-		massive_cleanup (2, 1, key);
+	/* An automatic simulation does not need any process: run it on the virtual clock. */
+	if (simuAutoMode && !simuRealTime) {
+		if (networkFile)
+			i = network_load (&network, networkFile, timeSwitchWay);
+		else
+			i = network_single (&network, timeSwitchWay);
+		if (i == -1)
+			exit (8);
+		if (traceFile && trace_open (traceFile) == -1) {
+			perror ("Error creating trace");
+			exit (12);
+		}
+		if (log_init (simuQuiet, 1) == -1) {
+			perror ("Error creating event log");
+			exit (6);
+		}
+		stats_init (&simuStats, nbMaxCars);
+		i = run_engine (&network, nbMaxCars, timelapseNewCars, saturationFlow,
+			scenarioFile ? &scenario : 0, simuSeed, &result);
+		log_close ();
+		scenario_close (&scenario);
+		network_free (&network);
+		if (i == 0) {
+			simuStats.nbCars = result.nbCars;
+			simuStats.duration = result.endTime;
+			main_report ();
+		}
+		return i;
 	}
-	if ((canAccess = semalloc (key, 0)) == -1) {
-		perror ("Error creating semaphore");
-		massive_cleanup (2, 2, key+1);
+
+	/* SET UP & ALLOCATIONS */
+
+	if (ipcbackend (syncBackend) == -1) {
+		perror ("Error selecting semaphore backend");
+		exit (2);
 	}
 
-	if ((mutex[0] = semalloc (key+3, 1)) == -1) {
-		perror ("Error creating mutex");
-		massive_cleanup (2, 3, key+2);
+	/* Destroy what the killed instances left behind. */
+	ipcreap ();
+
+	/* Private objects, inherited by the children: no other instance can reach them. */
+	if (semsetalloc (&sems, IPC_PRIVATE, NB_SEMS, 0) == -1) {	/* All locked. */
+		perror ("Error creating semaphores");
+		massive_cleanup (2, 0);
 	}
-	if ((mutex[1] = semalloc (key+4, 1)) == -1) {
-		perror ("Error creating mutex");
-		massive_cleanup (2, 4, key+3);
+	if (ipcregister (&sems.id, 1) == -1)
+		perror ("Warning: the instance could not be registered for the reaper");
+
+	if (!(shared = (Shared *) shmalloc (IPC_PRIVATE, sizeof (Shared)))) {
+		perror ("Error creating shared memory");
+		massive_cleanup (2, 6);
 	}
-	if ((mutex[2] = semalloc (key+5, 1)) == -1) {
-		perror ("Error creating mutex");
-		massive_cleanup (2, 5, key+4);
+	memset (shared, 0, sizeof (Shared));	/* Every flag and counter at zero. */
+
+	/* Inherited by the children: the junction and the user notify the cars through it. */
+	if (channel_open (&notices) == -1) {
+		perror ("Error creating notice channel");
+		massive_cleanup (2, 6);
 	}
 
-	if (!(shared = (Shared *) shmalloc (key+6, sizeof (Shared)))) {
-		perror ("Error creating shared memory");
-		massive_cleanup (2, 6, key+5);
+	/* Read live by cts-top, found through the registry of the instance. */
+	if (metrics_open (nbMaxCars) == -1) {
+		perror ("Error creating metrics");
+		massive_cleanup (2, 6);
 	}
-	shared->nbWaitingCars = 0;
-	shared->stopSig = 0;
 
 	/* START SIMULATION */
 
+	/* Unbuffered: the commands typed after <ENTER> are left to the command role. */
+	setvbuf (stdin, 0, _IONBF, 0);
 	puts ("\t[ STRIKE <ENTER> TO START THE SIMULATION ]\n");
 	getchar ();
+	fflush (stdout);	/* Else each child would print the banner again. */
+
+	/* Each role dates its events from its own start: the trace and the recording stamp them. */
+	if (traceFile || recordFile)
+		log_origin ();
+	if (traceFile && trace_open (traceFile) == -1) {
+		perror ("Error creating trace");
+		massive_cleanup (12, 6);
+	}
+	if (recordFile && record_open (recordFile, controller_name (controllerPolicy), simuSeed,
+			nbMaxCars, timeSwitchWay, saturationFlow) == -1) {
+		perror ("Error creating recording");
+		massive_cleanup (12, 6);
+	}
 
+	/* Opened before the roles: the processes inherit it. */
+	if ((!simuAutoMode || commandFile) && (commands = command_open (commandFile)) == -1) {
+		perror ("Error opening commands");
+		massive_cleanup (13, 6);
+	}
+
+	/* The threads log through the log of the main process, started before them. */
+	if (simuRoles == ROLES_THREAD && log_init (simuQuiet, 0) == -1) {
+		perror ("Error creating event log");
+		massive_cleanup (7, 99);
+	}
+
+	/* Role 0 and 1: the circulation on lane 1 and 2, role 2: the arrivals of cars */
 	for (i = 0; i < 3; i++) {
-		switch (pids[i] = fork ()) {
-			case -1:
-				perror ("fork failed");
-				massive_cleanup (3, 99, key+6);
-				exit (3);
-			case 0:
-				if (i != 2) {
-					/* Process 0 and 1: the circulation on lane 1 and 2 */
-					run_circulation (i, timeSwitchWay);
-					exit (0);
-				} else {
-					/* Process 2: the arrivals of cars */
-					exec = generate_cars (nbMaxCars, timelapseNewCars);
-					if (exec)
-						massive_cleanup (exec, 99, key+6);
-					exit (exec);
-				}
+		if (role_start (&roles[i], simuRoles, i != 2 ? main_lane : main_cars,
+				(void *) (long) i) == -1) {
+			perror (simuRoles == ROLES_THREAD ? "Error creating role thread" : "fork failed");
+			massive_cleanup (3, 99);
 		}
 	}
 
-	/* Verify if it's an interactive mode. */
-	if (!simuAutoMode) {
-		switch (pids[3] = fork ()) {
-			case -1:
-				perror ("fork failed");
-				massive_cleanup (3, 99, key+6);
-				exit (3);
-			case 0:
-				/* Process 3: the user's command */
-				user_lane_choice ();
-				exit (0);
-		}
+	/* Role 3: the user's commands, in interactive mode or from a script. */
+	if (commands != -1 && role_start (&roles[3], simuRoles, main_command,
+			(void *) (long) commands) == -1) {
+		perror (simuRoles == ROLES_THREAD ? "Error creating role thread" : "fork failed");
+		massive_cleanup (3, 99);
 	}
 
-	/* Prepare to end the simulation ! */
-	endCirc.sa_handler = crossroads_toggle_stop;
-	sigaction (INTERRUPT_CIRCULATION, &endCirc, 0);
+	/* Prepare to end the simulation ! The cars raise the end flag themselves. */
 	endProg.sa_handler = crossroads_toggle_stop;
+	endProg.sa_flags = 0;
+	sigemptyset (&endProg.sa_mask);
 	sigaction (STOP_PROG, &endProg, 0);
 
-	manage_junction (timeSwitchWay);	/* Coordinate child processes and switch the junction. */
+	if (simuRoles == ROLES_PROCESS && log_init (simuQuiet, 0) == -1) {
+		perror ("Error creating event log");
+		massive_cleanup (7, 99);
+	}
+	manage_junction ();	/* Coordinate the roles and switch the junction. */
 
 	/* END PROGRAM */
 
-	V (lane[0]);
-	V (lane[1]);
-	while (waitpid (0, 0, 0) < 0); /* Wait if a process doesn't finished yet. */
+	Vmulti (&sems, lanes, 2);
+	role_wait (&roles[0]);
+	role_wait (&roles[1]);
+	/* Interrupted, the cars never see their last one pass: their report is lost. */
+	if (atomic_load (&shared->stopSig) != STOP_INTERRUPT)
+		role_wait (&roles[2]);
+	if (commands != -1)
+		role_wait (&roles[3]);	/* Sees the end flag within COMMAND_POLL_TIME. */
+	log_close ();
 
-	massive_cleanup (0, 99, key+6);	/* Final cleanup of all ressources. */
+	massive_cleanup (0, 99);	/* Final cleanup of all ressources. */
 
 	// return 0;
 }
 
+/**
+ * Print the statistics of the simulation and, if asked, export them.
+ */
+void main_report () {
+	simuStats.controller = controller_name (controllerPolicy);
+	stats_report (&simuStats);
+	if (statsFile && stats_export (&simuStats, statsFile) == -1)
+		perror ("Error exporting statistics");
+}
+
 /**
  * Destroy all semaphores, mutex or shared variables created
  * during program's execution.
  * Cleanup... because we don't want to catch the virus  !
+ * The shared memory is private: the system destroys it with the last
+ * process of the instance.
  *  
  * @param returnFalg the return value to end the program
- * @param nbDel the number of variable to be destroy
- * @param lastKey the key which refer to the last variable created with success
- * 				  (especially used to desallocate shared memory)
+ * @param nbDel 0 if the semaphores are not allocated yet, else they are destroyed
  */
-void massive_cleanup (int returnFlag, int nbDel, key_t lastKey) {
-	if (nbDel > 0) {
-		switch (nbDel) {
-			case 1:
-				semfree (lane[0]);
-				break;
-			case 2:
-				semfree (lane[0]);
-				semfree (lane[1]);
-				break;
-			case 3:
-				semfree (lane[0]);
-				semfree (lane[1]);
-				semfree (canAccess);
-				break;
-			case 4:
-				semfree (lane[0]);
-				semfree (lane[1]);
-				semfree (canAccess);
-				semfree (mutex[0]);
-				break;
-			case 5:
-				semfree (lane[0]);
-				semfree (lane[1]);
-				semfree (canAccess);
-				semfree (mutex[0]);
-				semfree (mutex[1]);
-				break;
-			case 6:
-				semfree (lane[0]);
-				semfree (lane[1]);
-				semfree (canAccess);
-				semfree (mutex[0]);
-				semfree (mutex[1]);
-				semfree (mutex[2]);
-				break;
-			default:
-				semfree (lane[0]);
-				semfree (lane[1]);
-				semfree (canAccess);
-				semfree (mutex[0]);
-				semfree (mutex[1]);
-				semfree (mutex[2]);
-				shmfree (lastKey);
-		}
-	}
+void massive_cleanup (int returnFlag, int nbDel) {
+	ipcunregister ();	/* Before the ids can be given to another instance. */
+	if (nbDel > 0)
+		semsetfree (&sems);	/* All the semaphores at once. */
 	if (returnFlag)
 		exit (returnFlag);
 }
\ No newline at end of file
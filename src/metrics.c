@@ -0,0 +1,88 @@
+/**
+ *
+ * @file metrics.c
+ * Live metrics of a running simulation.
+ *
+ * Implementation of functions defined in @see metrics.h
+ *
+ * @version 1.0
+ *
+ * ********************************************************* */
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "../inc/param.h"
+#include "../inc/metrics.h"
+
+/**
+ * Give the monotonic date in microseconds, the same in every process.
+ *
+ * @return the date
+ */
+long metrics_now () {
+	struct timespec now;
+	clock_gettime (CLOCK_MONOTONIC, &now);
+	return now.tv_sec*1000000 + now.tv_nsec/1000;
+}
+
+/**
+ * Create the block of the simulation and record it in the registry of
+ * the instance, which must already exist.
+ *
+ * The segment is marked for destruction once attached, as the shared
+ * variables: the system removes it with the last process attached, the
+ * monitors included. Until then, its id still attaches it.
+ *
+ * @param nbCars the number of cars to be generated
+ *
+ * @return 0 if success, -1 otherwise
+ */
+int metrics_open (long nbCars) {
+	int shmid;
+
+	if ((shmid = shmget (IPC_PRIVATE, sizeof (Metrics), IPC_CREAT|0600)) == -1)
+		return -1;
+	metrics = shmat (shmid, 0, 0);
+	shmctl (shmid, IPC_RMID, 0);
+	if (metrics == (void *) -1) {
+		metrics = 0;
+		return -1;
+	}
+	memset (metrics, 0, sizeof (Metrics));
+	metrics->version = METRICS_VERSION;
+	metrics->size = sizeof (Metrics);
+	metrics->pid = getpid ();
+	metrics->start = metrics->greenStart = metrics_now ();
+	metrics->nbCars = nbCars;
+	metrics->running = 1;
+	/* Readable once complete. */
+	atomic_thread_fence (memory_order_release);
+	metrics->magic = METRICS_MAGIC;
+
+	/* Not fatal: the simulation runs as well without monitor. */
+	ipcpublish (METRICS_REGISTRY_KIND, shmid);
+	return 0;
+}
+
+/**
+ * Attach read-only the block of a running instance.
+ *
+ * @param pid the process id of the instance
+ *
+ * @return the block, 0 if the instance has none or it is not readable
+ */
+Metrics * metrics_attach (int pid) {
+	Metrics * block;
+	int shmid;
+
+	if ((shmid = ipclookup (pid, METRICS_REGISTRY_KIND)) == -1)
+		return 0;
+	if ((block = shmat (shmid, 0, SHM_RDONLY)) == (void *) -1)
+		return 0;
+	if (block->magic != METRICS_MAGIC || block->version != METRICS_VERSION
+			|| block->size != sizeof (Metrics) || block->pid != pid) {
+		shmdt (block);
+		return 0;
+	}
+	return block;
+}
@@ -0,0 +1,310 @@
+/**
+ *
+ * @file network.c
+ * Road network made of several junctions linked by road segments.
+ *
+ * Implementation of functions defined in @see network.h
+ *
+ * @version 1.0
+ *
+ * ********************************************************* */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../inc/network.h"
+
+/**
+ * Make room for the given junction, the new junctions being undeclared.
+ *
+ * @param network the network being loaded
+ * @param junction the number of the junction
+ *
+ * @return 0 if success, -1 otherwise
+ */
+static int network_reserve (Network * network, int junction) {
+	Junction * grown;
+	int i;
+
+	if (junction < network->nbJunctions)
+		return 0;
+	grown = realloc (network->junctions, (junction + 1) * sizeof (Junction));
+	if (!grown)
+		return -1;
+	for (i = network->nbJunctions; i <= junction; i++) {
+		memset (&grown[i], 0, sizeof (Junction));
+		grown[i].next[0] = grown[i].next[1] = -1;
+	}
+	network->junctions = grown;
+	network->nbJunctions = junction + 1;
+	return 0;
+}
+
+/**
+ * Add an entry to the network.
+ *
+ * @param network the network being loaded
+ * @param approach the approach where the cars enter
+ *
+ * @return 0 if success, -1 otherwise
+ */
+static int network_add_entry (Network * network, int approach) {
+	int * grown = realloc (network->entries, (network->nbEntries + 1) * sizeof (int));
+
+	if (!grown)
+		return -1;
+	grown[network->nbEntries++] = approach;
+	network->entries = grown;
+	return 0;
+}
+
+/**
+ * Check that the cars always leave the network: following the roads from
+ * any lane must never come back to it.
+ *
+ * @param network the loaded network
+ *
+ * @return 0 if the network has no loop, -1 otherwise
+ */
+static int network_check_loops (Network * network) {
+	int nbApproaches = 2 * network->nbJunctions;
+	int * visit = calloc (nbApproaches, sizeof (int));
+	int start, approach;
+
+	if (!visit)
+		return -1;
+	/* Each lane leads to one lane at most: walk each path once, tagged by its start. */
+	for (start = 0; start < nbApproaches; start++) {
+		approach = start;
+		while (approach != -1 && !visit[approach]) {
+			visit[approach] = start + 1;
+			approach = network->junctions[NETWORK_JUNCTION (approach)].next[NETWORK_LANE (approach)];
+		}
+		if (approach != -1 && visit[approach] == start + 1) {
+			fprintf (stderr, "Network: the road from junction %d lane %d loops back\n",
+				NETWORK_JUNCTION (approach), NETWORK_LANE (approach)+1);
+			free (visit);
+			return -1;
+		}
+	}
+	free (visit);
+	return 0;
+}
+
+/**
+ * Allocate the queues of the lanes and set the initial state of the lights,
+ * once the topology is known.
+ *
+ * @param network the loaded network
+ *
+ * @return 0 if success, -1 otherwise
+ */
+static int network_start (Network * network) {
+	int i;
+
+	for (i = 0; i < network->nbJunctions; i++) {
+		network->junctions[i].redLight = 1;	/* Same initial state as the junction's manager. */
+		network->junctions[i].nbWaitingCars = 0;
+		network->junctions[i].arrivals[0] = network->junctions[i].arrivals[1] = 0;
+		network->junctions[i].checkedArrivals = 0;
+		if (lq_init (&network->junctions[i].waiting[0]) == -1)
+			break;
+		if (lq_init (&network->junctions[i].waiting[1]) == -1) {
+			lq_free (&network->junctions[i].waiting[0]);
+			break;
+		}
+	}
+	if (i == network->nbJunctions)
+		return 0;
+
+	perror ("Error creating lane queue");
+	while (i-- > 0) {
+		lq_free (&network->junctions[i].waiting[0]);
+		lq_free (&network->junctions[i].waiting[1]);
+	}
+	free (network->junctions);
+	free (network->entries);
+	network->junctions = 0;
+	network->entries = 0;
+	return -1;
+}
+
+/**
+ * Build the network of the original simulation: one junction whose two
+ * lanes are both entries and lead out of the network.
+ *
+ * @param network the network to initialize
+ * @param timeSwitchWay the duration of a green light
+ *
+ * @return 0 if success, -1 otherwise
+ */
+int network_single (Network * network, int timeSwitchWay) {
+	network->junctions = 0;
+	network->nbJunctions = 0;
+	network->entries = 0;
+	network->nbEntries = 0;
+
+	if (network_reserve (network, 0) == -1
+			|| network_add_entry (network, NETWORK_APPROACH (0, 0)) == -1
+			|| network_add_entry (network, NETWORK_APPROACH (0, 1)) == -1) {
+		perror ("Error creating network");
+		free (network->junctions);
+		free (network->entries);
+		return -1;
+	}
+	network->junctions[0].greenTime = timeSwitchWay;
+	network->junctions[0].declared = 1;
+	return network_start (network);
+}
+
+/**
+ * Load a network from a topology file (@see network.h).
+ * The errors are reported on the error output with their line.
+ *
+ * @param network the network to initialize
+ * @param path the path of the topology file
+ * @param timeSwitchWay the duration of a green light when not given by the file
+ *
+ * @return 0 if success, -1 otherwise
+ */
+int network_load (Network * network, char * path, int timeSwitchWay) {
+	char line[NETWORK_LINE_SIZE], word[16], * comment;
+	int from, fromLane, to, toLane, nbLines = 0, nbFields, i;
+	long green, offset, travel;
+	Junction * junction;
+	FILE * file;
+
+	network->junctions = 0;
+	network->nbJunctions = 0;
+	network->entries = 0;
+	network->nbEntries = 0;
+
+	if (!(file = fopen (path, "r"))) {
+		perror ("Error opening network file");
+		return -1;
+	}
+
+	while (fgets (line, sizeof (line), file)) {
+		nbLines++;
+		if ((comment = strchr (line, '#')))
+			*comment = '\0';
+		if (sscanf (line, "%15s", word) != 1)
+			continue;	/* Blank line. */
+
+		if (strcmp (word, "junction") == 0) {
+			green = timeSwitchWay;
+			offset = 0;
+			nbFields = sscanf (line, "%*s %d %ld %ld", &from, &green, &offset);
+			if (nbFields < 1 || from < 0 || green <= 0 || offset < 0)
+				goto syntax;
+			if (network_reserve (network, from) == -1)
+				goto memory;
+			junction = &network->junctions[from];
+			if (junction->declared) {
+				fprintf (stderr, "%s:%d: junction %d declared twice\n", path, nbLines, from);
+				goto error;
+			}
+			junction->greenTime = green;
+			junction->offset = offset;
+			junction->declared = 1;
+
+		} else if (strcmp (word, "road") == 0) {
+			if (sscanf (line, "%*s %d %d %d %d %ld", &from, &fromLane, &to, &toLane, &travel) != 5
+					|| from < 0 || to < 0 || travel < 0
+					|| fromLane < 1 || fromLane > 2 || toLane < 1 || toLane > 2)
+				goto syntax;
+			if (network_reserve (network, from > to ? from : to) == -1)
+				goto memory;
+			junction = &network->junctions[from];
+			if (junction->next[fromLane-1] != -1) {
+				fprintf (stderr, "%s:%d: lane %d of junction %d already has a road\n",
+					path, nbLines, fromLane, from);
+				goto error;
+			}
+			junction->next[fromLane-1] = NETWORK_APPROACH (to, toLane-1);
+			junction->travelTime[fromLane-1] = travel;
+
+		} else if (strcmp (word, "entry") == 0) {
+			if (sscanf (line, "%*s %d %d", &to, &toLane) != 2
+					|| to < 0 || toLane < 1 || toLane > 2)
+				goto syntax;
+			if (network_reserve (network, to) == -1
+					|| network_add_entry (network, NETWORK_APPROACH (to, toLane-1)) == -1)
+				goto memory;
+
+		} else {
+			goto syntax;
+		}
+	}
+	fclose (file);
+	file = 0;
+
+	/* Every junction referred to must be declared. */
+	if (network->nbJunctions == 0) {
+		fprintf (stderr, "%s: no junction declared\n", path);
+		goto error;
+	}
+	for (i = 0; i < network->nbJunctions; i++) {
+		if (!network->junctions[i].declared) {
+			fprintf (stderr, "%s: junction %d used but not declared\n", path, i);
+			goto error;
+		}
+	}
+	if (network_check_loops (network) == -1)
+		goto error;
+
+	/* No entry given: the cars enter wherever no road leads. */
+	if (network->nbEntries == 0) {
+		int * reached = calloc (2 * network->nbJunctions, sizeof (int));
+
+		if (!reached)
+			goto memory;
+		for (i = 0; i < network->nbJunctions; i++) {
+			if (network->junctions[i].next[0] != -1)
+				reached[network->junctions[i].next[0]] = 1;
+			if (network->junctions[i].next[1] != -1)
+				reached[network->junctions[i].next[1]] = 1;
+		}
+		for (i = 0; i < 2 * network->nbJunctions; i++) {
+			if (!reached[i] && network_add_entry (network, i) == -1) {
+				free (reached);
+				goto memory;
+			}
+		}
+		free (reached);
+	}
+
+	return network_start (network);
+
+syntax:
+	fprintf (stderr, "%s:%d: invalid declaration, see the manual (option -m)\n", path, nbLines);
+	goto error;
+memory:
+	perror ("Error creating network");
+error:
+	if (file)
+		fclose (file);
+	free (network->junctions);
+	free (network->entries);
+	network->junctions = 0;
+	network->entries = 0;
+	return -1;
+}
+
+/**
+ * Release the storage of a network.
+ *
+ * @param network the network to destroy
+ */
+void network_free (Network * network) {
+	int i;
+
+	for (i = 0; i < network->nbJunctions; i++) {
+		lq_free (&network->junctions[i].waiting[0]);
+		lq_free (&network->junctions[i].waiting[1]);
+	}
+	free (network->junctions);
+	free (network->entries);
+	network->junctions = 0;
+	network->entries = 0;
+	network->nbJunctions = network->nbEntries = 0;
+}
@@ -0,0 +1,243 @@
+/**
+ *
+ * @file pool.c
+ * Fixed pool of worker threads running timestamped tasks.
+ *
+ * Implementation of functions defined in @see pool.h
+ *
+ * @version 1.0
+ *
+ * ********************************************************* */
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include "../inc/pool.h"
+
+/**
+ * Read the monotonic clock used to date the tasks.
+ *
+ * @return the current date in microseconds
+ */
+long pool_now () {
+	struct timespec now;
+	clock_gettime (CLOCK_MONOTONIC, &now);
+	return now.tv_sec*1000000 + now.tv_nsec/1000;
+}
+
+/**
+ * Sleep until a date of the monotonic clock, whatever the time spent
+ * before: a sequence of such sleeps does not drift.
+ *
+ * @param date the monotonic date of the wake up (@see pool_now)
+ */
+void pool_sleep_until (long date) {
+	struct timespec until;
+
+	until.tv_sec = date / 1000000;
+	until.tv_nsec = date % 1000000 * 1000;
+	while (clock_nanosleep (CLOCK_MONOTONIC, TIMER_ABSTIME, &until, 0) == EINTR);
+}
+
+/**
+ * Main loop of a worker: wait for a due task and run it.
+ *
+ * @param arg the pool
+ */
+static void * pool_worker (void * arg) {
+	Pool * pool = (Pool *) arg;
+	Event task;
+
+	pthread_mutex_lock (&pool->mut);
+	while (1) {
+		if (evq_pop (&pool->tasks, &task)) {
+			pthread_mutex_unlock (&pool->mut);
+			pool->handler (&task);
+			pthread_mutex_lock (&pool->mut);
+			continue;
+		}
+		if (pool->stop && pool->timers.size == 0)
+			break;
+		pthread_cond_wait (&pool->cond, &pool->mut);
+	}
+	pthread_mutex_unlock (&pool->mut);
+
+	return 0;
+}
+
+/**
+ * Main loop of the timer: hand the due tasks to the workers, then sleep
+ * until the next timer or a sooner one comes. It leaves once the workers
+ * are gone: until then, they may still set timers.
+ *
+ * @param arg the pool
+ */
+static void * pool_timer (void * arg) {
+	Pool * pool = (Pool *) arg;
+	struct timespec deadline;
+	Event task;
+	long now, date;
+	int nbDue;
+
+	pthread_mutex_lock (&pool->mut);
+	while (pool->stop != POOL_STOP_TIMER) {
+		now = pool_now ();
+		for (nbDue = 0; wheel_expire (&pool->timers, now, &task); nbDue++)
+			if (evq_push (&pool->tasks, task.time, task.type, &task.car, task.lane) == -1)
+				perror ("Error queuing task");
+		if (nbDue == 1)
+			pthread_cond_signal (&pool->cond);
+		else if (nbDue > 1)
+			pthread_cond_broadcast (&pool->cond);
+
+		if (!wheel_next (&pool->timers, &date)) {
+			/* Nothing pending: the workers may leave. */
+			if (pool->stop)
+				pthread_cond_broadcast (&pool->cond);
+			pthread_cond_wait (&pool->tick, &pool->mut);
+		} else if (date > now) {
+			deadline.tv_sec = date / 1000000;
+			deadline.tv_nsec = (date % 1000000) * 1000;
+			pthread_cond_timedwait (&pool->tick, &pool->mut, &deadline);
+		}
+	}
+	pthread_mutex_unlock (&pool->mut);
+
+	return 0;
+}
+
+/**
+ * Start a pool of worker threads, and its timer thread.
+ * The threads are started with all signals blocked.
+ *
+ * @param pool the pool to initialize
+ * @param nbWorkers the number of workers, or 0 for one per online core
+ * @param handler the function running the due tasks
+ *
+ * @return 0 if success, -1 otherwise
+ */
+int pool_init (Pool * pool, int nbWorkers, TaskHandler handler) {
+	pthread_condattr_t attr;
+	sigset_t all, previous;
+	int error;
+
+	if (nbWorkers <= 0)
+		nbWorkers = (int) sysconf (_SC_NPROCESSORS_ONLN);
+	if (nbWorkers <= 0)
+		nbWorkers = 1;
+
+	if (evq_init (&pool->tasks, DEFAULT_EVENT_CAPACITY) == -1)
+		return -1;
+	if (wheel_init (&pool->timers, pool_now (), DEFAULT_WHEEL_CAPACITY) == -1) {
+		evq_free (&pool->tasks);
+		return -1;
+	}
+	pool->workers = malloc (nbWorkers * sizeof (pthread_t));
+	if (!pool->workers) {
+		wheel_free (&pool->timers);
+		evq_free (&pool->tasks);
+		return -1;
+	}
+	pool->nbWorkers = 0;
+	pool->handler = handler;
+	pool->stop = 0;
+
+	/* The dates are read on the monotonic clock, so must be the timeouts. */
+	pthread_mutex_init (&pool->mut, 0);
+	pthread_cond_init (&pool->cond, 0);
+	pthread_condattr_init (&attr);
+	pthread_condattr_setclock (&attr, CLOCK_MONOTONIC);
+	pthread_cond_init (&pool->tick, &attr);
+	pthread_condattr_destroy (&attr);
+
+	/* Signals are left to the calling thread: the threads inherit a full mask. */
+	sigfillset (&all);
+	pthread_sigmask (SIG_SETMASK, &all, &previous);
+	error = pthread_create (&pool->timer, 0, pool_timer, pool);
+	while (!error && pool->nbWorkers < nbWorkers) {
+		if (pthread_create (&pool->workers[pool->nbWorkers], 0, pool_worker, pool) != 0)
+			break;
+		pool->nbWorkers++;
+	}
+	pthread_sigmask (SIG_SETMASK, &previous, 0);
+
+	if (error) {
+		free (pool->workers);
+		wheel_free (&pool->timers);
+		evq_free (&pool->tasks);
+		pthread_mutex_destroy (&pool->mut);
+		pthread_cond_destroy (&pool->cond);
+		pthread_cond_destroy (&pool->tick);
+		return -1;
+	}
+	if (pool->nbWorkers == 0) {
+		pool_destroy (pool);
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * Queue a task: a due one goes straight to the workers, the others to
+ * the wheel.
+ *
+ * @param pool the pool of workers
+ * @param date the monotonic date from which the task can run (@see pool_now)
+ * @param type the kind of task
+ * @param car the car concerned by the task (0: none)
+ * @param lane the lane concerned by the task
+ *
+ * @return 0 if success, -1 otherwise
+ */
+int pool_submit (Pool * pool, long date, EventType type, Car * car, int lane) {
+	int error, sooner;
+	long next;
+
+	pthread_mutex_lock (&pool->mut);
+	if (date <= pool_now ()) {
+		if (!(error = evq_push (&pool->tasks, date, type, car, lane)))
+			pthread_cond_signal (&pool->cond);
+	} else {
+		sooner = !wheel_next (&pool->timers, &next) || date < next;
+		error = wheel_insert (&pool->timers, date, type, car, lane);
+		/* Wake the timer only if it changes what it waits for. */
+		if (!error && sooner)
+			pthread_cond_signal (&pool->tick);
+	}
+	pthread_mutex_unlock (&pool->mut);
+
+	return error;
+}
+
+/**
+ * Stop the workers once the pending tasks are done, then the timer, and
+ * release the pool's resources.
+ *
+ * @param pool the pool to destroy
+ */
+void pool_destroy (Pool * pool) {
+	int i;
+
+	pthread_mutex_lock (&pool->mut);
+	pool->stop = 1;
+	pthread_cond_broadcast (&pool->cond);
+	pthread_mutex_unlock (&pool->mut);
+
+	for (i = 0; i < pool->nbWorkers; i++)
+		pthread_join (pool->workers[i], 0);
+
+	pthread_mutex_lock (&pool->mut);
+	pool->stop = POOL_STOP_TIMER;
+	pthread_cond_signal (&pool->tick);
+	pthread_mutex_unlock (&pool->mut);
+	pthread_join (pool->timer, 0);
+
+	free (pool->workers);
+	wheel_free (&pool->timers);
+	evq_free (&pool->tasks);
+	pthread_mutex_destroy (&pool->mut);
+	pthread_cond_destroy (&pool->cond);
+	pthread_cond_destroy (&pool->tick);
+}
@@ -0,0 +1,147 @@
+/**
+ *
+ * @file record.c
+ * Recording of the inputs and decisions of a simulation.
+ *
+ * Implementation of functions defined in @see record.h
+ *
+ * The file is opened in append mode before the roles start: each process
+ * writes whole batches of entries at the end of the file. The entries of
+ * a process are in its order of logging; those of the other processes
+ * come between its batches.
+ *
+ * @version 1.0
+ *
+ * ********************************************************* */
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "../inc/record.h"
+
+/**
+ * The recording (-1: none).
+ */
+static int recordFd = -1;
+
+/**
+ * Write a buffer to the recording.
+ */
+static void record_append (char * buffer, size_t length) {
+	ssize_t written;
+
+	while (length > 0 && (written = write (recordFd, buffer, length)) > 0) {
+		buffer += written;
+		length -= written;
+	}
+}
+
+/**
+ * Create the recording and write the settings of the run. Called before
+ * the roles start: the forked processes write into the same file.
+ *
+ * @param path the name of the file
+ * @param controller the name of the controller of the lights
+ * @param seed the seed of the draws
+ * @param cars the number of cars
+ * @param green the duration of a green light in microseconds
+ * @param flow the saturation flow in cars per hour
+ *
+ * @return 0 if success, -1 otherwise
+ */
+int record_open (char * path, char * controller, unsigned long seed, int cars, int green,
+		int flow) {
+	RecordHeader header;
+
+	if ((recordFd = open (path, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644)) == -1)
+		return -1;
+	memset (&header, 0, sizeof (RecordHeader));	/* No stray byte in the file. */
+	memcpy (header.magic, RECORD_MAGIC, RECORD_MAGIC_SIZE);
+	strncpy (header.controller, controller, sizeof (header.controller) - 1);
+	header.seed = seed;
+	header.cars = cars;
+	header.green = green;
+	header.flow = flow;
+	record_append ((char *) &header, sizeof (RecordHeader));
+	return 0;
+}
+
+/**
+ * Tell whether a recording is written.
+ *
+ * @return 1 if the recording is open, 0 otherwise
+ */
+int record_active () {
+	return recordFd != -1;
+}
+
+/**
+ * Tell the kind of entry of a kind of record of the log.
+ *
+ * @param type the kind of record
+ *
+ * @return the kind of entry, -1 if the record is neither an input nor a decision
+ */
+int record_type (int type) {
+	switch (type) {
+		case LOG_CAR_ARRIVAL:
+			return RECORD_ARRIVAL;
+		case LOG_LANE_COMMAND:
+			return RECORD_LANE;
+		case LOG_LIGHT_GREEN:
+			return RECORD_GREEN;
+		default:
+			return -1;
+	}
+}
+
+/**
+ * Turn a record of the log into an entry (by the writer only).
+ *
+ * @param record the record of the log
+ * @param entry the entry receiving it
+ *
+ * @return 1 if the record is an input or a decision, 0 otherwise
+ */
+int record_entry (LogRecord * record, RecordEntry * entry) {
+	if ((entry->type = record_type (record->type)) == -1)
+		return 0;
+	entry->date = record->stamp;
+	entry->lane = record->lane;
+	return 1;
+}
+
+/**
+ * Append entries to the recording.
+ *
+ * @param entries the entries
+ * @param count the number of entries
+ */
+void record_write (RecordEntry * entries, int count) {
+	record_append ((char *) entries, count * sizeof (RecordEntry));
+}
+
+/**
+ * Append the count of the entries dropped by the log of the process,
+ * once its writer has stopped.
+ *
+ * @param count the number of entries dropped
+ */
+void record_lost (long count) {
+	RecordEntry entry;
+
+	memset (&entry, 0, sizeof (RecordEntry));
+	entry.date = count;
+	entry.type = RECORD_LOST;
+	entry.lane = -1;
+	record_append ((char *) &entry, sizeof (RecordEntry));
+}
+
+/**
+ * Close the recording.
+ */
+void record_close () {
+	if (recordFd != -1)
+		close (recordFd);
+	recordFd = -1;
+}
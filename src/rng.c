@@ -0,0 +1,83 @@
+/**
+ *
+ * @file rng.c
+ * Seeded streams of random numbers.
+ *
+ * Implementation of functions defined in @see rng.h
+ *
+ * @version 1.0
+ *
+ * ********************************************************* */
+#include "../inc/rng.h"
+
+/**
+ * Rotate the bits of a number to the left.
+ */
+static inline uint64_t rng_rotl (uint64_t x, int k) {
+	return (x << k) | (x >> (64 - k));
+}
+
+/**
+ * Draw the next number of a splitmix64 sequence, used to spread a seed
+ * over the state of a stream.
+ */
+static uint64_t rng_splitmix (uint64_t * x) {
+	uint64_t z = (*x += 0x9e3779b97f4a7c15);
+
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+	return z ^ (z >> 31);
+}
+
+/**
+ * Start a stream.
+ *
+ * The seed and the stream are mixed first, so that close seeds and close
+ * streams still give unrelated states.
+ *
+ * @param rng the stream to start
+ * @param seed the seed of the simulation
+ * @param stream the number of the stream
+ */
+void rng_seed (Rng * rng, uint64_t seed, uint64_t stream) {
+	uint64_t x = seed;
+	int i;
+
+	x = rng_splitmix (&x) ^ stream;
+	for (i = 0; i < 4; i++)
+		rng->s[i] = rng_splitmix (&x);
+}
+
+/**
+ * Draw the next number of a stream (xoshiro256**).
+ *
+ * @param rng the stream
+ *
+ * @return a number uniformly drawn among the 64 bits values
+ */
+uint64_t rng_next (Rng * rng) {
+	uint64_t * s = rng->s;
+	uint64_t result = rng_rotl (s[1] * 5, 7) * 9;
+	uint64_t t = s[1] << 17;
+
+	s[2] ^= s[0];
+	s[3] ^= s[1];
+	s[1] ^= s[2];
+	s[0] ^= s[3];
+	s[2] ^= t;
+	s[3] = rng_rotl (s[3], 45);
+	return result;
+}
+
+/**
+ * Draw a number below a bound, by scaling instead of a modulo: the top
+ * bits of the draw are the best ones.
+ *
+ * @param rng the stream
+ * @param bound the bound, greater than 0
+ *
+ * @return a number from 0 to bound-1
+ */
+long rng_below (Rng * rng, long bound) {
+	return (long) (((unsigned __int128) rng_next (rng) * (uint64_t) bound) >> 64);
+}
@@ -0,0 +1,102 @@
+/**
+ *
+ * @file roles.c
+ * Roles of a real time simulation, run as processes or as threads.
+ *
+ * Implementation of functions defined in @see roles.h
+ *
+ * @version 1.0
+ *
+ * ********************************************************* */
+#include <stdlib.h>
+#include <signal.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "../inc/roles.h"
+
+/**
+ * Names of the ways, in the order of their numbers.
+ */
+static char * rolesNames[] = {"process", "thread"};
+
+/**
+ * Run the function of a role in its thread, keeping its result.
+ */
+static void * role_thread (void * arg) {
+	Role * role = arg;
+
+	role->status = role->run (role->arg);
+	return 0;
+}
+
+/**
+ * Give the name of a way of running the roles.
+ *
+ * @param mode the way (@see ROLES_PROCESS)
+ *
+ * @return the name
+ */
+char * roles_name (int mode) {
+	return rolesNames[mode];
+}
+
+/**
+ * Start a role. In a process, the role exits with the result of its
+ * function; the standard output must be flushed before.
+ *
+ * @param role the role to start
+ * @param mode the way the role runs (@see ROLES_PROCESS)
+ * @param run the function of the role
+ * @param arg the argument of the function
+ *
+ * @return 0 if success, -1 otherwise
+ */
+int role_start (Role * role, int mode, RoleMain run, void * arg) {
+	sigset_t all, previous;
+	int error;
+
+	role->mode = mode;
+	role->run = run;
+	role->arg = arg;
+	role->status = 0;
+
+	if (mode == ROLES_PROCESS) {
+		switch (role->pid = fork ()) {
+			case -1:
+				return -1;
+			case 0:
+				exit (run (arg));
+		}
+		return 0;
+	}
+
+	/* The interruption is left to the main thread, as to the main process. */
+	sigfillset (&all);
+	pthread_sigmask (SIG_SETMASK, &all, &previous);
+	error = pthread_create (&role->thread, 0, role_thread, role);
+	pthread_sigmask (SIG_SETMASK, &previous, 0);
+	if (error != 0) {
+		errno = error;
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * Wait for the end of a role.
+ *
+ * @param role the started role
+ *
+ * @return the exit status of the role, -1 if it can not be waited for
+ */
+int role_wait (Role * role) {
+	int status;
+
+	if (role->mode == ROLES_THREAD)
+		return pthread_join (role->thread, 0) == 0 ? role->status : -1;
+	while (waitpid (role->pid, &status, 0) == -1)
+		if (errno != EINTR)
+			return -1;
+	return WIFEXITED (status) ? WEXITSTATUS (status) : -1;
+}
@@ -0,0 +1,323 @@
+/**
+ *
+ * @file scenario.c
+ * Scenario files: settings and schedule of the arrivals.
+ *
+ * Implementation of functions defined in @see scenario.h
+ *
+ * @version 1.0
+ *
+ * ********************************************************* */
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "../inc/scenario.h"
+#include "../inc/record.h"
+
+/**
+ * Give the bounds of the next line of a scenario, without its comment,
+ * and move past it. The mapping is not terminated by a null character:
+ * the line is never read beyond the end of the file.
+ *
+ * @return 1 if a line is given, 0 at the end of the file
+ */
+static int scenario_line (Scenario * scenario, char ** begin, char ** end) {
+	char * data = scenario->data + scenario->pos, * last = scenario->data + scenario->size;
+	char * newline, * comment;
+
+	if (scenario->pos >= scenario->size)
+		return 0;
+	newline = memchr (data, '\n', last - data);
+	*begin = data;
+	*end = newline ? newline : last;
+	scenario->pos = (newline ? newline + 1 : last) - scenario->data;
+	scenario->line++;
+	if ((comment = memchr (*begin, '#', *end - *begin)))
+		*end = comment;
+	while (*begin < *end && (**begin == ' ' || **begin == '\t' || **begin == '\r'))
+		(*begin)++;
+	return 1;
+}
+
+/**
+ * Read a positive number in a line.
+ *
+ * @return 0 if success, -1 otherwise
+ */
+static int scenario_number (char ** cursor, char * end, long * value) {
+	char * p = *cursor;
+
+	*value = 0;
+	if (p == end || *p < '0' || *p > '9')
+		return -1;
+	while (p < end && *p >= '0' && *p <= '9') {
+		if (*value > (0x7fffffffffffffffL - 9) / 10)
+			return -1;
+		*value = *value * 10 + (*p++ - '0');
+	}
+	while (p < end && (*p == ' ' || *p == '\t' || *p == '\r'))
+		p++;
+	*cursor = p;
+	return 0;
+}
+
+/**
+ * Give back to the system the pages of the file already read.
+ */
+static void scenario_release (Scenario * scenario) {
+	size_t page = sysconf (_SC_PAGESIZE), upto;
+	size_t read = scenario->phases && scenario->greenPos < scenario->pos
+		? scenario->greenPos : scenario->pos;	/* Up to the slower cursor. */
+
+	if (read < scenario->released + SCENARIO_WINDOW)
+		return;
+	upto = read & ~(page - 1);
+	madvise (scenario->data + scenario->released, upto - scenario->released, MADV_DONTNEED);
+	scenario->released = upto;
+}
+
+/**
+ * Read the settings of a recording, in its header.
+ *
+ * @return 0 if success, -1 otherwise
+ */
+static int scenario_header (Scenario * scenario, ScenarioSetting setting) {
+	RecordHeader header;
+	RecordEntry entry;
+	char cars[16], green[16], flow[16], seed[24];
+	size_t pos;
+	long lost = 0;
+
+	/* The count of the entries dropped by a process comes after its own ones only. */
+	for (pos = sizeof (RecordHeader); pos + sizeof (RecordEntry) <= scenario->size;
+			pos += sizeof (RecordEntry)) {
+		memcpy (&entry, scenario->data + pos, sizeof (RecordEntry));
+		if (entry.type == RECORD_LOST)
+			lost += entry.date;
+	}
+	madvise (scenario->data, scenario->size, MADV_DONTNEED);	/* Read again from the start. */
+	if (lost) {
+		fprintf (stderr, "%s: incomplete recording, %ld entrie(s) dropped by the log\n",
+			scenario->path, lost);
+		return -1;
+	}
+
+	memcpy (&header, scenario->data, sizeof (RecordHeader));
+	header.controller[sizeof (header.controller) - 1] = '\0';
+	snprintf (cars, sizeof (cars), "%d", header.cars);
+	snprintf (green, sizeof (green), "%d", header.green);
+	snprintf (flow, sizeof (flow), "%d", header.flow);
+	snprintf (seed, sizeof (seed), "%lu", header.seed);
+	if (setting ("cars", cars) == -1 || setting ("green", green) == -1
+			|| setting ("flow", flow) == -1 || setting ("controller", header.controller) == -1
+			|| setting ("seed", seed) == -1) {
+		fprintf (stderr, "%s: invalid setting in the recording\n", scenario->path);
+		return -1;
+	}
+	scenario->binary = 1;
+	scenario->phases = 1;	/* Unless a controller is asked for (@see analyze_command_line_args). */
+	scenario->pos = scenario->start = scenario->greenPos = sizeof (RecordHeader);
+	return 0;
+}
+
+/**
+ * Read the next arrival of a recording.
+ *
+ * @return 1 if an arrival is read, 0 at the end of the recording, -1 if invalid
+ */
+static int scenario_entry (Scenario * scenario, long * date, int * lane) {
+	RecordEntry entry;
+
+	/* An entry cut short by the end of a run is ignored. */
+	while (scenario->pos + sizeof (RecordEntry) <= scenario->size) {
+		memcpy (&entry, scenario->data + scenario->pos, sizeof (RecordEntry));
+		scenario->pos += sizeof (RecordEntry);
+		if (entry.type != RECORD_ARRIVAL)
+			continue;
+		if (entry.date < 0 || entry.lane < 0) {
+			fprintf (stderr, "%s: invalid arrival at offset %zu\n", scenario->path,
+				scenario->pos - sizeof (RecordEntry));
+			return -1;
+		}
+		/* The cars are stamped as they log their arrival: one logged just after another
+		   one may be stamped a little before it. */
+		*date = entry.date > scenario->lastDate ? entry.date : scenario->lastDate;
+		scenario->lastDate = *date;
+		*lane = entry.lane;
+		scenario_release (scenario);
+		return 1;
+	}
+	return 0;
+}
+
+/**
+ * Open a scenario and read its settings, up to the first arrival.
+ * The errors are reported on the error output with their line.
+ *
+ * @param scenario the scenario to open
+ * @param path the path of the file
+ * @param setting the function receiving each setting
+ *
+ * @return 0 if success, -1 otherwise
+ */
+int scenario_open (Scenario * scenario, char * path, ScenarioSetting setting) {
+	char line[256], name[SCENARIO_NAME_SIZE], value[64], * begin, * end;
+	struct stat status;
+	size_t length;
+	int fd;
+
+	memset (scenario, 0, sizeof (Scenario));
+	scenario->path = path;
+	if ((fd = open (path, O_RDONLY)) == -1 || fstat (fd, &status) == -1) {
+		perror ("Error opening scenario file");
+		if (fd != -1)
+			close (fd);
+		return -1;
+	}
+	scenario->size = status.st_size;
+	if (scenario->size > 0) {
+		scenario->data = mmap (0, scenario->size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (scenario->data == MAP_FAILED) {
+			perror ("Error opening scenario file");
+			close (fd);
+			scenario->data = 0;
+			return -1;
+		}
+		madvise (scenario->data, scenario->size, MADV_SEQUENTIAL);
+	}
+	close (fd);	/* The mapping keeps the file. */
+
+	if (scenario->size >= sizeof (RecordHeader)
+			&& memcmp (scenario->data, RECORD_MAGIC, RECORD_MAGIC_SIZE) == 0) {
+		if (scenario_header (scenario, setting) == -1) {
+			scenario_close (scenario);
+			return -1;
+		}
+		return 0;
+	}
+
+	/* The settings, until the first line starting with a date. */
+	while (1) {
+		scenario->start = scenario->pos;
+		if (!scenario_line (scenario, &begin, &end))
+			break;
+		if (begin == end)
+			continue;	/* Blank line. */
+		if (*begin >= '0' && *begin <= '9') {
+			scenario->pos = scenario->start;
+			scenario->line--;
+			break;
+		}
+		length = end - begin < (long) sizeof (line) ? end - begin : sizeof (line) - 1;
+		memcpy (line, begin, length);
+		line[length] = '\0';
+		if (sscanf (line, "%15s %63s", name, value) != 2 || setting (name, value) == -1) {
+			fprintf (stderr, "%s:%ld: invalid setting, see the manual (option -m)\n",
+				path, scenario->line);
+			scenario_close (scenario);
+			return -1;
+		}
+	}
+	scenario->startLine = scenario->line;
+	return 0;
+}
+
+/**
+ * Read the next arrival of a scenario.
+ * The errors are reported on the error output with their line.
+ *
+ * @param scenario the scenario
+ * @param date the date of the arrival in microseconds
+ * @param lane the lane of the arrival, from 0
+ *
+ * @return 1 if an arrival is read, 0 at the end of the schedule, -1 if invalid
+ */
+int scenario_next (Scenario * scenario, long * date, int * lane) {
+	char * begin, * end;
+	long number;
+
+	if (scenario->binary)
+		return scenario_entry (scenario, date, lane);
+	while (scenario_line (scenario, &begin, &end)) {
+		if (begin == end)
+			continue;	/* Blank line. */
+		if (scenario_number (&begin, end, date) == -1 || scenario_number (&begin, end, &number) == -1
+				|| begin != end || number < 1 || number > 0x7fffffff) {
+			fprintf (stderr, "%s:%ld: invalid arrival, see the manual (option -m)\n",
+				scenario->path, scenario->line);
+			return -1;
+		}
+		if (*date < scenario->lastDate) {
+			fprintf (stderr, "%s:%ld: arrival before the previous one\n",
+				scenario->path, scenario->line);
+			return -1;
+		}
+		scenario->lastDate = *date;
+		*lane = number - 1;
+		scenario_release (scenario);
+		return 1;
+	}
+	return 0;
+}
+
+/**
+ * Read the next light going green of a recording, for its lights to
+ * switch as recorded.
+ * The errors are reported on the error output with their offset.
+ *
+ * @param scenario the scenario, a recording
+ * @param date the date of the switch in microseconds
+ * @param lane the lane going green, from 0
+ *
+ * @return 1 if a switch is read, 0 at the end of the recording, -1 if invalid
+ */
+int scenario_green (Scenario * scenario, long * date, int * lane) {
+	RecordEntry entry;
+
+	while (scenario->greenPos + sizeof (RecordEntry) <= scenario->size) {
+		memcpy (&entry, scenario->data + scenario->greenPos, sizeof (RecordEntry));
+		scenario->greenPos += sizeof (RecordEntry);
+		if (entry.type != RECORD_GREEN)
+			continue;
+		if (entry.date < 0 || entry.lane < 0 || entry.lane > 1) {
+			fprintf (stderr, "%s: invalid switch at offset %zu\n", scenario->path,
+				scenario->greenPos - sizeof (RecordEntry));
+			return -1;
+		}
+		*date = entry.date > scenario->lastGreen ? entry.date : scenario->lastGreen;
+		scenario->lastGreen = *date;
+		*lane = entry.lane;
+		scenario_release (scenario);
+		return 1;
+	}
+	return 0;
+}
+
+/**
+ * Go back to the first arrival of a scenario.
+ *
+ * @param scenario the scenario
+ */
+void scenario_rewind (Scenario * scenario) {
+	scenario->pos = scenario->start;
+	scenario->line = scenario->startLine;
+	scenario->lastDate = 0;
+	scenario->greenPos = scenario->start;
+	scenario->lastGreen = 0;
+	scenario->released = 0;	/* The pages given back are read again from the file. */
+}
+
+/**
+ * Unmap a scenario.
+ *
+ * @param scenario the scenario
+ */
+void scenario_close (Scenario * scenario) {
+	if (scenario->data)
+		munmap (scenario->data, scenario->size);
+	scenario->data = 0;
+	scenario->size = 0;
+}
@@ -0,0 +1,331 @@
+/**
+ *
+ * @file stats.c
+ * Wait times of the cars and end of run statistics.
+ *
+ * Implementation of functions defined in @see stats.h
+ *
+ * @version 1.0
+ *
+ * ********************************************************* */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../inc/stats.h"
+
+/**
+ * Give the bucket of a value.
+ *
+ * Below 2^HIST_SUB_BITS, each value has its own bucket. Beyond, a value is
+ * shifted right until it keeps HIST_SUB_BITS significant bits: the shift
+ * chooses the group of buckets, the remaining bits the bucket in the group.
+ */
+static int hist_bucket (long value) {
+	int shift;
+
+	if (value < (1L << HIST_SUB_BITS))
+		return value;
+	shift = (63 - __builtin_clzl (value)) - HIST_SUB_BITS + 1;
+	return shift * HIST_HALF_BUCKETS + (value >> shift);
+}
+
+/**
+ * Give the largest value counted in a bucket.
+ */
+static long hist_bucket_top (int bucket) {
+	int shift;
+
+	if (bucket < (1 << HIST_SUB_BITS))
+		return bucket;
+	shift = bucket / HIST_HALF_BUCKETS - 1;
+	return ((long) (bucket - shift * HIST_HALF_BUCKETS + 1) << shift) - 1;
+}
+
+/**
+ * Empty a histogram.
+ */
+static void hist_reset (Histogram * hist) {
+	int i;
+
+	for (i = 0; i < HIST_NB_BUCKETS; i++)
+		atomic_init (&hist->counts[i], 0);
+	atomic_init (&hist->total, 0);
+	atomic_init (&hist->sum, 0);
+	atomic_init (&hist->max, 0);
+}
+
+/**
+ * Add the values of a histogram to another one.
+ */
+static void hist_merge (Histogram * to, Histogram * from) {
+	int i;
+
+	for (i = 0; i < HIST_NB_BUCKETS; i++)
+		atomic_fetch_add (&to->counts[i], atomic_load (&from->counts[i]));
+	atomic_fetch_add (&to->total, atomic_load (&from->total));
+	atomic_fetch_add (&to->sum, atomic_load (&from->sum));
+	if (atomic_load (&from->max) > atomic_load (&to->max))
+		atomic_store (&to->max, atomic_load (&from->max));
+}
+
+/**
+ * Give the mean of the values of a histogram.
+ */
+static double hist_mean (Histogram * hist) {
+	long total = atomic_load (&hist->total);
+
+	return total ? (double) atomic_load (&hist->sum) / total : 0;
+}
+
+/**
+ * Record a value in a histogram (lock-free).
+ *
+ * @param hist the histogram
+ * @param value the value, negative values being counted as 0
+ */
+void hist_record (Histogram * hist, long value) {
+	long max;
+
+	if (value < 0)
+		value = 0;
+	atomic_fetch_add_explicit (&hist->counts[hist_bucket (value)], 1, memory_order_relaxed);
+	atomic_fetch_add_explicit (&hist->total, 1, memory_order_relaxed);
+	atomic_fetch_add_explicit (&hist->sum, value, memory_order_relaxed);
+	max = atomic_load_explicit (&hist->max, memory_order_relaxed);
+	while (value > max && !atomic_compare_exchange_weak_explicit (&hist->max, &max, value,
+			memory_order_relaxed, memory_order_relaxed));
+}
+
+/**
+ * Give the value below which the given percentage of the values fall.
+ *
+ * @param hist the histogram
+ * @param percent the percentage, from 0 to 100
+ *
+ * @return the value, rounded up to its bucket but never above the maximum
+ */
+long hist_percentile (Histogram * hist, double percent) {
+	long total = atomic_load (&hist->total), max = atomic_load (&hist->max);
+	long rank, count = 0;
+	int i;
+
+	if (total == 0)
+		return 0;
+	rank = (long) (percent / 100 * total + 0.999999);
+	if (rank < 1)
+		rank = 1;
+	for (i = 0; i < HIST_NB_BUCKETS; i++) {
+		count += atomic_load (&hist->counts[i]);
+		if (count >= rank)
+			return hist_bucket_top (i) < max ? hist_bucket_top (i) : max;
+	}
+	return max;
+}
+
+/**
+ * Prepare the statistics of a simulation. Their storage is fixed,
+ * whatever the number of cars.
+ *
+ * @param stats the statistics to initialize
+ * @param nbCars the number of cars of the simulation
+ */
+void stats_init (Stats * stats, long nbCars) {
+	hist_reset (&stats->waits[0]);
+	hist_reset (&stats->waits[1]);
+	hist_reset (&stats->notices);
+	atomic_init (&stats->peakQueue, 0);
+	stats->nbCars = nbCars;
+	stats->duration = 0;
+	stats->controller = 0;
+	stats->phases = 0;
+}
+
+/**
+ * Record the passage of a car: its wait since its arrival, carried by
+ * the car (@see Car), goes to the histogram of its lane.
+ *
+ * @param stats the statistics of the simulation
+ * @param lane the lane of the car
+ * @param arrival the date of the arrival of the car in microseconds
+ * @param date the date of the passage in microseconds
+ */
+void stats_passage (Stats * stats, int lane, long arrival, long date) {
+	hist_record (&stats->waits[lane], date - arrival);
+}
+
+/**
+ * Record the number of cars currently waiting.
+ *
+ * @param stats the statistics of the simulation
+ * @param nbWaitingCars the number of cars waiting
+ */
+void stats_queue (Stats * stats, long nbWaitingCars) {
+	long peak = atomic_load_explicit (&stats->peakQueue, memory_order_relaxed);
+
+	while (nbWaitingCars > peak && !atomic_compare_exchange_weak_explicit (&stats->peakQueue,
+			&peak, nbWaitingCars, memory_order_relaxed, memory_order_relaxed));
+}
+
+/**
+ * Record the switch of the lights ending a green phase.
+ *
+ * @param phase the scheduling of the phases of the lane
+ * @param lateness the time between the planned date of the switch and
+ * 		the switch, in microseconds
+ */
+void stats_phase (PhaseStats * phase, long lateness) {
+	if (lateness < 0)
+		lateness = 0;
+	hist_record (&phase->lateness, lateness);
+	if (lateness > STATS_OVERRUN)
+		atomic_fetch_add (&phase->overruns, 1);
+}
+
+/**
+ * Merge the lateness of the switches of both lanes.
+ *
+ * @return the number of overruns of both lanes
+ */
+static long stats_phases_merge (Stats * stats, Histogram * all) {
+	hist_reset (all);
+	if (!stats->phases)
+		return 0;
+	hist_merge (all, &stats->phases[0].lateness);
+	hist_merge (all, &stats->phases[1].lateness);
+	return atomic_load (&stats->phases[0].overruns) + atomic_load (&stats->phases[1].overruns);
+}
+
+/**
+ * Give the number of cars per second of the simulation.
+ */
+static double stats_throughput (Stats * stats) {
+	return stats->duration ? stats->nbCars * 1000000.0 / stats->duration : 0;
+}
+
+/**
+ * Print the wait times of a lane, or of all the lanes.
+ */
+static void stats_report_line (char * name, Histogram * hist) {
+	printf (" %-8s %8ld %10.0f %10ld %10ld %10ld %10ld\n", name, atomic_load (&hist->total),
+		hist_mean (hist), hist_percentile (hist, 50), hist_percentile (hist, 90),
+		hist_percentile (hist, 99), atomic_load (&hist->max));
+}
+
+/**
+ * Print the statistics at the end of the simulation.
+ *
+ * @param stats the statistics of the simulation
+ */
+void stats_report (Stats * stats) {
+	static Histogram all;	/* Too large for the stack of a worker. */
+	int i;
+
+	hist_reset (&all);
+	hist_merge (&all, &stats->waits[0]);
+	hist_merge (&all, &stats->waits[1]);
+
+	puts (" ==== STATISTICS ===========================");
+	if (stats->controller)
+		printf (" Controller: %s\n", stats->controller);
+	printf (" Cars: %ld in %.3f s (%.3f cars/s)\n", stats->nbCars,
+		stats->duration / 1000000.0, stats_throughput (stats));
+	printf (" Peak queue: %ld car(s)\n", atomic_load (&stats->peakQueue));
+	puts (" Wait (us)  passages       mean        p50        p90        p99        max");
+	stats_report_line ("Lane 1", &stats->waits[0]);
+	stats_report_line ("Lane 2", &stats->waits[1]);
+	stats_report_line ("All", &all);
+	if (atomic_load (&stats->notices.total))
+		printf (" Notices: %ld, latency (us) mean %.0f, p99 %ld, max %ld\n",
+			atomic_load (&stats->notices.total), hist_mean (&stats->notices),
+			hist_percentile (&stats->notices, 99), atomic_load (&stats->notices.max));
+	if (stats->phases) {
+		puts (" Phases (us) switches     mean        p50        p99        max   overruns");
+		for (i = 0; i < 2; i++)
+			printf (" Lane %d   %8ld %10.0f %10ld %10ld %10ld %10ld\n", i + 1,
+				atomic_load (&stats->phases[i].lateness.total), hist_mean (&stats->phases[i].lateness),
+				hist_percentile (&stats->phases[i].lateness, 50),
+				hist_percentile (&stats->phases[i].lateness, 99),
+				atomic_load (&stats->phases[i].lateness.max), atomic_load (&stats->phases[i].overruns));
+	}
+	puts (" ===========================================\n");
+	fflush (stdout);
+}
+
+/**
+ * Write the durations of a histogram in JSON, the number of values being
+ * named after what they count.
+ */
+static void stats_export_json (FILE * file, char * name, char * count, Histogram * hist) {
+	fprintf (file, "\"%s\":{\"%s\":%ld,\"mean\":%.1f,\"p50\":%ld,\"p90\":%ld,\"p99\":%ld,\"max\":%ld}",
+		name, count, atomic_load (&hist->total), hist_mean (hist), hist_percentile (hist, 50),
+		hist_percentile (hist, 90), hist_percentile (hist, 99), atomic_load (&hist->max));
+}
+
+/**
+ * Write the wait times of a histogram in CSV.
+ */
+static void stats_export_csv (FILE * file, Histogram * hist) {
+	fprintf (file, ",%ld,%.1f,%ld,%ld,%ld,%ld", atomic_load (&hist->total), hist_mean (hist),
+		hist_percentile (hist, 50), hist_percentile (hist, 90), hist_percentile (hist, 99),
+		atomic_load (&hist->max));
+}
+
+/**
+ * Append the statistics to a file: a JSON object per line if the name
+ * ends with ".json", a CSV row otherwise (with the header if the file
+ * is empty).
+ *
+ * @param stats the statistics of the simulation
+ * @param path the path of the file
+ *
+ * @return 0 if success, -1 otherwise
+ */
+int stats_export (Stats * stats, char * path) {
+	static Histogram all, phases;
+	char * names[] = {"lane1", "lane2", "all"};
+	Histogram * hists[] = {&stats->waits[0], &stats->waits[1], &all};
+	int length = strlen (path), i;
+	long overruns = stats_phases_merge (stats, &phases);
+	FILE * file;
+
+	hist_reset (&all);
+	hist_merge (&all, &stats->waits[0]);
+	hist_merge (&all, &stats->waits[1]);
+
+	if (!(file = fopen (path, "a")))
+		return -1;
+
+	if (length >= 5 && strcmp (path + length - 5, ".json") == 0) {
+		fprintf (file, "{\"date\":%ld,\"controller\":\"%s\",\"cars\":%ld,\"duration_us\":%ld,\"throughput\":%.3f,"
+			"\"peak_queue\":%ld,\"wait_us\":{", (long) time (0),
+			stats->controller ? stats->controller : "", stats->nbCars, stats->duration,
+			stats_throughput (stats), atomic_load (&stats->peakQueue));
+		for (i = 0; i < 3; i++) {
+			stats_export_json (file, names[i], "passages", hists[i]);
+			fputs (i < 2 ? "," : "},", file);
+		}
+		stats_export_json (file, "notice_us", "count", &stats->notices);
+		fputc (',', file);
+		stats_export_json (file, "phase_us", "switches", &phases);
+		fprintf (file, ",\"overruns\":%ld}\n", overruns);
+	} else {
+		if (ftell (file) == 0) {
+			fputs ("date,controller,cars,duration_us,throughput,peak_queue", file);
+			for (i = 0; i < 3; i++)
+				fprintf (file, ",%s_passages,%s_mean,%s_p50,%s_p90,%s_p99,%s_max",
+					names[i], names[i], names[i], names[i], names[i], names[i]);
+			fputs (",notice_count,notice_mean,notice_p50,notice_p90,notice_p99,notice_max", file);
+			fputs (",phase_switches,phase_mean,phase_p50,phase_p90,phase_p99,phase_max,overruns\n", file);
+		}
+		fprintf (file, "%ld,%s,%ld,%ld,%.3f,%ld", (long) time (0),
+			stats->controller ? stats->controller : "", stats->nbCars, stats->duration,
+			stats_throughput (stats), atomic_load (&stats->peakQueue));
+		for (i = 0; i < 3; i++)
+			stats_export_csv (file, hists[i]);
+		stats_export_csv (file, &stats->notices);
+		stats_export_csv (file, &phases);
+		fprintf (file, ",%ld\n", overruns);
+	}
+	return fclose (file) == EOF ? -1 : 0;
+}
@@ -0,0 +1,279 @@
+/**
+ *
+ * @file trace.c
+ * Trace of the simulation for the Chrome and Perfetto viewers.
+ *
+ * Implementation of functions defined in @see trace.h
+ *
+ * The file is opened in append mode before the roles start: each process
+ * writes whole batches of events at the end of the file, which ends with
+ * an open array until the process which opened it closes it (the viewers
+ * read an array cut short as well).
+ *
+ * @version 1.0
+ *
+ * ********************************************************* */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "../inc/trace.h"
+
+/**
+ * The trace file (-1: no trace).
+ */
+static int traceFd = -1;
+
+/**
+ * The process which opened the trace.
+ */
+static pid_t traceOwner;
+
+/**
+ * State of each junction seen by the writer of the process.
+ */
+static TraceJunction * junctions;
+
+/**
+ * Number of junctions of the table.
+ */
+static int nbJunctions;
+
+/**
+ * Set for each car stopped at a light, by the writer of the process.
+ */
+static unsigned char * stopped;
+
+/**
+ * Number of cars of the table.
+ */
+static long nbStopped;
+
+/**
+ * Give the state of a junction, growing the table to hold it.
+ *
+ * @param junction the number of the junction (-1: the only one)
+ *
+ * @return the state, 0 if the table could not grow
+ */
+static TraceJunction * trace_junction (int junction) {
+	TraceJunction * grown;
+	int i, size;
+
+	if (++junction >= nbJunctions) {
+		size = nbJunctions ? nbJunctions : 1;
+		while (size <= junction)
+			size *= 2;
+		grown = realloc (junctions, size * sizeof (TraceJunction));
+		if (!grown)
+			return 0;
+		for (i = nbJunctions; i < size; i++) {
+			grown[i].greenStart[0] = grown[i].greenStart[1] = -1;
+			grown[i].queue[0] = grown[i].queue[1] = 0;
+			grown[i].named = 0;
+		}
+		junctions = grown;
+		nbJunctions = size;
+	}
+	return &junctions[junction];
+}
+
+/**
+ * Give the stop flag of a car, growing the table to hold it.
+ *
+ * @param car the number of the car
+ *
+ * @return the flag, 0 if the table could not grow
+ */
+static unsigned char * trace_stopped (long car) {
+	unsigned char * grown;
+	long size;
+
+	if (car >= nbStopped) {
+		size = nbStopped ? nbStopped : 1024;
+		while (size <= car)
+			size *= 2;
+		grown = realloc (stopped, size);
+		if (!grown)
+			return 0;
+		memset (grown + nbStopped, 0, size - nbStopped);
+		stopped = grown;
+		nbStopped = size;
+	}
+	return &stopped[car];
+}
+
+/**
+ * Format the names of a junction and of its lanes.
+ */
+static int trace_names (int junction, int pid, char * buffer, int size) {
+	char name[32];
+
+	if (junction >= 0)
+		snprintf (name, sizeof (name), "Carrefour %d", junction);
+	else
+		strcpy (name, "Carrefour");
+	return snprintf (buffer, size,
+		"{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"%s\"}},\n"
+		"{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":1,\"args\":{\"name\":\"Voie 1\"}},\n"
+		"{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":2,\"args\":{\"name\":\"Voie 2\"}},\n",
+		pid, name, pid, pid);
+}
+
+/**
+ * Format the counter of the cars stopped at a junction.
+ */
+static int trace_queue (TraceJunction * state, int pid, long time, char * buffer, int size) {
+	return snprintf (buffer, size,
+		"{\"name\":\"attente\",\"ph\":\"C\",\"pid\":%d,\"ts\":%ld,"
+		"\"args\":{\"voie 1\":%ld,\"voie 2\":%ld}},\n",
+		pid, time, state->queue[0], state->queue[1]);
+}
+
+/**
+ * Create the trace file. Called before the roles start: the forked
+ * processes write into the same file.
+ *
+ * @param path the name of the file
+ *
+ * @return 0 if success, -1 otherwise
+ */
+int trace_open (char * path) {
+	if ((traceFd = open (path, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644)) == -1)
+		return -1;
+	traceOwner = getpid ();
+	trace_write ("[\n", 2);
+	return 0;
+}
+
+/**
+ * Tell whether a trace is written.
+ *
+ * @return 1 if the trace file is open, 0 otherwise
+ */
+int trace_active () {
+	return traceFd != -1;
+}
+
+/**
+ * Format the events of a record (by the writer only).
+ *
+ * @param record the record to format
+ * @param buffer the buffer receiving the events
+ * @param size the size of the buffer, at least TRACE_RECORD_SIZE
+ *
+ * @return the number of characters written
+ */
+int trace_format (LogRecord * record, char * buffer, int size) {
+	TraceJunction * state = trace_junction (record->junction);
+	unsigned char * flag;
+	int pid = record->junction < 0 ? 1 : record->junction + 1, lane = record->lane & 1, n = 0;
+
+	if (!state)
+		return 0;
+	if (!state->named) {
+		n += trace_names (record->junction, pid, buffer, size);
+		state->named = 1;
+	}
+
+	switch (record->type) {
+		case LOG_CAR_ARRIVAL:
+			n += snprintf (buffer + n, size - n,
+				"{\"name\":\"Voie %d\",\"cat\":\"voiture\",\"ph\":\"b\",\"id\":%ld,\"pid\":%d,"
+				"\"tid\":%d,\"ts\":%ld,\"args\":{\"voiture\":%ld}},\n",
+				lane+1, record->car+1, pid, lane+1, record->stamp, record->car+1);
+			break;
+		case LOG_CAR_WAITING:
+			n += snprintf (buffer + n, size - n,
+				"{\"name\":\"Voie %d\",\"cat\":\"voiture\",\"ph\":\"n\",\"id\":%ld,\"pid\":%d,"
+				"\"tid\":%d,\"ts\":%ld,\"args\":{\"arrêt\":1}},\n",
+				lane+1, record->car+1, pid, lane+1, record->stamp);
+			if ((flag = trace_stopped (record->car)) && !*flag) {
+				*flag = 1;
+				state->queue[lane]++;
+				n += trace_queue (state, pid, record->stamp, buffer + n, size - n);
+			}
+			break;
+		case LOG_CAR_PASSED:
+			n += snprintf (buffer + n, size - n,
+				"{\"name\":\"Voie %d\",\"cat\":\"voiture\",\"ph\":\"e\",\"id\":%ld,\"pid\":%d,"
+				"\"tid\":%d,\"ts\":%ld},\n",
+				lane+1, record->car+1, pid, lane+1, record->stamp);
+			if ((flag = trace_stopped (record->car)) && *flag) {
+				*flag = 0;
+				if (state->queue[lane] > 0)
+					state->queue[lane]--;
+				n += trace_queue (state, pid, record->stamp, buffer + n, size - n);
+			}
+			break;
+		case LOG_LIGHT_GREEN:
+			state->greenStart[lane] = record->stamp;
+			break;
+		case LOG_LIGHT_RED:	/* The phase is written once over. */
+			if (state->greenStart[lane] != -1) {
+				n += snprintf (buffer + n, size - n,
+					"{\"name\":\"vert\",\"cat\":\"feu\",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,"
+					"\"ts\":%ld,\"dur\":%ld},\n",
+					pid, lane+1, state->greenStart[lane], record->stamp - state->greenStart[lane]);
+				state->greenStart[lane] = -1;
+			}
+			break;
+		case LOG_CARS_RELEASED:
+			n += snprintf (buffer + n, size - n,
+				"{\"name\":\"libération\",\"cat\":\"feu\",\"ph\":\"i\",\"s\":\"t\",\"pid\":%d,"
+				"\"tid\":%d,\"ts\":%ld,\"args\":{\"voitures\":%ld}},\n",
+				pid, lane+1, record->stamp, record->value);
+			break;
+		case LOG_NO_MORE_CARS:
+			n += snprintf (buffer + n, size - n,
+				"{\"name\":\"fin des arrivées\",\"ph\":\"i\",\"s\":\"p\",\"pid\":%d,\"tid\":1,"
+				"\"ts\":%ld},\n", pid, record->stamp);
+			break;
+		case LOG_LANE_COMMAND:
+			n += snprintf (buffer + n, size - n,
+				"{\"name\":\"choix de la voie %d\",\"ph\":\"i\",\"s\":\"p\",\"pid\":%d,\"tid\":%d,"
+				"\"ts\":%ld},\n", lane+1, pid, lane+1, record->stamp);
+			break;
+		default:	/* The counter follows the stops and the passages. */
+			break;
+	}
+	return n < size ? n : size - 1;
+}
+
+/**
+ * Append formatted events to the trace file.
+ *
+ * @param buffer the events
+ * @param length the number of characters
+ */
+void trace_write (char * buffer, int length) {
+	ssize_t written;
+
+	while (length > 0 && (written = write (traceFd, buffer, length)) > 0) {
+		buffer += written;
+		length -= written;
+	}
+}
+
+/**
+ * Close the trace file. The process which opened it ends the array of
+ * events, once the other ones are done.
+ */
+void trace_close () {
+	static char end[] = "{\"name\":\"process_sort_index\",\"ph\":\"M\",\"pid\":1,"
+		"\"args\":{\"sort_index\":0}}\n]\n";
+
+	if (traceFd == -1)
+		return;
+	if (getpid () == traceOwner)
+		trace_write (end, sizeof (end) - 1);
+	close (traceFd);
+	traceFd = -1;
+	free (junctions);
+	junctions = 0;
+	nbJunctions = 0;
+	free (stopped);
+	stopped = 0;
+	nbStopped = 0;
+}
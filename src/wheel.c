@@ -0,0 +1,249 @@
+/**
+ *
+ * @file wheel.c
+ * Hierarchical timing wheel of the pending tasks.
+ *
+ * Implementation of functions defined in @see wheel.h
+ *
+ * @version 1.0
+ *
+ * ********************************************************* */
+#include <stdlib.h>
+#include <string.h>
+#include "../inc/wheel.h"
+
+/**
+ * Empty a list.
+ */
+static inline void wheel_clear (WheelList * list) {
+	list->head = list->tail = -1;
+}
+
+/**
+ * Link an entry at the end of a list.
+ */
+static inline void wheel_append (Wheel * wheel, WheelList * list, long entry) {
+	wheel->entries[entry].next = -1;
+	if (list->head == -1)
+		list->head = entry;
+	else
+		wheel->entries[list->tail].next = entry;
+	list->tail = entry;
+}
+
+/**
+ * Link the free entries from the given one to the end of the table.
+ */
+static void wheel_link_free (Wheel * wheel, long first) {
+	long i;
+
+	for (i = first; i < wheel->capacity - 1; i++)
+		wheel->entries[i].next = i + 1;
+	wheel->entries[wheel->capacity - 1].next = -1;
+	wheel->free = first;
+}
+
+/**
+ * Give the level of a date: the lowest one whose slots share, with the
+ * clock of the wheel, all the bits above their span.
+ *
+ * @return the level, -1 if the date is beyond the last level
+ */
+static inline int wheel_level (Wheel * wheel, long time) {
+	int k;
+
+	for (k = 0; k < WHEEL_LEVELS; k++)
+		if ((time >> (WHEEL_BITS * (k + 1))) == (wheel->now >> (WHEEL_BITS * (k + 1))))
+			return k;
+	return -1;
+}
+
+/**
+ * Link an entry in the list matching its date.
+ */
+static void wheel_place (Wheel * wheel, long entry) {
+	long time = wheel->entries[entry].event.time;
+	int k, slot;
+
+	if (time <= wheel->now) {
+		wheel_append (wheel, &wheel->due, entry);
+		return;
+	}
+	if ((k = wheel_level (wheel, time)) == -1) {
+		wheel_append (wheel, &wheel->far, entry);
+		return;
+	}
+	slot = (time >> (WHEEL_BITS * k)) & (WHEEL_SLOTS - 1);
+	wheel_append (wheel, &wheel->slots[k][slot], entry);
+	wheel->occupied[k] |= 1UL << slot;
+}
+
+/**
+ * Allocate an empty wheel.
+ *
+ * @param wheel the wheel to initialize
+ * @param now the date from which the wheel turns
+ * @param capacity the initial number of timers which can be stored
+ *
+ * @return 0 if success, -1 otherwise
+ */
+int wheel_init (Wheel * wheel, long now, long capacity) {
+	int k, slot;
+
+	if (capacity <= 0)
+		capacity = DEFAULT_WHEEL_CAPACITY;
+	wheel->entries = malloc (capacity * sizeof (WheelEntry));
+	if (!wheel->entries)
+		return -1;
+	wheel->capacity = capacity;
+	wheel_link_free (wheel, 0);
+	wheel->size = 0;
+	wheel->now = now;
+	wheel->seq = 0;
+	for (k = 0; k < WHEEL_LEVELS; k++) {
+		wheel->occupied[k] = 0;
+		for (slot = 0; slot < WHEEL_SLOTS; slot++)
+			wheel_clear (&wheel->slots[k][slot]);
+	}
+	wheel_clear (&wheel->due);
+	wheel_clear (&wheel->far);
+	return 0;
+}
+
+/**
+ * Release the storage of a wheel.
+ *
+ * @param wheel the wheel to destroy
+ */
+void wheel_free (Wheel * wheel) {
+	free (wheel->entries);
+	wheel->entries = 0;
+	wheel->size = wheel->capacity = 0;
+}
+
+/**
+ * Insert a timer. A date already past is due at once.
+ *
+ * @param wheel the wheel
+ * @param time the date of the timer
+ * @param type the kind of task
+ * @param car the car concerned by the task (0: none)
+ * @param lane the lane concerned by the task
+ *
+ * @return 0 if success, -1 otherwise
+ */
+int wheel_insert (Wheel * wheel, long time, EventType type, Car * car, int lane) {
+	WheelEntry * grown;
+	Event * event;
+	long entry;
+
+	if (wheel->free == -1) {
+		grown = realloc (wheel->entries, 2 * wheel->capacity * sizeof (WheelEntry));
+		if (!grown)
+			return -1;
+		wheel->entries = grown;
+		wheel->capacity *= 2;
+		wheel_link_free (wheel, wheel->capacity / 2);
+	}
+	entry = wheel->free;
+	wheel->free = wheel->entries[entry].next;
+
+	event = &wheel->entries[entry].event;
+	event->time = time;
+	event->seq = wheel->seq++;
+	event->type = type;
+	if (car)
+		event->car = *car;
+	else
+		memset (&event->car, 0, sizeof (Car));	/* No stray byte copied with the event. */
+	event->lane = lane;
+	wheel_place (wheel, entry);
+	wheel->size++;
+	return 0;
+}
+
+/**
+ * Give the date until which no timer expires: the date of the next
+ * timer, or the start of the slot holding it if it must go down first.
+ *
+ * The timers of a level all lie after those of the lower levels, and
+ * after the clock in their level: the first occupied slot of the lowest
+ * occupied level is the next one.
+ *
+ * @param wheel the wheel
+ * @param date the date
+ *
+ * @return 1 if a date is given, 0 if the wheel is empty
+ */
+int wheel_next (Wheel * wheel, long * date) {
+	int k, shift;
+
+	if (wheel->due.head != -1) {
+		*date = wheel->now;
+		return 1;
+	}
+	for (k = 0; k < WHEEL_LEVELS; k++) {
+		if (!wheel->occupied[k])
+			continue;
+		shift = WHEEL_BITS * (k + 1);
+		*date = ((wheel->now >> shift) << shift)
+			| ((long) __builtin_ctzl (wheel->occupied[k]) << (WHEEL_BITS * k));
+		return 1;
+	}
+	if (wheel->far.head != -1) {
+		shift = WHEEL_BITS * WHEEL_LEVELS;
+		*date = ((wheel->now >> shift) + 1) << shift;
+		return 1;
+	}
+	return 0;
+}
+
+/**
+ * Remove a timer due at the given date, turning the wheel up to it.
+ *
+ * The clock of the wheel goes from slot to slot, never past the given
+ * date: the timers of a slot of the first level become due, those of an
+ * upper level go down to the lower ones.
+ *
+ * @param wheel the wheel
+ * @param now the current date
+ * @param event the task of the removed timer
+ *
+ * @return 1 if a timer is returned, 0 if none is due
+ */
+int wheel_expire (Wheel * wheel, long now, Event * event) {
+	WheelList moved;
+	long date, entry;
+	int k, slot;
+
+	while (wheel->due.head == -1) {
+		if (!wheel_next (wheel, &date) || date > now)
+			return 0;
+		wheel->now = date;
+
+		for (k = 0; k < WHEEL_LEVELS && !wheel->occupied[k]; k++);
+		if (k == WHEEL_LEVELS) {
+			moved = wheel->far;
+			wheel_clear (&wheel->far);
+		} else {
+			slot = __builtin_ctzl (wheel->occupied[k]);
+			moved = wheel->slots[k][slot];
+			wheel_clear (&wheel->slots[k][slot]);
+			wheel->occupied[k] &= ~(1UL << slot);
+		}
+		/* Each timer goes down, or is due if it was on the first level. */
+		while ((entry = moved.head) != -1) {
+			moved.head = wheel->entries[entry].next;
+			wheel_place (wheel, entry);
+		}
+	}
+
+	entry = wheel->due.head;
+	if ((wheel->due.head = wheel->entries[entry].next) == -1)
+		wheel->due.tail = -1;
+	*event = wheel->entries[entry].event;
+	wheel->entries[entry].next = wheel->free;
+	wheel->free = entry;
+	wheel->size--;
+	return 1;
+}
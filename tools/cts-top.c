@@ -0,0 +1,171 @@
+/**
+ *
+ * @file cts-top.c
+ * Live monitor of a running simulation.
+ *
+ * This program attaches read-only the metrics of a real time or interactive
+ * simulation (@see metrics.h), found through the registry of the instances,
+ * and prints them at a fixed interval: the lights, then per lane the
+ * waiting cars and the rates of arrivals and passages over the interval.
+ * It only reads the counters: the simulation never waits for it.
+ *
+ * Usage: cts-top [-i MILLISECONDS] [-n SAMPLES] [PID]
+ * Without process id, the most recent running instance is watched. It
+ * must be run from the directory of the simulation, which holds the
+ * registry.
+ *
+ * @version 1.0
+ *
+ * ********************************************************* */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <signal.h>
+#include <errno.h>
+#include "../inc/metrics.h"
+
+/**
+ * Default interval between two samples in milliseconds.
+ */
+#define TOP_INTERVAL 1000
+
+/**
+ * Maximum number of instances looked at.
+ */
+#define TOP_MAX_INSTANCES 256
+
+/**
+ * A sample of the counters read at each interval.
+ */
+typedef struct {
+	long date;
+	long arrivals[2];
+	long passed[2];
+} Sample;
+
+/**
+ * Read the counters needed for the rates.
+ */
+static void top_sample (Metrics * block, Sample * sample) {
+	int i;
+
+	sample->date = metrics_now ();
+	for (i = 0; i < 2; i++) {
+		sample->arrivals[i] = atomic_load_explicit (&block->lanes[i].arrivals, memory_order_relaxed);
+		sample->passed[i] = atomic_load_explicit (&block->lanes[i].passed, memory_order_relaxed);
+	}
+}
+
+/**
+ * Print the state of the simulation and the rates since the previous sample.
+ */
+static void top_print (Metrics * block, Sample * previous, Sample * current, int clear) {
+	double seconds = (current->date - previous->date) / 1000000.0;
+	long passed = 0;
+	int i;
+
+	for (i = 0; i < 2; i++)
+		passed += current->passed[i];
+	if (clear)
+		fputs ("\033[H\033[2J", stdout);
+	printf (" ==== CTS-TOP: instance %d, %.1f s ====\n", block->pid,
+		(current->date - block->start) / 1000000.0);
+	printf (" Cars: %ld generated, %ld passed of %ld\n",
+		atomic_load_explicit (&block->generated, memory_order_relaxed), passed, block->nbCars);
+	printf (" Lights: lane %d green for %.1f s, %ld switch(es)\n",
+		atomic_load_explicit (&block->green, memory_order_relaxed) + 1,
+		(current->date - atomic_load_explicit (&block->greenStart, memory_order_relaxed)) / 1000000.0,
+		atomic_load_explicit (&block->switches, memory_order_relaxed));
+	printf (" %-6s %8s %10s %10s %10s %10s\n", "Lane", "queue", "arrivals", "arrived/s",
+		"stops", "passed/s");
+	for (i = 0; i < 2; i++)
+		printf (" %-6d %8ld %10ld %10.1f %10ld %10.1f\n", i + 1,
+			atomic_load_explicit (&block->lanes[i].queue, memory_order_relaxed),
+			current->arrivals[i], (current->arrivals[i] - previous->arrivals[i]) / seconds,
+			atomic_load_explicit (&block->lanes[i].stops, memory_order_relaxed),
+			(current->passed[i] - previous->passed[i]) / seconds);
+	putchar ('\n');
+	fflush (stdout);
+}
+
+/**
+ * Find the most recent running instance which has metrics.
+ *
+ * @return its process id, -1 if none
+ */
+static int top_find () {
+	int pids[TOP_MAX_INSTANCES], n, i, pid = -1;
+	Metrics * block;
+	long start = 0;
+
+	if ((n = ipcinstances (pids, TOP_MAX_INSTANCES)) == -1)
+		return -1;
+	for (i = 0; i < n; i++) {
+		if (!(block = metrics_attach (pids[i])))
+			continue;
+		if (block->start > start) {
+			start = block->start;
+			pid = pids[i];
+		}
+		shmdt (block);
+	}
+	return pid;
+}
+
+int main (int argc, char * argv[]) {
+	int interval = TOP_INTERVAL, nbSamples = -1, pid = -1, cmd;
+	Sample previous, current;
+	Metrics * block;
+	char * near;
+
+	while ((cmd = getopt (argc, argv, "i:n:h")) != -1) {
+		switch (cmd) {
+			case 'i':
+				interval = (int) strtol (optarg, &near, 10);
+				if (*near != '\0' || interval <= 0) {
+					fprintf (stderr, "Invalid interval: %s\n", optarg);
+					return 1;
+				}
+				break;
+			case 'n':
+				nbSamples = (int) strtol (optarg, &near, 10);
+				if (*near != '\0' || nbSamples <= 0) {
+					fprintf (stderr, "Invalid number of samples: %s\n", optarg);
+					return 1;
+				}
+				break;
+			default:
+				fprintf (stderr, "Usage: %s [-i MILLISECONDS] [-n SAMPLES] [PID]\n", argv[0]);
+				return cmd == 'h' ? 0 : 1;
+		}
+	}
+	if (optind < argc) {
+		pid = (int) strtol (argv[optind], &near, 10);
+		if (*near != '\0' || pid <= 0) {
+			fprintf (stderr, "Invalid process id: %s\n", argv[optind]);
+			return 1;
+		}
+	} else if ((pid = top_find ()) == -1) {
+		fprintf (stderr, "No running simulation in %s\n", DEFAULT_INSTANCES_PATH);
+		return 1;
+	}
+	if (!(block = metrics_attach (pid))) {
+		fprintf (stderr, "No metrics for the instance %d\n", pid);
+		return 1;
+	}
+
+	top_sample (block, &previous);
+	while (nbSamples != 0) {
+		usleep (interval * 1000);
+		top_sample (block, &current);
+		top_print (block, &previous, &current, isatty (STDOUT_FILENO));
+		previous = current;
+		if (nbSamples > 0)
+			nbSamples--;
+		/* The simulation is over, or killed before it could say so. */
+		if (!atomic_load (&block->running) || (kill (pid, 0) == -1 && errno == ESRCH))
+			break;
+	}
+	shmdt (block);
+	return 0;
+}